@@ -0,0 +1,184 @@
+# Host version of the delta-encoded housekeeping stream (src/can/hk_delta.c)
+# Use the following command to decode a file of records, one record per line in
+# hex (e.g. "83:41:00:7f"), for a message type with 27 fields:
+# python ./bin/hk_delta.py -c 27 records.txt
+
+# See src/can/hk_delta.c for a description of the format. This file must be
+# kept in sync with it.
+
+from __future__ import print_function
+import argparse
+import sys
+
+KEYFRAME_FLAG = 0x80
+SEQ_MASK = 0x7F
+TOKEN_CONT = 0x80
+TOKEN_RUN = 0x40
+TOKEN_BITS = 6
+MAX_TOKEN_LEN = 5
+FORCE_KEYFRAME = 0xFF
+
+# Decoder return values
+OK = 0
+NEED_KEYFRAME = 1
+INVALID = 2
+
+MASK_32 = 0xFFFFFFFF
+
+
+def zigzag_encode(delta):
+    delta &= MASK_32
+    sign = MASK_32 if delta & 0x80000000 else 0
+    return ((delta << 1) ^ sign) & MASK_32
+
+
+def zigzag_decode(value):
+    return ((value >> 1) ^ (-(value & 1) & MASK_32)) & MASK_32
+
+
+def put_token(run, payload):
+    out = bytearray()
+    byte = (payload & 0x3F) | (TOKEN_RUN if run else 0)
+    payload >>= TOKEN_BITS
+    while True:
+        if payload != 0:
+            byte |= TOKEN_CONT
+        out.append(byte)
+        if payload == 0:
+            return out
+        byte = payload & 0x7F
+        payload >>= 7
+
+
+def get_token(buf, pos):
+    # Returns (run, payload, new position), or None if the token is invalid
+    if pos >= len(buf):
+        return None
+    run = 1 if buf[pos] & TOKEN_RUN else 0
+    payload = buf[pos] & 0x3F
+    shift = TOKEN_BITS
+    i = 0
+    while buf[pos + i] & TOKEN_CONT:
+        i += 1
+        if pos + i >= len(buf) or i >= MAX_TOKEN_LEN:
+            return None
+        payload |= (buf[pos + i] & 0x7F) << shift
+        shift += 7
+    return (run, payload & MASK_32, pos + i + 1)
+
+
+class HkDelta:
+    def __init__(self, count, keyframe_period=16):
+        self.count = count
+        self.keyframe_period = keyframe_period
+        self.seq = 0
+        self.synced = False
+        self.last = [0] * count
+        self.force_keyframe()
+
+    def force_keyframe(self):
+        self.since_keyframe = FORCE_KEYFRAME
+        self.synced = False
+
+    def encode(self, values):
+        keyframe = (self.since_keyframe == FORCE_KEYFRAME or
+            (self.keyframe_period > 0 and
+                self.since_keyframe >= self.keyframe_period))
+        out = bytearray([(self.seq & SEQ_MASK) |
+            (KEYFRAME_FLAG if keyframe else 0)])
+
+        run = 0
+        for i in range(self.count + 1):
+            same = False
+            payload = 0
+            if i < self.count:
+                ref = 0 if keyframe else self.last[i]
+                same = (values[i] == ref)
+                payload = values[i] if keyframe else \
+                    zigzag_encode(values[i] - ref)
+
+            if run > 0 and (not same or i == self.count or run == 0x3F):
+                out += put_token(1, run)
+                run = 0
+
+            if i == self.count:
+                break
+            if same:
+                run += 1
+            else:
+                out += put_token(0, payload)
+
+        self.last = list(values)
+        self.seq = (self.seq + 1) & SEQ_MASK
+        if keyframe:
+            self.since_keyframe = 1
+        elif self.since_keyframe < FORCE_KEYFRAME - 1:
+            self.since_keyframe += 1
+        return out
+
+    def decode(self, buf):
+        # Returns (status, values)
+        if len(buf) < 1:
+            return (INVALID, None)
+
+        keyframe = bool(buf[0] & KEYFRAME_FLAG)
+        seq = buf[0] & SEQ_MASK
+        if not keyframe and (not self.synced or seq != self.seq):
+            self.synced = False
+            return (NEED_KEYFRAME, None)
+
+        values = []
+        pos = 1
+        while len(values) < self.count:
+            token = get_token(buf, pos)
+            if token is None:
+                self.synced = False
+                return (INVALID, None)
+            run, payload, pos = token
+
+            i = len(values)
+            if run:
+                if payload == 0 or payload > self.count - i:
+                    self.synced = False
+                    return (INVALID, None)
+                for j in range(i, i + payload):
+                    values.append(0 if keyframe else self.last[j])
+            else:
+                values.append(payload if keyframe else
+                    (self.last[i] + zigzag_decode(payload)) & MASK_32)
+
+        if pos != len(buf):
+            self.synced = False
+            return (INVALID, None)
+
+        self.last = values
+        self.seq = (seq + 1) & SEQ_MASK
+        self.synced = True
+        return (OK, values)
+
+
+def parse_record(line):
+    return bytearray(int(b, 16) for b in line.replace(":", " ").split())
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=("Decodes a delta-encoded " +
+        "housekeeping stream (one record per line, in hex)."))
+    parser.add_argument('-c', '--count', required=True, type=int,
+        metavar=('count'), help="Number of fields per record")
+    parser.add_argument('file', nargs='?', default='-',
+        help="File of records (default: stdin)")
+    args = parser.parse_args()
+
+    f = sys.stdin if args.file == '-' else open(args.file)
+    decoder = HkDelta(args.count)
+    for line in f:
+        if not line.strip():
+            continue
+        status, values = decoder.decode(parse_record(line))
+        if status == OK:
+            print(" ".join("0x%X" % v for v in values))
+        elif status == NEED_KEYFRAME:
+            print("Waiting for keyframe")
+        else:
+            print("Invalid record")
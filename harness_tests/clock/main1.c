@@ -0,0 +1,73 @@
+#include <test/test.h>
+#include <timer/clock.h>
+
+void millis_test(void) {
+    init_clock();
+    ASSERT_TRUE(clock_running());
+
+    uint32_t start = millis();
+    _delay_ms(50);
+    uint32_t elapsed = millis() - start;
+    ASSERT_FALSE(elapsed < 49);
+    ASSERT_FALSE(elapsed > 52);
+}
+
+void micros_test(void) {
+    uint32_t start = micros();
+    _delay_ms(5);
+    uint32_t elapsed = micros() - start;
+    ASSERT_FALSE(elapsed < 4900);
+    ASSERT_FALSE(elapsed > 5200);
+}
+
+void monotonic_test(void) {
+    // Reads around many ticks must never go backwards
+    uint32_t prev = micros();
+    uint16_t backwards = 0;
+    for (uint16_t i = 0; i < 10000; i++) {
+        uint32_t now = micros();
+        if ((int32_t) (now - prev) < 0) {
+            backwards++;
+        }
+        prev = now;
+    }
+    ASSERT_EQ(backwards, 0);
+}
+
+void pending_period_test(void) {
+    // With interrupts disabled across the end of a period of the counter, the
+    // pending period is still counted
+    while (TCNT1 < TIMER_WHEEL_PERIOD_COUNTS - 100) {}
+    uint32_t start = 0;
+    uint32_t end = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        start = micros();
+        _delay_us(1500);
+        end = micros();
+    }
+    ASSERT_FALSE(end - start < 1400);
+    ASSERT_FALSE(end - start > 1600);
+}
+
+void compare_test(void) {
+    ASSERT_TRUE(CLOCK_AFTER(10, 5));
+    ASSERT_FALSE(CLOCK_AFTER(5, 10));
+    ASSERT_FALSE(CLOCK_AFTER(5, 5));
+    ASSERT_TRUE(CLOCK_AFTER_EQ(5, 5));
+    // Across the wrap
+    ASSERT_TRUE(CLOCK_AFTER(3, 0xFFFFFFF0UL));
+    ASSERT_FALSE(CLOCK_AFTER(0xFFFFFFF0UL, 3));
+}
+
+test_t t1 = { .name = "millis", .fn = millis_test };
+test_t t2 = { .name = "micros", .fn = micros_test };
+test_t t3 = { .name = "monotonic", .fn = monotonic_test };
+test_t t4 = { .name = "pending period", .fn = pending_period_test };
+test_t t5 = { .name = "compare", .fn = compare_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
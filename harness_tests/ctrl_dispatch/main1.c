@@ -0,0 +1,148 @@
+#include <test/test.h>
+#include <can/ctrl_dispatch.h>
+
+uint32_t setpoint = 0;
+uint16_t fake_time = 0;
+
+uint16_t get_fake_time(void) {
+    return fake_time;
+}
+
+uint8_t ping(uint32_t arg, uint32_t* result) {
+    return CAN_STATUS_OK;
+}
+
+uint8_t get_setpoint(uint32_t arg, uint32_t* result) {
+    *result = setpoint;
+    return CAN_STATUS_OK;
+}
+
+uint8_t set_setpoint(uint32_t arg, uint32_t* result) {
+    if (arg > 0xFFF) {
+        return CAN_STATUS_INVALID_DATA;
+    }
+    setpoint = arg;
+    *result = arg;
+    // Pretend this takes a while
+    fake_time += 25;
+    return CAN_STATUS_OK;
+}
+
+const ctrl_cmd_t cmds[CAN_EPS_CTRL_FIELD_COUNT] PROGMEM = {
+    CTRL_CMD(CAN_EPS_CTRL_PING,             0, ping),
+    CTRL_CMD(CAN_EPS_CTRL_GET_HEAT_SHAD_SP, 0, get_setpoint),
+    CTRL_CMD(CAN_EPS_CTRL_SET_HEAT1_SHAD_SP, 4, set_setpoint),
+};
+ctrl_stats_t stats[CAN_EPS_CTRL_FIELD_COUNT];
+const ctrl_table_t table = {
+    CAN_EPS_CTRL, CAN_EPS_CTRL_FIELD_COUNT, cmds, stats
+};
+
+void ping_test(void) {
+    uint8_t req[8] = { CAN_EPS_CTRL, CAN_EPS_CTRL_PING, 0, 0, 0, 0, 0, 0 };
+    uint8_t resp[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_OK);
+    ASSERT_EQ(resp[CAN_MSG_TYPE_IDX], CAN_EPS_CTRL);
+    ASSERT_EQ(resp[CAN_MSG_FIELD_IDX], CAN_EPS_CTRL_PING);
+    ASSERT_EQ(resp[CAN_MSG_STATUS_IDX], CAN_STATUS_OK);
+    ASSERT_EQ(resp[CAN_MSG_DATA_IDX], 0);
+    ASSERT_EQ(resp[CAN_MSG_DATA_IDX + 3], 0);
+
+    // No data needed, so only the type and field bytes are required
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, CAN_MSG_DATA_IDX, resp), CAN_STATUS_OK);
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 2, resp), CAN_STATUS_OK);
+    ASSERT_EQ(resp[CAN_MSG_STATUS_IDX], CAN_STATUS_OK);
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 1, resp), CAN_STATUS_INVALID_DATA);
+}
+
+void set_get_test(void) {
+    uint8_t req[8] = { CAN_EPS_CTRL, CAN_EPS_CTRL_SET_HEAT1_SHAD_SP,
+        0, 0, 0x00, 0x00, 0x0A, 0xBC };
+    uint8_t resp[8];
+
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_OK);
+    ASSERT_EQ(setpoint, 0xABC);
+    ASSERT_EQ(resp[CAN_MSG_DATA_IDX + 2], 0x0A);
+    ASSERT_EQ(resp[CAN_MSG_DATA_IDX + 3], 0xBC);
+
+    // Handler rejects the value
+    req[CAN_MSG_DATA_IDX + 1] = 0x01;
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_INVALID_DATA);
+    ASSERT_EQ(resp[CAN_MSG_STATUS_IDX], CAN_STATUS_INVALID_DATA);
+    ASSERT_EQ(setpoint, 0xABC);
+
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_GET_HEAT_SHAD_SP;
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_OK);
+    ASSERT_EQ(resp[CAN_MSG_FIELD_IDX], CAN_EPS_CTRL_GET_HEAT_SHAD_SP);
+    ASSERT_EQ(resp[CAN_MSG_DATA_IDX + 2], 0x0A);
+    ASSERT_EQ(resp[CAN_MSG_DATA_IDX + 3], 0xBC);
+}
+
+void invalid_test(void) {
+    uint8_t req[8] = { CAN_EPS_CTRL, CAN_EPS_CTRL_FIELD_COUNT, 0, 0, 0, 0, 0, 0 };
+    uint8_t resp[8];
+
+    // Out of range
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_INVALID_OPCODE);
+    ASSERT_EQ(resp[CAN_MSG_FIELD_IDX], CAN_EPS_CTRL_FIELD_COUNT);
+    ASSERT_EQ(resp[CAN_MSG_STATUS_IDX], CAN_STATUS_INVALID_OPCODE);
+
+    // Not in the table
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_RESET;
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_INVALID_OPCODE);
+
+    // Wrong message type
+    req[CAN_MSG_TYPE_IDX] = CAN_PAY_CTRL;
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_PING;
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 8, resp), CAN_STATUS_INVALID_OPCODE);
+
+    // Missing data
+    req[CAN_MSG_TYPE_IDX] = CAN_EPS_CTRL;
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_SET_HEAT1_SHAD_SP;
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 6, resp), CAN_STATUS_INVALID_DATA);
+    ASSERT_EQ(dispatch_ctrl_req(&table, req, 1, resp), CAN_STATUS_INVALID_DATA);
+}
+
+void stats_test(void) {
+    uint8_t req[8] = { CAN_EPS_CTRL, CAN_EPS_CTRL_PING, 0, 0, 0, 0, 0, 0 };
+    uint8_t resp[8];
+    ctrl_stats_t s;
+
+    reset_ctrl_stats(&table);
+    set_ctrl_time_fn(get_fake_time);
+
+    for (uint8_t i = 0; i < 3; i++) {
+        dispatch_ctrl_req(&table, req, 8, resp);
+    }
+    ASSERT_TRUE(get_ctrl_stats(&table, CAN_EPS_CTRL_PING, &s));
+    ASSERT_EQ(s.count, 3);
+    ASSERT_EQ(s.max_time, 0);
+
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_SET_HEAT1_SHAD_SP;
+    dispatch_ctrl_req(&table, req, 8, resp);
+    ASSERT_TRUE(get_ctrl_stats(&table, CAN_EPS_CTRL_SET_HEAT1_SHAD_SP, &s));
+    ASSERT_EQ(s.count, 1);
+    ASSERT_EQ(s.max_time, 25);
+
+    // Invalid requests are not counted
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_RESET;
+    dispatch_ctrl_req(&table, req, 8, resp);
+    ASSERT_TRUE(get_ctrl_stats(&table, CAN_EPS_CTRL_RESET, &s));
+    ASSERT_EQ(s.count, 0);
+    ASSERT_FALSE(get_ctrl_stats(&table, CAN_EPS_CTRL_FIELD_COUNT, &s));
+
+    set_ctrl_time_fn(NULL);
+}
+
+test_t t1 = { .name = "ping", .fn = ping_test };
+test_t t2 = { .name = "set/get", .fn = set_get_test };
+test_t t3 = { .name = "invalid", .fn = invalid_test };
+test_t t4 = { .name = "stats", .fn = stats_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
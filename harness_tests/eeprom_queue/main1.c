@@ -0,0 +1,198 @@
+#include <test/test.h>
+#include <queue/eeprom_queue.h>
+
+#define NUM_SLOTS 16
+
+eeprom_queue_t queue;
+
+// Sets the first byte of an element (the rest is the same)
+void make_elem(uint8_t* data, uint8_t id) {
+    for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+        data[i] = 0xB0 + i;
+    }
+    data[0] = id;
+}
+
+// Erases all slots (like a new EEPROM)
+void erase_slots(void) {
+    for (uint16_t i = 0; i < NUM_SLOTS * EEPROM_QUEUE_SLOT_SIZE; i++) {
+        eeprom_update_byte((uint8_t*) (EEPROM_QUEUE_DEF_ADDR + i), 0xFF);
+    }
+}
+
+void init_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    erase_slots();
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 0);
+    ASSERT_EQ(eeprom_queue_size(&queue), 0);
+    ASSERT_FALSE(eeprom_peek_queue(&queue, data));
+    ASSERT_FALSE(eeprom_dequeue(&queue, data));
+}
+
+void restore_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    erase_slots();
+    init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS);
+    for (uint8_t i = 0; i < 5; i++) {
+        make_elem(data, i);
+        ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    }
+    ASSERT_TRUE(eeprom_dequeue(&queue, data));
+    ASSERT_EQ(data[0], 0);
+
+    // Simulate a reset
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 4);
+    for (uint8_t i = 1; i < 5; i++) {
+        ASSERT_TRUE(eeprom_dequeue(&queue, data));
+        ASSERT_EQ(data[0], i);
+        ASSERT_EQ(data[QUEUE_DATA_SIZE - 1], 0xB0 + QUEUE_DATA_SIZE - 1);
+    }
+    ASSERT_EQ(eeprom_queue_size(&queue), 0);
+
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 0);
+}
+
+void full_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    erase_slots();
+    init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS);
+    for (uint8_t i = 0; i < MAX_QUEUE_SIZE; i++) {
+        make_elem(data, i);
+        ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    }
+    ASSERT_FALSE(eeprom_enqueue(&queue, data));
+    ASSERT_FALSE(eeprom_enqueue_front(&queue, data));
+
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS),
+        MAX_QUEUE_SIZE);
+    clear_eeprom_queue(&queue);
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 0);
+}
+
+void front_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    erase_slots();
+    init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS);
+    make_elem(data, 1);
+    ASSERT_TRUE(eeprom_enqueue_front(&queue, data));
+    make_elem(data, 2);
+    ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    make_elem(data, 0);
+    ASSERT_TRUE(eeprom_enqueue_front(&queue, data));
+
+    // Order is kept after a reset
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 3);
+    make_elem(data, 3);
+    ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    for (uint8_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(eeprom_dequeue(&queue, data));
+        ASSERT_EQ(data[0], i);
+    }
+}
+
+void corrupt_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    erase_slots();
+    init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS);
+    for (uint8_t i = 0; i < 3; i++) {
+        make_elem(data, i);
+        ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    }
+
+    // Corrupt the data of the second element (slot 1)
+    eeprom_update_byte((uint8_t*) (EEPROM_QUEUE_DEF_ADDR +
+        EEPROM_QUEUE_SLOT_SIZE + EEPROM_QUEUE_DATA_OFFSET), 0x77);
+
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 2);
+    ASSERT_TRUE(eeprom_dequeue(&queue, data));
+    ASSERT_EQ(data[0], 0);
+    ASSERT_TRUE(eeprom_dequeue(&queue, data));
+    ASSERT_EQ(data[0], 2);
+
+    // The corrupted slot was discarded
+    ASSERT_EQ(eeprom_read_byte((const uint8_t*) (EEPROM_QUEUE_DEF_ADDR +
+        EEPROM_QUEUE_SLOT_SIZE)), EEPROM_QUEUE_SLOT_DONE);
+}
+
+void wear_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    erase_slots();
+    init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS);
+    // Each new element goes in the next slot, even after a reset
+    for (uint8_t i = 0; i < NUM_SLOTS + 4; i++) {
+        make_elem(data, i);
+        ASSERT_TRUE(eeprom_enqueue(&queue, data));
+        ASSERT_EQ(queue.slots[queue.queue.head], i % NUM_SLOTS);
+        ASSERT_TRUE(eeprom_dequeue(&queue, data));
+        ASSERT_EQ(data[0], i);
+
+        if (i % 5 == 0) {
+            ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR,
+                NUM_SLOTS), 0);
+        }
+    }
+
+    // Slots in use are skipped
+    make_elem(data, 0);
+    ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    ASSERT_EQ(queue.slots[queue.queue.head], 4);
+    ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    queue.next_slot = 4;
+    ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    ASSERT_EQ(queue.slots[(queue.queue.head + 2) % MAX_QUEUE_SIZE], 6);
+    ASSERT_EQ(queue.next_slot, 7);
+}
+
+void invalid_test(void) {
+    uint8_t data[QUEUE_DATA_SIZE];
+    make_elem(data, 0);
+
+    // Not enough slots for a full queue
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR,
+        MAX_QUEUE_SIZE), EEPROM_QUEUE_INIT_ERROR);
+    ASSERT_FALSE(eeprom_enqueue(&queue, data));
+    ASSERT_FALSE(eeprom_enqueue_front(&queue, data));
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, 0),
+        EEPROM_QUEUE_INIT_ERROR);
+
+    // Past the end of the EEPROM
+    ASSERT_EQ(init_eeprom_queue(&queue,
+        E2END + 1 - (NUM_SLOTS - 1) * EEPROM_QUEUE_SLOT_SIZE, NUM_SLOTS),
+        EEPROM_QUEUE_INIT_ERROR);
+
+    // Overlaps the restart count/reason, heartbeat statistics or reset log
+    ASSERT_EQ(init_eeprom_queue(&queue, 0, NUM_SLOTS),
+        EEPROM_QUEUE_INIT_ERROR);
+    ASSERT_EQ(init_eeprom_queue(&queue, HB_STATS_EEPROM_ADDR - 1, NUM_SLOTS),
+        EEPROM_QUEUE_INIT_ERROR);
+    ASSERT_EQ(init_eeprom_queue(&queue,
+        HB_RESET_LOG_EEPROM_ADDR + HB_RESET_LOG_EEPROM_SIZE - 1, NUM_SLOTS),
+        EEPROM_QUEUE_INIT_ERROR);
+    ASSERT_FALSE(eeprom_enqueue(&queue, data));
+
+    erase_slots();
+    ASSERT_EQ(init_eeprom_queue(&queue, EEPROM_QUEUE_DEF_ADDR, NUM_SLOTS), 0);
+    ASSERT_TRUE(eeprom_enqueue(&queue, data));
+    clear_eeprom_queue(&queue);
+}
+
+test_t t1 = { .name = "init", .fn = init_test };
+test_t t2 = { .name = "restore", .fn = restore_test };
+test_t t3 = { .name = "full", .fn = full_test };
+test_t t4 = { .name = "front", .fn = front_test };
+test_t t5 = { .name = "corrupt", .fn = corrupt_test };
+test_t t6 = { .name = "wear", .fn = wear_test };
+test_t t7 = { .name = "invalid", .fn = invalid_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5, &t6, &t7 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <test/test.h>
+#include <heartbeat/hb_reset_log.h>
+
+void set_default_policy(void) {
+    hb_reset_policy.backoff_s = 100;
+    hb_reset_policy.max_backoff_s = 300;
+    hb_reset_policy.max_resets = 3;
+    hb_reset_policy.window_s = 1000;
+}
+
+void log_test(void) {
+    hb_reset_log_entry_t entry;
+
+    clear_hb_reset_log();
+    ASSERT_EQ(hb_reset_log_count(), 0);
+    ASSERT_EQ(read_hb_reset_log(0, &entry), 0);
+
+    for (uint8_t i = 0; i < 3; i++) {
+        entry.uptime_s = 1000 + i;
+        entry.peer_id = i;
+        entry.reason = HB_RESET_REASON_NO_RESP;
+        entry.peer_restart_count = 50 + i;
+        log_hb_reset(&entry);
+    }
+    ASSERT_EQ(hb_reset_log_count(), 3);
+
+    ASSERT_EQ(read_hb_reset_log(0, &entry), 1);
+    ASSERT_EQ(entry.uptime_s, 1000);
+    ASSERT_EQ(entry.peer_id, 0);
+    ASSERT_EQ(entry.reason, HB_RESET_REASON_NO_RESP);
+    ASSERT_EQ(entry.peer_restart_count, 50);
+
+    ASSERT_EQ(read_hb_reset_log(2, &entry), 1);
+    ASSERT_EQ(entry.uptime_s, 1002);
+    ASSERT_EQ(entry.peer_id, 2);
+    ASSERT_EQ(entry.peer_restart_count, 52);
+    ASSERT_EQ(read_hb_reset_log(3, &entry), 0);
+}
+
+void log_wrap_test(void) {
+    hb_reset_log_entry_t entry;
+
+    clear_hb_reset_log();
+    for (uint8_t i = 0; i < HB_RESET_LOG_SIZE + 5; i++) {
+        entry.uptime_s = i;
+        entry.peer_id = 1;
+        entry.reason = HB_RESET_REASON_MOB_BUSY;
+        entry.peer_restart_count = i;
+        log_hb_reset(&entry);
+    }
+    ASSERT_EQ(hb_reset_log_count(), HB_RESET_LOG_SIZE);
+
+    // The 5 oldest entries were overwritten
+    ASSERT_EQ(read_hb_reset_log(0, &entry), 1);
+    ASSERT_EQ(entry.uptime_s, 5);
+    ASSERT_EQ(read_hb_reset_log(HB_RESET_LOG_SIZE - 1, &entry), 1);
+    ASSERT_EQ(entry.uptime_s, HB_RESET_LOG_SIZE + 4);
+
+    clear_hb_reset_log();
+    ASSERT_EQ(hb_reset_log_count(), 0);
+}
+
+void backoff_test(void) {
+    set_default_policy();
+    hb_reset_policy.max_resets = 10;
+    hb_reset_state_t state = { 0 };
+
+    ASSERT_TRUE(hb_reset_allowed(&state, 10));
+    // Must wait 100s
+    ASSERT_FALSE(hb_reset_allowed(&state, 50));
+    ASSERT_FALSE(hb_reset_allowed(&state, 109));
+    ASSERT_TRUE(hb_reset_allowed(&state, 110));
+    // Must wait 200s
+    ASSERT_FALSE(hb_reset_allowed(&state, 300));
+    ASSERT_TRUE(hb_reset_allowed(&state, 310));
+    // Limited to 300s
+    ASSERT_FALSE(hb_reset_allowed(&state, 600));
+    ASSERT_TRUE(hb_reset_allowed(&state, 610));
+    ASSERT_FALSE(hb_reset_allowed(&state, 900));
+    ASSERT_TRUE(hb_reset_allowed(&state, 910));
+
+    // The peer answered, the next reset is allowed right away
+    clear_hb_reset_backoff(&state);
+    ASSERT_TRUE(hb_reset_allowed(&state, 920));
+    ASSERT_FALSE(hb_reset_allowed(&state, 1000));
+}
+
+void window_test(void) {
+    set_default_policy();
+    hb_reset_policy.backoff_s = 0;
+    hb_reset_policy.max_backoff_s = 0;
+    hb_reset_state_t state = { 0 };
+
+    ASSERT_TRUE(hb_reset_allowed(&state, 100));
+    ASSERT_TRUE(hb_reset_allowed(&state, 200));
+    ASSERT_TRUE(hb_reset_allowed(&state, 300));
+    // Only report until the window ends
+    ASSERT_FALSE(hb_reset_allowed(&state, 400));
+    ASSERT_FALSE(hb_reset_allowed(&state, 1099));
+    ASSERT_EQ(state.window_resets, 3);
+
+    // New window
+    ASSERT_TRUE(hb_reset_allowed(&state, 1100));
+    ASSERT_EQ(state.window_resets, 1);
+    ASSERT_EQ(state.window_start_s, 1100);
+}
+
+void queue_test(void) {
+    hb_reset_log_entry_t entry;
+
+    // Erased log
+    eeprom_update_word((uint16_t*) HB_RESET_LOG_EEPROM_ADDR, 0xFFFF);
+    ASSERT_EQ(hb_reset_log_count(), 0);
+    ASSERT_EQ(flush_hb_reset_log(), 0);
+
+    uint16_t dropped = hb_reset_log_dropped;
+    for (uint8_t i = 0; i < HB_RESET_LOG_PENDING_SIZE + 1; i++) {
+        entry.uptime_s = 2000 + i;
+        entry.peer_id = 2;
+        entry.reason = HB_RESET_REASON_NO_RESP;
+        entry.peer_restart_count = i;
+        queue_hb_reset_log(&entry);
+    }
+    ASSERT_EQ(hb_reset_log_dropped, dropped + 1);
+    // Nothing is written until flush_hb_reset_log() is called
+    ASSERT_EQ(hb_reset_log_count(), 0);
+
+    // At most one byte is written per call
+    uint16_t calls = 0;
+    while (flush_hb_reset_log() && calls < 1000) {
+        calls++;
+    }
+    ASSERT_TRUE(calls > HB_RESET_LOG_PENDING_SIZE);
+    ASSERT_EQ(flush_hb_reset_log(), 0);
+
+    ASSERT_EQ(hb_reset_log_count(), HB_RESET_LOG_PENDING_SIZE);
+    ASSERT_EQ(read_hb_reset_log(0, &entry), 1);
+    ASSERT_EQ(entry.uptime_s, 2000);
+    ASSERT_EQ(read_hb_reset_log(HB_RESET_LOG_PENDING_SIZE - 1, &entry), 1);
+    ASSERT_EQ(entry.uptime_s, 2000 + HB_RESET_LOG_PENDING_SIZE - 1);
+    ASSERT_EQ(entry.peer_id, 2);
+
+    clear_hb_reset_log();
+}
+
+test_t t1 = { .name = "log", .fn = log_test };
+test_t t2 = { .name = "log wrap", .fn = log_wrap_test };
+test_t t3 = { .name = "backoff", .fn = backoff_test };
+test_t t4 = { .name = "window", .fn = window_test };
+test_t t5 = { .name = "queue", .fn = queue_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
@@ -0,0 +1,358 @@
+#include <test/test.h>
+#include <can/hk_fields.h>
+#include <can/hk_packed.h>
+#include <can/hk_delta.h>
+
+uint32_t get_uptime(void) {
+    return 0x12345678;
+}
+
+uint32_t get_bat_vol(void) {
+    // Only the low 12 bits are valid
+    return 0xFABC;
+}
+
+uint32_t get_gyro(void) {
+    return 0xBEEF;
+}
+
+uint32_t get_therm(void) {
+    return 0x0123;
+}
+
+const hk_get_fn_t eps_getters[CAN_EPS_HK_FIELD_COUNT] PROGMEM = {
+    [CAN_EPS_HK_UPTIME] = get_uptime,
+    [CAN_EPS_HK_BAT_VOL] = get_bat_vol,
+    [CAN_EPS_HK_BAT_TEMP1] = get_therm,
+    [CAN_EPS_HK_BAT_TEMP2] = get_therm,
+    [CAN_EPS_HK_GYR_CAL_X] = get_gyro,
+    [CAN_EPS_HK_GYR_CAL_Z] = get_gyro,
+};
+
+void get_table_test(void) {
+    ASSERT_TRUE(get_hk_table(CAN_EPS_HK) == &eps_hk_table);
+    ASSERT_TRUE(get_hk_table(CAN_PAY_HK) == &pay_hk_table);
+    ASSERT_TRUE(get_hk_table(CAN_PAY_OPT) == &pay_opt_table);
+    ASSERT_TRUE(get_hk_table(CAN_EPS_CTRL) == NULL);
+
+    ASSERT_EQ(eps_hk_table.count, CAN_EPS_HK_FIELD_COUNT);
+    ASSERT_EQ(pay_hk_table.count, CAN_PAY_HK_FIELD_COUNT);
+    ASSERT_EQ(pay_opt_table.count, CAN_PAY_OPT_TOT_FIELD_COUNT);
+}
+
+void get_field_test(void) {
+    hk_field_desc_t desc;
+
+    ASSERT_TRUE(get_hk_field(&eps_hk_table, CAN_EPS_HK_GYR_CAL_Z, &desc));
+    ASSERT_EQ(desc.field_num, CAN_EPS_HK_GYR_CAL_Z);
+    ASSERT_EQ(desc.width, 16);
+    ASSERT_EQ(desc.unit, HK_UNIT_DPS);
+
+    ASSERT_TRUE(get_hk_field(&pay_hk_table, CAN_PAY_HK_PRES, &desc));
+    ASSERT_EQ(desc.field_num, CAN_PAY_HK_PRES);
+    ASSERT_EQ(desc.width, 24);
+    ASSERT_EQ(desc.unit, HK_UNIT_KPA);
+
+    // Every field in the table must be described at its own index
+    for (uint8_t i = 0; i < CAN_PAY_HK_FIELD_COUNT; i++) {
+        get_hk_field(&pay_hk_table, i, &desc);
+        ASSERT_GREATER(desc.width, 0);
+    }
+
+    // Uniform table
+    ASSERT_TRUE(get_hk_field(&pay_opt_table, 0x3F, &desc));
+    ASSERT_EQ(desc.field_num, 0x3F);
+    ASSERT_EQ(desc.width, 24);
+
+    ASSERT_FALSE(get_hk_field(&eps_hk_table, CAN_EPS_HK_FIELD_COUNT, &desc));
+    ASSERT_FALSE(get_hk_field(&pay_opt_table, CAN_PAY_OPT_TOT_FIELD_COUNT, &desc));
+}
+
+void convert_test(void) {
+    // No conversion
+    ASSERT_FP_EQ(convert_hk_field(&eps_hk_table, CAN_EPS_HK_UPTIME, 100), 100.0);
+    // Same as the conversion library
+    ASSERT_FP_EQ(convert_hk_field(&eps_hk_table, CAN_EPS_HK_BAT_TEMP1, 0x400),
+        adc_raw_to_therm_temp(0x400));
+    ASSERT_FP_EQ(convert_hk_field(&pay_hk_table, CAN_PAY_HK_HUM, 0x2000),
+        hum_raw_data_to_humidity(0x2000));
+}
+
+void encode_decode_test(void) {
+    uint8_t msg[CAN_MSG_LEN] = { 0 };
+    uint8_t field_num = 0;
+    uint32_t raw = 0;
+
+    ASSERT_EQ(encode_hk_msg(&eps_hk_table, CAN_EPS_HK_5V_CUR, 0x1ABC, msg),
+        CAN_STATUS_OK);
+    ASSERT_EQ(msg[CAN_MSG_TYPE_IDX], CAN_EPS_HK);
+    ASSERT_EQ(msg[CAN_MSG_FIELD_IDX], CAN_EPS_HK_5V_CUR);
+    ASSERT_EQ(msg[CAN_MSG_STATUS_IDX], CAN_STATUS_OK);
+    // Truncated to 12 bits
+    ASSERT_EQ(msg[CAN_MSG_DATA_IDX + 2], 0x0A);
+    ASSERT_EQ(msg[CAN_MSG_DATA_IDX + 3], 0xBC);
+
+    ASSERT_EQ(decode_hk_msg(&eps_hk_table, msg, &field_num, &raw), CAN_STATUS_OK);
+    ASSERT_EQ(field_num, CAN_EPS_HK_5V_CUR);
+    ASSERT_EQ(raw, 0xABC);
+
+    // Wrong table for the message type
+    ASSERT_EQ(decode_hk_msg(&pay_hk_table, msg, &field_num, &raw),
+        CAN_STATUS_INVALID_OPCODE);
+
+    ASSERT_EQ(encode_hk_msg(&eps_hk_table, CAN_EPS_HK_FIELD_COUNT, 5, msg),
+        CAN_STATUS_INVALID_FIELD_NUM);
+    ASSERT_EQ(msg[CAN_MSG_STATUS_IDX], CAN_STATUS_INVALID_FIELD_NUM);
+    ASSERT_EQ(decode_hk_msg(&eps_hk_table, msg, &field_num, &raw),
+        CAN_STATUS_INVALID_FIELD_NUM);
+}
+
+void dispatch_test(void) {
+    uint8_t req[CAN_MSG_LEN] = { CAN_EPS_HK, CAN_EPS_HK_UPTIME, 0, 0, 0, 0, 0, 0 };
+    uint8_t resp[CAN_MSG_LEN] = { 0 };
+    uint8_t field_num = 0;
+    uint32_t raw = 0;
+
+    ASSERT_EQ(dispatch_hk_req(&eps_hk_table, eps_getters, req, resp), CAN_STATUS_OK);
+    ASSERT_EQ(decode_hk_msg(&eps_hk_table, resp, &field_num, &raw), CAN_STATUS_OK);
+    ASSERT_EQ(field_num, CAN_EPS_HK_UPTIME);
+    ASSERT_EQ(raw, 0x12345678);
+
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_HK_BAT_VOL;
+    ASSERT_EQ(dispatch_hk_req(&eps_hk_table, eps_getters, req, resp), CAN_STATUS_OK);
+    ASSERT_EQ(decode_hk_msg(&eps_hk_table, resp, &field_num, &raw), CAN_STATUS_OK);
+    ASSERT_EQ(raw, 0xABC);
+
+    // No getter
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_HK_BAT_CUR;
+    ASSERT_EQ(dispatch_hk_req(&eps_hk_table, eps_getters, req, resp),
+        CAN_STATUS_INVALID_FIELD_NUM);
+
+    // Out of range
+    req[CAN_MSG_FIELD_IDX] = 0xFF;
+    ASSERT_EQ(dispatch_hk_req(&eps_hk_table, eps_getters, req, resp),
+        CAN_STATUS_INVALID_FIELD_NUM);
+}
+
+void bulk_req_test(void) {
+    uint8_t req[CAN_MSG_LEN] = { 0 };
+    uint8_t first = 0;
+    uint8_t last = 0;
+
+    encode_hk_bulk_req(&eps_hk_table, 0x03, 0x0D, req);
+    ASSERT_EQ(req[CAN_MSG_TYPE_IDX], CAN_EPS_HK);
+    ASSERT_EQ(req[CAN_MSG_FIELD_IDX], CAN_HK_BULK_REQ);
+    ASSERT_FALSE(is_hk_packed_frame(req));
+    ASSERT_EQ(decode_hk_bulk_req(&eps_hk_table, req, &first, &last), CAN_STATUS_OK);
+    ASSERT_EQ(first, 0x03);
+    ASSERT_EQ(last, 0x0D);
+
+    ASSERT_EQ(decode_hk_bulk_req(&pay_hk_table, req, &first, &last),
+        CAN_STATUS_INVALID_OPCODE);
+
+    encode_hk_bulk_req(&eps_hk_table, 0x05, CAN_EPS_HK_FIELD_COUNT, req);
+    ASSERT_EQ(decode_hk_bulk_req(&eps_hk_table, req, &first, &last),
+        CAN_STATUS_INVALID_FIELD_NUM);
+    encode_hk_bulk_req(&eps_hk_table, 0x05, 0x04, req);
+    ASSERT_EQ(decode_hk_bulk_req(&eps_hk_table, req, &first, &last),
+        CAN_STATUS_INVALID_FIELD_NUM);
+}
+
+void pack_frame_test(void) {
+    uint8_t frame[CAN_MSG_LEN] = { 0 };
+    uint32_t values[CAN_EPS_HK_FIELD_COUNT] = { 0 };
+
+    // 4 x 12 bits fit exactly in one frame
+    ASSERT_EQ(pack_hk_frame(&eps_hk_table, eps_getters,
+        CAN_EPS_HK_BAT_TEMP1, CAN_EPS_HK_HEAT2_SP, frame), 4);
+    ASSERT_TRUE(is_hk_packed_frame(frame));
+    ASSERT_EQ(frame[CAN_MSG_TYPE_IDX], CAN_EPS_HK);
+    ASSERT_EQ(frame[CAN_MSG_FIELD_IDX], CAN_HK_PACKED_FLAG | CAN_EPS_HK_BAT_TEMP1);
+    ASSERT_EQ(frame[2], 0x12);
+    ASSERT_EQ(frame[3], 0x31);
+    ASSERT_EQ(frame[4], 0x23);
+
+    ASSERT_EQ(unpack_hk_frame(&eps_hk_table, frame, CAN_EPS_HK_HEAT2_SP, values), 4);
+    ASSERT_EQ(values[CAN_EPS_HK_BAT_TEMP1], 0x123);
+    ASSERT_EQ(values[CAN_EPS_HK_BAT_TEMP2], 0x123);
+    ASSERT_EQ(values[CAN_EPS_HK_HEAT1_SP], 0);
+
+    // 3 x 16 bits
+    ASSERT_EQ(pack_hk_frame(&eps_hk_table, eps_getters,
+        CAN_EPS_HK_GYR_UNCAL_X, CAN_EPS_HK_GYR_CAL_Z, frame), 3);
+    ASSERT_EQ(pack_hk_frame(&eps_hk_table, eps_getters,
+        CAN_EPS_HK_GYR_CAL_X, CAN_EPS_HK_GYR_CAL_Z, frame), 3);
+    ASSERT_EQ(unpack_hk_frame(&eps_hk_table, frame, CAN_EPS_HK_GYR_CAL_Z, values), 3);
+    ASSERT_EQ(values[CAN_EPS_HK_GYR_CAL_X], 0xBEEF);
+    ASSERT_EQ(values[CAN_EPS_HK_GYR_CAL_Y], 0);
+    ASSERT_EQ(values[CAN_EPS_HK_GYR_CAL_Z], 0xBEEF);
+
+    // Stops at the last requested field
+    ASSERT_EQ(pack_hk_frame(&eps_hk_table, eps_getters,
+        CAN_EPS_HK_GYR_CAL_Z, CAN_EPS_HK_GYR_CAL_Z, frame), 1);
+    ASSERT_EQ(unpack_hk_frame(&eps_hk_table, frame, CAN_EPS_HK_GYR_CAL_Z, values), 1);
+
+    // Not a packed frame
+    encode_hk_msg(&eps_hk_table, CAN_EPS_HK_UPTIME, 0, frame);
+    ASSERT_EQ(unpack_hk_frame(&eps_hk_table, frame, CAN_EPS_HK_UPTIME, values), 0);
+}
+
+void full_sweep_test(void) {
+    uint8_t frame[CAN_MSG_LEN] = { 0 };
+    uint32_t values[CAN_EPS_HK_FIELD_COUNT] = { 0 };
+    uint8_t last = CAN_EPS_HK_FIELD_COUNT - 1;
+
+    uint8_t frames = 0;
+    uint8_t first = 0;
+    while (first <= last) {
+        uint8_t count = pack_hk_frame(&eps_hk_table, eps_getters, first, last, frame);
+        ASSERT_GREATER(count, 0);
+        ASSERT_EQ(unpack_hk_frame(&eps_hk_table, frame, last, values), count);
+        first += count;
+        frames++;
+    }
+
+    ASSERT_EQ(frames, count_hk_frames(&eps_hk_table, 0, last));
+    // Much fewer frames than one request and one response per field
+    ASSERT_LESS(frames, CAN_EPS_HK_FIELD_COUNT / 2);
+
+    ASSERT_EQ(values[CAN_EPS_HK_UPTIME], 0x12345678);
+    ASSERT_EQ(values[CAN_EPS_HK_BAT_VOL], 0xABC);
+    ASSERT_EQ(values[CAN_EPS_HK_BAT_TEMP2], 0x123);
+    ASSERT_EQ(values[CAN_EPS_HK_GYR_CAL_Z], 0xBEEF);
+}
+
+void delta_round_trip_test(void) {
+    uint32_t enc_last[CAN_EPS_HK_FIELD_COUNT];
+    uint32_t dec_last[CAN_EPS_HK_FIELD_COUNT];
+    hk_delta_t enc;
+    hk_delta_t dec;
+    init_hk_delta(&enc, enc_last, CAN_EPS_HK_FIELD_COUNT, 4);
+    init_hk_delta(&dec, dec_last, CAN_EPS_HK_FIELD_COUNT, 4);
+
+    uint32_t values[CAN_EPS_HK_FIELD_COUNT];
+    uint32_t decoded[CAN_EPS_HK_FIELD_COUNT];
+    uint8_t buf[HK_DELTA_MAX_LEN(CAN_EPS_HK_FIELD_COUNT)];
+    for (uint8_t i = 0; i < CAN_EPS_HK_FIELD_COUNT; i++) {
+        values[i] = 0x800 + i;
+    }
+    values[CAN_EPS_HK_UPTIME] = 0x12345678;
+
+    for (uint8_t record = 0; record < 10; record++) {
+        uint16_t len = encode_hk_delta(&enc, values, buf, sizeof(buf));
+        ASSERT_GREATER(len, 0);
+        // Keyframe every 4 records
+        ASSERT_EQ((buf[0] & HK_DELTA_KEYFRAME_FLAG) ? 1 : 0,
+            (record % 4 == 0) ? 1 : 0);
+        ASSERT_EQ(decode_hk_delta(&dec, buf, len, decoded), HK_DELTA_OK);
+        for (uint8_t i = 0; i < CAN_EPS_HK_FIELD_COUNT; i++) {
+            ASSERT_EQ(decoded[i], values[i]);
+        }
+
+        // Small changes up and down, including wrapping around 0
+        values[CAN_EPS_HK_UPTIME] += 1;
+        values[CAN_EPS_HK_BAT_VOL] -= 3;
+        values[CAN_EPS_HK_GYR_CAL_X] = (record % 2) ? 0 : 0xFFFFFFFF;
+    }
+}
+
+void delta_size_test(void) {
+    uint32_t enc_last[CAN_EPS_HK_FIELD_COUNT];
+    hk_delta_t enc;
+    init_hk_delta(&enc, enc_last, CAN_EPS_HK_FIELD_COUNT, HK_DELTA_DEF_KEYFRAME_PERIOD);
+
+    uint32_t values[CAN_EPS_HK_FIELD_COUNT] = { 0 };
+    uint8_t buf[HK_DELTA_MAX_LEN(CAN_EPS_HK_FIELD_COUNT)];
+
+    // All zero keyframe - header and one run
+    ASSERT_EQ(encode_hk_delta(&enc, values, buf, sizeof(buf)), 2);
+    ASSERT_EQ(buf[0], HK_DELTA_KEYFRAME_FLAG | 0);
+    ASSERT_EQ(buf[1], HK_DELTA_TOKEN_RUN | CAN_EPS_HK_FIELD_COUNT);
+
+    // Nothing changed
+    ASSERT_EQ(encode_hk_delta(&enc, values, buf, sizeof(buf)), 2);
+    ASSERT_EQ(buf[0], 1);
+
+    // One field changes by +1 (zigzag 2) and one by -1 (zigzag 1)
+    values[0] = 1;
+    values[2] = 0xFFFFFFFF;
+    ASSERT_EQ(encode_hk_delta(&enc, values, buf, sizeof(buf)), 5);
+    ASSERT_EQ(buf[1], 2);
+    ASSERT_EQ(buf[2], HK_DELTA_TOKEN_RUN | 1);
+    ASSERT_EQ(buf[3], 1);
+    ASSERT_EQ(buf[4], HK_DELTA_TOKEN_RUN | (CAN_EPS_HK_FIELD_COUNT - 3));
+
+    // Too small a buffer leaves the state unchanged
+    values[0] = 0x12345678;
+    ASSERT_EQ(encode_hk_delta(&enc, values, buf, 3), 0);
+    ASSERT_EQ(enc.seq, 3);
+    ASSERT_EQ(enc_last[0], 1);
+    ASSERT_GREATER(encode_hk_delta(&enc, values, buf, sizeof(buf)), 3);
+    ASSERT_EQ(enc.seq, 4);
+}
+
+void delta_resync_test(void) {
+    uint32_t enc_last[CAN_EPS_HK_FIELD_COUNT];
+    uint32_t dec_last[CAN_EPS_HK_FIELD_COUNT];
+    hk_delta_t enc;
+    hk_delta_t dec;
+    init_hk_delta(&enc, enc_last, CAN_EPS_HK_FIELD_COUNT, 0);
+    init_hk_delta(&dec, dec_last, CAN_EPS_HK_FIELD_COUNT, 0);
+
+    uint32_t values[CAN_EPS_HK_FIELD_COUNT] = { 0 };
+    uint32_t decoded[CAN_EPS_HK_FIELD_COUNT];
+    uint8_t buf[HK_DELTA_MAX_LEN(CAN_EPS_HK_FIELD_COUNT)];
+    uint16_t len;
+
+    len = encode_hk_delta(&enc, values, buf, sizeof(buf));
+    ASSERT_EQ(decode_hk_delta(&dec, buf, len, decoded), HK_DELTA_OK);
+
+    // Lose a record
+    values[1] = 5;
+    encode_hk_delta(&enc, values, buf, sizeof(buf));
+    values[1] = 6;
+    len = encode_hk_delta(&enc, values, buf, sizeof(buf));
+    ASSERT_EQ(decode_hk_delta(&dec, buf, len, decoded), HK_DELTA_NEED_KEYFRAME);
+    // Still out of sync until a keyframe
+    len = encode_hk_delta(&enc, values, buf, sizeof(buf));
+    ASSERT_EQ(decode_hk_delta(&dec, buf, len, decoded), HK_DELTA_NEED_KEYFRAME);
+
+    // Period 0 only sends a keyframe when forced
+    force_hk_keyframe(&enc);
+    len = encode_hk_delta(&enc, values, buf, sizeof(buf));
+    ASSERT_EQ(decode_hk_delta(&dec, buf, len, decoded), HK_DELTA_OK);
+    ASSERT_EQ(decoded[1], 6);
+
+    // Malformed records
+    ASSERT_EQ(decode_hk_delta(&dec, buf, 0, decoded), HK_DELTA_INVALID);
+    uint8_t truncated[] = { HK_DELTA_KEYFRAME_FLAG, HK_DELTA_TOKEN_CONT };
+    ASSERT_EQ(decode_hk_delta(&dec, truncated, sizeof(truncated), decoded),
+        HK_DELTA_INVALID);
+    uint8_t long_run[] = { HK_DELTA_KEYFRAME_FLAG,
+        HK_DELTA_TOKEN_RUN | (CAN_EPS_HK_FIELD_COUNT + 1) };
+    ASSERT_EQ(decode_hk_delta(&dec, long_run, sizeof(long_run), decoded),
+        HK_DELTA_INVALID);
+    uint8_t extra[] = { HK_DELTA_KEYFRAME_FLAG,
+        HK_DELTA_TOKEN_RUN | CAN_EPS_HK_FIELD_COUNT, 0 };
+    ASSERT_EQ(decode_hk_delta(&dec, extra, sizeof(extra), decoded),
+        HK_DELTA_INVALID);
+}
+
+test_t t1 = { .name = "get table", .fn = get_table_test };
+test_t t2 = { .name = "get field", .fn = get_field_test };
+test_t t3 = { .name = "convert", .fn = convert_test };
+test_t t4 = { .name = "encode/decode", .fn = encode_decode_test };
+test_t t5 = { .name = "dispatch", .fn = dispatch_test };
+test_t t6 = { .name = "bulk request", .fn = bulk_req_test };
+test_t t7 = { .name = "pack frame", .fn = pack_frame_test };
+test_t t8 = { .name = "full sweep", .fn = full_sweep_test };
+test_t t9 = { .name = "delta round trip", .fn = delta_round_trip_test };
+test_t t10 = { .name = "delta size", .fn = delta_size_test };
+test_t t11 = { .name = "delta resync", .fn = delta_resync_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, &t10, &t11 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
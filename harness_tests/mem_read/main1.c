@@ -0,0 +1,170 @@
+#include <test/test.h>
+#include <can/mem_read.h>
+
+#define EEPROM_ADDR 0x300
+#define EEPROM_LEN  23
+
+const uint8_t flash_data[12] PROGMEM = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB
+};
+
+uint8_t sram_data[7] = { 1, 2, 3, 4, 5, 6, 7 };
+
+mem_read_t read;
+
+void make_req(uint8_t space, uint8_t window, uint16_t addr, uint16_t len,
+        uint8_t* req) {
+    req[CAN_MSG_TYPE_IDX] = CAN_EPS_CTRL;
+    req[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_READ_MEM_BLOCK;
+    req[CAN_MEM_SPACE_IDX] = space;
+    req[CAN_MEM_WINDOW_IDX] = window;
+    req[CAN_MSG_DATA_IDX + 0] = (addr >> 8) & 0xFF;
+    req[CAN_MSG_DATA_IDX + 1] = addr & 0xFF;
+    req[CAN_MSG_DATA_IDX + 2] = (len >> 8) & 0xFF;
+    req[CAN_MSG_DATA_IDX + 3] = len & 0xFF;
+}
+
+void make_ack(uint16_t count, uint8_t flags, uint8_t* ack) {
+    ack[CAN_MSG_TYPE_IDX] = CAN_EPS_CTRL;
+    ack[CAN_MSG_FIELD_IDX] = CAN_EPS_CTRL_READ_MEM_DATA;
+    ack[CAN_MEM_ACK_FLAGS_IDX] = flags;
+    ack[CAN_MSG_DATA_IDX + 0] = (count >> 8) & 0xFF;
+    ack[CAN_MSG_DATA_IDX + 1] = count & 0xFF;
+}
+
+// Reads a whole region with a large window, checking contents and CRC
+void read_region(uint8_t space, uint16_t addr, uint16_t len,
+        const uint8_t* expected) {
+    uint8_t req[8];
+    uint8_t resp[8];
+    uint8_t frame[8];
+    uint8_t ack[8];
+
+    make_req(space, 0xFF, addr, len, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_OK);
+    uint16_t data_frames = resp[CAN_MSG_DATA_IDX + 2] << 8 |
+        resp[CAN_MSG_DATA_IDX + 3];
+    ASSERT_EQ(data_frames, MEM_READ_DATA_FRAMES(len));
+
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < data_frames; i++) {
+        ASSERT_TRUE(next_mem_read_frame(&read, frame));
+        ASSERT_EQ(frame[CAN_MSG_FIELD_IDX], CAN_EPS_CTRL_READ_MEM_DATA);
+        ASSERT_EQ(frame[CAN_MEM_SEQ_IDX], i & 0xFF);
+        for (uint8_t j = 0; j < CAN_MEM_FRAME_DATA_LEN; j++) {
+            uint16_t offset = i * CAN_MEM_FRAME_DATA_LEN + j;
+            uint8_t byte = frame[CAN_MEM_FRAME_DATA_IDX + j];
+            if (offset < len) {
+                ASSERT_EQ(byte, expected[offset]);
+                crc = _crc_ccitt_update(crc, byte);
+            } else {
+                ASSERT_EQ(byte, 0);
+            }
+        }
+    }
+
+    // CRC frame
+    ASSERT_TRUE(next_mem_read_frame(&read, frame));
+    ASSERT_EQ(frame[CAN_MEM_SEQ_IDX], data_frames & 0xFF);
+    ASSERT_EQ(frame[CAN_MEM_FRAME_DATA_IDX + 0], (crc >> 8) & 0xFF);
+    ASSERT_EQ(frame[CAN_MEM_FRAME_DATA_IDX + 1], crc & 0xFF);
+    ASSERT_FALSE(next_mem_read_frame(&read, frame));
+
+    make_ack(data_frames + 1, 0, ack);
+    ack_mem_read(&read, ack);
+    ASSERT_FALSE(read.active);
+}
+
+void eeprom_test(void) {
+    uint8_t expected[EEPROM_LEN];
+    for (uint8_t i = 0; i < EEPROM_LEN; i++) {
+        expected[i] = i * 7 + 3;
+        eeprom_update_byte((uint8_t*) (EEPROM_ADDR + i), expected[i]);
+    }
+    read_region(CAN_MEM_EEPROM, EEPROM_ADDR, EEPROM_LEN, expected);
+}
+
+void flash_test(void) {
+    uint8_t expected[sizeof(flash_data)];
+    memcpy_P(expected, flash_data, sizeof(flash_data));
+    read_region(CAN_MEM_FLASH, (uint16_t) flash_data, sizeof(flash_data),
+        expected);
+}
+
+void sram_test(void) {
+    read_region(CAN_MEM_SRAM, (uint16_t) sram_data, sizeof(sram_data),
+        sram_data);
+}
+
+void window_test(void) {
+    uint8_t req[8];
+    uint8_t resp[8];
+    uint8_t frame[8];
+    uint8_t ack[8];
+
+    // 4 data frames + CRC frame, 2 frames at a time
+    make_req(CAN_MEM_EEPROM, 2, EEPROM_ADDR, 20, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_OK);
+
+    ASSERT_TRUE(next_mem_read_frame(&read, frame));
+    ASSERT_TRUE(next_mem_read_frame(&read, frame));
+    ASSERT_FALSE(next_mem_read_frame(&read, frame));
+
+    make_ack(1, 0, ack);
+    ack_mem_read(&read, ack);
+    ASSERT_TRUE(next_mem_read_frame(&read, frame));
+    ASSERT_EQ(frame[CAN_MEM_SEQ_IDX], 2);
+    ASSERT_FALSE(next_mem_read_frame(&read, frame));
+
+    // Can't acknowledge frames that were not sent
+    make_ack(4, 0, ack);
+    ack_mem_read(&read, ack);
+    ASSERT_FALSE(next_mem_read_frame(&read, frame));
+
+    // Frame 2 was lost, go back
+    make_ack(2, CAN_MEM_ACK_RESEND, ack);
+    ack_mem_read(&read, ack);
+    ASSERT_TRUE(next_mem_read_frame(&read, frame));
+    ASSERT_EQ(frame[CAN_MEM_SEQ_IDX], 2);
+    ASSERT_EQ(frame[CAN_MEM_FRAME_DATA_IDX], 2 * 5 * 7 + 3);
+
+    // Cancel
+    make_req(CAN_MEM_EEPROM, 2, EEPROM_ADDR, 0, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_OK);
+    ASSERT_FALSE(next_mem_read_frame(&read, frame));
+}
+
+void invalid_test(void) {
+    uint8_t req[8];
+    uint8_t resp[8];
+
+    make_req(CAN_MEM_EEPROM, 0, E2END, 2, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_INVALID_DATA);
+    ASSERT_EQ(resp[CAN_MSG_STATUS_IDX], CAN_STATUS_INVALID_DATA);
+    ASSERT_FALSE(read.active);
+
+    make_req(0x03, 0, 0, 1, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_INVALID_DATA);
+
+    // Registers and I/O space
+    make_req(CAN_MEM_SRAM, 0, RAMSTART - 1, 2, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_INVALID_DATA);
+
+    make_req(CAN_MEM_EEPROM, 0, E2END, 1, req);
+    ASSERT_EQ(start_mem_read(&read, req, resp), CAN_STATUS_OK);
+    ASSERT_EQ(read.window, MEM_READ_DEF_WINDOW);
+}
+
+test_t t1 = { .name = "eeprom", .fn = eeprom_test };
+test_t t2 = { .name = "flash", .fn = flash_test };
+test_t t3 = { .name = "sram", .fn = sram_test };
+test_t t4 = { .name = "window", .fn = window_test };
+test_t t5 = { .name = "invalid", .fn = invalid_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5 };
+
+int main(void) {
+    init_mem_read(&read, CAN_EPS_CTRL, CAN_EPS_CTRL_READ_MEM_DATA);
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
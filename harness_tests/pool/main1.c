@@ -0,0 +1,129 @@
+#include <test/test.h>
+#include <pool/pool.h>
+#include <queue/declare_queue.h>
+
+#define NUM_BLOCKS 4
+
+typedef struct {
+    uint8_t len;
+    uint8_t data[8];
+} frame_t;
+
+POOL_STORAGE(storage, sizeof(frame_t), NUM_BLOCKS);
+pool_t pool;
+
+// Handles of frames waiting to be sent
+DECLARE_QUEUE(tx_handles, uint8_t, NUM_BLOCKS)
+
+void init_test() {
+    init_pool(&pool, storage, sizeof(frame_t), NUM_BLOCKS);
+    ASSERT_EQ(pool_blocks_free(&pool), NUM_BLOCKS);
+    ASSERT_TRUE(get_pool_block(&pool, NUM_BLOCKS) == NULL);
+    ASSERT_TRUE(get_pool_block(&pool, POOL_NO_BLOCK) == NULL);
+}
+
+void alloc_free_test() {
+    init_pool(&pool, storage, sizeof(frame_t), NUM_BLOCKS);
+
+    uint8_t handles[NUM_BLOCKS];
+    for (uint8_t i = 0; i < NUM_BLOCKS; i++) {
+        handles[i] = alloc_pool_block(&pool);
+        ASSERT_NEQ(handles[i], POOL_NO_BLOCK);
+        ASSERT_EQ(pool_blocks_free(&pool), NUM_BLOCKS - i - 1);
+
+        // Each block is distinct and inside the storage
+        frame_t* frame = get_pool_block(&pool, handles[i]);
+        ASSERT_TRUE((uint8_t*) frame >= storage);
+        ASSERT_TRUE((uint8_t*) (frame + 1) <= storage + sizeof(storage));
+        frame->len = i;
+        for (uint8_t j = 0; j < i; j++) {
+            ASSERT_NEQ(handles[j], handles[i]);
+        }
+    }
+    ASSERT_EQ(alloc_pool_block(&pool), POOL_NO_BLOCK);
+
+    // Contents are not touched by other allocations
+    for (uint8_t i = 0; i < NUM_BLOCKS; i++) {
+        frame_t* frame = get_pool_block(&pool, handles[i]);
+        ASSERT_EQ(frame->len, i);
+    }
+
+    ASSERT_EQ(free_pool_block(&pool, handles[2]), 1);
+    ASSERT_EQ(pool_blocks_free(&pool), 1);
+    ASSERT_TRUE(get_pool_block(&pool, handles[2]) == NULL);
+    ASSERT_EQ(alloc_pool_block(&pool), handles[2]);
+
+    for (uint8_t i = 0; i < NUM_BLOCKS; i++) {
+        ASSERT_EQ(free_pool_block(&pool, handles[i]), 1);
+    }
+    ASSERT_EQ(pool_blocks_free(&pool), NUM_BLOCKS);
+
+    // Invalid handles are rejected
+    ASSERT_EQ(free_pool_block(&pool, POOL_NO_BLOCK), 0);
+    ASSERT_EQ(free_pool_block(&pool, NUM_BLOCKS), 0);
+    ASSERT_EQ(pool_blocks_free(&pool), NUM_BLOCKS);
+}
+
+void double_free_test() {
+    init_pool(&pool, storage, sizeof(frame_t), NUM_BLOCKS);
+
+    uint8_t a = alloc_pool_block(&pool);
+    uint8_t b = alloc_pool_block(&pool);
+    ASSERT_EQ(free_pool_block(&pool, a), 1);
+    // Freeing it again must not link it into the free list twice
+    ASSERT_EQ(free_pool_block(&pool, a), 0);
+    ASSERT_EQ(pool_blocks_free(&pool), NUM_BLOCKS - 1);
+
+    // All blocks can still be allocated exactly once
+    uint8_t seen[NUM_BLOCKS] = { 0 };
+    seen[b] = 1;
+    for (uint8_t i = 0; i < NUM_BLOCKS - 1; i++) {
+        uint8_t handle = alloc_pool_block(&pool);
+        ASSERT_NEQ(handle, POOL_NO_BLOCK);
+        if (handle < NUM_BLOCKS) {
+            ASSERT_EQ(seen[handle], 0);
+            seen[handle] = 1;
+        }
+    }
+    ASSERT_EQ(alloc_pool_block(&pool), POOL_NO_BLOCK);
+}
+
+void handle_queue_test() {
+    init_pool(&pool, storage, sizeof(frame_t), NUM_BLOCKS);
+    tx_handles_init();
+
+    // Receive frames into blocks, queue only the handles
+    for (uint8_t i = 0; i < 10; i++) {
+        uint8_t handle = alloc_pool_block(&pool);
+        ASSERT_NEQ(handle, POOL_NO_BLOCK);
+        frame_t* frame = get_pool_block(&pool, handle);
+        frame->len = 8;
+        for (uint8_t j = 0; j < 8; j++) {
+            frame->data[j] = i + j;
+        }
+        ASSERT_TRUE(tx_handles_enqueue(&handle));
+
+        // Keep up to 3 frames waiting, send the oldest one
+        if (i >= 2) {
+            ASSERT_TRUE(tx_handles_dequeue(&handle));
+            frame = get_pool_block(&pool, handle);
+            ASSERT_EQ(frame->data[0], i - 2);
+            ASSERT_EQ(frame->data[7], i - 2 + 7);
+            free_pool_block(&pool, handle);
+        }
+    }
+
+    ASSERT_EQ(tx_handles_size() + pool_blocks_free(&pool), NUM_BLOCKS);
+}
+
+test_t t1 = { .name = "init", .fn = init_test };
+test_t t2 = { .name = "alloc/free", .fn = alloc_free_test };
+test_t t3 = { .name = "double free", .fn = double_free_test };
+test_t t4 = { .name = "handle queue", .fn = handle_queue_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
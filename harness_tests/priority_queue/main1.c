@@ -0,0 +1,106 @@
+#include <test/test.h>
+#include <queue/priority_queue.h>
+
+priority_queue_t queue;
+
+// Sets the first byte of an element (the rest is the same)
+void make_elem(uint8_t* data, uint8_t id) {
+    for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+        data[i] = 0xA0 + i;
+    }
+    data[0] = id;
+}
+
+void init_test() {
+    init_priority_queue(&queue);
+    ASSERT_EQ(priority_queue_size(&queue), 0);
+    ASSERT_TRUE(priority_queue_empty(&queue));
+    ASSERT_FALSE(priority_queue_full(&queue));
+
+    uint8_t data[QUEUE_DATA_SIZE];
+    ASSERT_FALSE(peek_priority(&queue, NULL, data));
+    ASSERT_FALSE(dequeue_priority(&queue, NULL, data));
+}
+
+void order_test() {
+    uint32_t keys[] = { 50, 10, 40, 30, 20, 60, 5, 45 };
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    init_priority_queue(&queue);
+    for (uint8_t i = 0; i < 8; i++) {
+        make_elem(data, i);
+        ASSERT_TRUE(enqueue_priority(&queue, keys[i], data));
+    }
+    ASSERT_TRUE(priority_queue_full(&queue));
+    ASSERT_FALSE(enqueue_priority(&queue, 0, data));
+
+    uint32_t key = 0;
+    ASSERT_TRUE(peek_priority(&queue, &key, data));
+    ASSERT_EQ(key, 5);
+    ASSERT_EQ(data[0], 6);
+
+    uint32_t prev = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        ASSERT_TRUE(dequeue_priority(&queue, &key, data));
+        ASSERT_FALSE(key < prev);
+        prev = key;
+        // Data stays with its key
+        ASSERT_EQ(keys[data[0]], key);
+        ASSERT_EQ(data[QUEUE_DATA_SIZE - 1], 0xA0 + QUEUE_DATA_SIZE - 1);
+    }
+    ASSERT_TRUE(priority_queue_empty(&queue));
+}
+
+void stable_test() {
+    uint8_t data[QUEUE_DATA_SIZE];
+
+    init_priority_queue(&queue);
+    // Bulk work at priority 2, urgent commands at priority 0
+    for (uint8_t i = 0; i < 4; i++) {
+        make_elem(data, i);
+        ASSERT_TRUE(enqueue_priority(&queue, 2, data));
+    }
+    make_elem(data, 10);
+    ASSERT_TRUE(enqueue_priority(&queue, 0, data));
+    make_elem(data, 11);
+    ASSERT_TRUE(enqueue_priority(&queue, 0, data));
+
+    uint8_t expected[] = { 10, 11, 0, 1, 2, 3 };
+    for (uint8_t i = 0; i < 6; i++) {
+        ASSERT_TRUE(dequeue_priority(&queue, NULL, data));
+        ASSERT_EQ(data[0], expected[i]);
+    }
+}
+
+void mixed_test() {
+    uint8_t data[QUEUE_DATA_SIZE];
+    uint32_t key;
+
+    // Interleave inserts and removals so slots are reused
+    init_priority_queue(&queue);
+    for (uint8_t round = 0; round < 20; round++) {
+        for (uint8_t i = 0; i < 3; i++) {
+            make_elem(data, round * 3 + i);
+            ASSERT_TRUE(enqueue_priority(&queue, (round * 7 + i * 5) % 11, data));
+        }
+        for (uint8_t i = 0; i < 2; i++) {
+            ASSERT_TRUE(dequeue_priority(&queue, &key, data));
+            ASSERT_EQ((((data[0] / 3) * 7) + (data[0] % 3) * 5) % 11, key);
+        }
+        while (priority_queue_size(&queue) > 4) {
+            ASSERT_TRUE(dequeue_priority(&queue, NULL, NULL));
+        }
+    }
+}
+
+test_t t1 = { .name = "init", .fn = init_test };
+test_t t2 = { .name = "order", .fn = order_test };
+test_t t3 = { .name = "stable", .fn = stable_test };
+test_t t4 = { .name = "mixed", .fn = mixed_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include <test/test.h>
 #include <queue/queue.h>
+#include <queue/declare_queue.h>
+#include <queue/spsc_ring.h>
 
 #if MAX_QUEUE_SIZE != 5
 #undef MAX_QUEUE_SIZE
@@ -8,6 +10,16 @@
 
 queue_t queue;
 
+typedef struct {
+    uint16_t id;
+    uint32_t value;
+} item_t;
+
+// Power of two capacity (mask) and other capacity (comparison)
+DECLARE_QUEUE(item_queue, item_t, 4)
+DECLARE_QUEUE(byte_queue, uint8_t, 3)
+DECLARE_SPSC_RING(item_ring, item_t, 4)
+
 uint8_t r[] = { 0xf3, 0x25, 0xe3, 0x1d, 0x79, 0xff, 0x00, 0xaa };
 uint8_t s[] = { 0xaa, 0xbb, 0xcc, 0x11, 0x22, 0x33, 0x44, 0x55 };
 uint8_t t[] = { 0x01, 0xf2, 0x03, 0xb4, 0xc5, 0x06, 0xa7, 0x08 };
@@ -22,6 +34,7 @@ void init_queue_test() {
     // Verify that the queue is initialized correctly
     ASSERT_EQ(queue.head, 0);
     ASSERT_EQ(queue.tail, 0);
+    ASSERT_EQ(queue.size, 0);
     ASSERT_EQ(queue_size(&queue), 0);
 
     // Verify that the queue is empty
@@ -92,10 +105,6 @@ void dequeue_simple() {
         ASSERT_EQ(data[j], r[j]);
     }
 
-    for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
-        ASSERT_EQ(queue.content[0][j], 0);
-    }
-
     succ = dequeue(&queue, data);
     ASSERT_TRUE(succ);
 
@@ -107,10 +116,6 @@ void dequeue_simple() {
         ASSERT_EQ(data[j], s[j]);
     }
 
-    for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
-        ASSERT_EQ(queue.content[1][j], 0);
-    }
-
     succ = dequeue(&queue, data);
     ASSERT_FALSE(succ);
 }
@@ -133,17 +138,17 @@ void enqueue_front_advanced() {
         ASSERT_EQ(queue.content[queue.head][j], w[0][j]);
     }
 
-    // Test shifting
+    // Test wrapping around
     succ = enqueue_front(&queue, w[1]);
     ASSERT_TRUE(succ);
 
-    ASSERT_EQ(queue.head, 0);
-    ASSERT_EQ(queue.tail, 2);
+    ASSERT_EQ(queue.head, MAX_QUEUE_SIZE - 1);
+    ASSERT_EQ(queue.tail, 1);
     ASSERT_EQ(queue_size(&queue), 2);
 
     for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
         ASSERT_EQ(queue.content[queue.head][j], w[1][j]);
-        ASSERT_EQ(queue.content[queue.head + 1][j], w[0][j]);
+        ASSERT_EQ(queue.content[0][j], w[0][j]);
     }
 
     // Fill the queue
@@ -158,13 +163,12 @@ void enqueue_front_advanced() {
     for (uint8_t i = 0; i < MAX_QUEUE_SIZE; i ++) {
         succ = dequeue(&queue, data);
         ASSERT_TRUE(succ);
-        // Queue values set to empty
         for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
             ASSERT_EQ(data[j], w[MAX_QUEUE_SIZE - i - 1][j]);
-            ASSERT_EQ(queue.content[queue.head - 1][j], 0);
         }
     }
     ASSERT_EQ(queue_size(&queue), 0);
+    ASSERT_EQ(queue.head, queue.tail);
 }
 
 void is_empty_test() {
@@ -198,48 +202,279 @@ void mixed_test() {
     uint8_t empty = queue_empty(&queue);
     ASSERT_FALSE(empty);
 
-    for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
-        ASSERT_EQ(queue.content[0][j], 0);
-    }
-
     uint8_t succ = enqueue(&queue, r);
     ASSERT_TRUE(succ);
 
     uint8_t full = queue_full(&queue);
     ASSERT_TRUE(full);
 
+    // Elements come out in order even though the indices wrapped around
+    uint8_t data[QUEUE_DATA_SIZE] = { 0 };
     for (uint8_t i = 0; i < MAX_QUEUE_SIZE; i++) {
+        ASSERT_TRUE(dequeue(&queue, data));
         for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
-            ASSERT_EQ(queue.content[i][j], w[(i + 1) % MAX_QUEUE_SIZE][j]);
+            ASSERT_EQ(data[j], w[(i + 1) % MAX_QUEUE_SIZE][j]);
         }
     }
 
-    for (uint8_t i = 0; i < MAX_QUEUE_SIZE; i++) {
-        dequeue(&queue, NULL);
-    }
-
     empty = queue_empty(&queue);
     ASSERT_TRUE(empty);
 
-    ASSERT_EQ(queue.head, MAX_QUEUE_SIZE);
-    ASSERT_EQ(queue.tail, MAX_QUEUE_SIZE);
+    ASSERT_EQ(queue.head, queue.tail);
     ASSERT_EQ(queue_size(&queue), 0);
 
     succ = enqueue(&queue, r);
     ASSERT_TRUE(succ);
-
-    ASSERT_EQ(queue.head, 0);
-    ASSERT_EQ(queue.tail, 1);
     ASSERT_EQ(queue_size(&queue), 1);
 
     succ = enqueue_front(&queue, t);
     ASSERT_TRUE(succ);
+    ASSERT_EQ(queue_size(&queue), 2);
+
+    ASSERT_TRUE(peek_queue(&queue, data));
+    for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
+        ASSERT_EQ(data[j], t[j]);
+    }
+}
+
+void shift_left_test() {
+    // Queue has t then r, starting anywhere in the array
+    shift_queue_left(&queue);
 
     ASSERT_EQ(queue.head, 0);
     ASSERT_EQ(queue.tail, 2);
     ASSERT_EQ(queue_size(&queue), 2);
+
+    for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
+        ASSERT_EQ(queue.content[0][j], t[j]);
+        ASSERT_EQ(queue.content[1][j], r[j]);
+    }
+}
+
+void declare_queue_test() {
+    item_queue_init();
+    ASSERT_TRUE(item_queue_empty());
+    ASSERT_EQ(sizeof(item_queue.content), 4 * sizeof(item_t));
+
+    item_t item;
+    for (uint8_t round = 0; round < 3; round++) {
+        for (uint8_t i = 0; i < 4; i++) {
+            item.id = round * 4 + i;
+            item.value = 1000UL * item.id;
+            ASSERT_TRUE(item_queue_enqueue(&item));
+        }
+        ASSERT_TRUE(item_queue_full());
+        ASSERT_FALSE(item_queue_enqueue(&item));
+
+        for (uint8_t i = 0; i < 4; i++) {
+            ASSERT_TRUE(item_queue_dequeue(&item));
+            ASSERT_EQ(item.id, round * 4 + i);
+            ASSERT_EQ(item.value, 1000UL * item.id);
+        }
+        ASSERT_FALSE(item_queue_dequeue(&item));
+    }
+
+    item.id = 1;
+    ASSERT_TRUE(item_queue_enqueue(&item));
+    item.id = 2;
+    ASSERT_TRUE(item_queue_enqueue_front(&item));
+    ASSERT_TRUE(item_queue_peek(&item));
+    ASSERT_EQ(item.id, 2);
+    ASSERT_EQ(item_queue_size(), 2);
+
+    byte_queue_init();
+    for (uint8_t i = 0; i < 10; i++) {
+        ASSERT_TRUE(byte_queue_enqueue(&i));
+        ASSERT_TRUE(byte_queue_enqueue_front(&i));
+        uint8_t data = 0xFF;
+        ASSERT_TRUE(byte_queue_dequeue(&data));
+        ASSERT_EQ(data, i);
+        ASSERT_TRUE(byte_queue_dequeue(NULL));
+        ASSERT_TRUE(byte_queue_empty());
+    }
+}
+
+void spsc_ring_test() {
+    item_ring_clear();
+    ASSERT_TRUE(item_ring_empty());
+
+    item_t item;
+    ASSERT_FALSE(item_ring_pop(&item));
+
+    // Go around more than 256 times so head and tail wrap
+    uint16_t next_in = 0;
+    uint16_t next_out = 0;
+    for (uint16_t round = 0; round < 200; round++) {
+        uint8_t num = (round % 4) + 1;
+        for (uint8_t i = 0; i < num; i++) {
+            item.id = next_in++;
+            item.value = item.id * 3UL;
+            ASSERT_TRUE(item_ring_push(&item));
+        }
+        ASSERT_EQ(item_ring_count(), num);
+
+        for (uint8_t i = 0; i < num; i++) {
+            ASSERT_TRUE(item_ring_pop(&item));
+            ASSERT_EQ(item.id, next_out);
+            ASSERT_EQ(item.value, next_out * 3UL);
+            next_out++;
+        }
+        ASSERT_TRUE(item_ring_empty());
+    }
+
+    // Fill in place
+    for (uint8_t i = 0; i < 4; i++) {
+        item_t* slot = item_ring_alloc();
+        ASSERT_TRUE(slot != NULL);
+        slot->id = i;
+        // Not visible until committed
+        ASSERT_EQ(item_ring_count(), i);
+        item_ring_commit();
+    }
+    ASSERT_TRUE(item_ring_full());
+    ASSERT_TRUE(item_ring_alloc() == NULL);
+    ASSERT_FALSE(item_ring_push(&item));
+
+    ASSERT_TRUE(item_ring_peek(&item));
+    ASSERT_EQ(item.id, 0);
+    ASSERT_TRUE(item_ring_pop(NULL));
+    ASSERT_EQ(item_ring_count(), 3);
+
+    item_ring_clear();
+    ASSERT_TRUE(item_ring_empty());
+}
+
+// Removes elements whose first byte matches arg
+uint8_t match_first_byte(const uint8_t* data, void* arg) {
+    return data[0] == *((uint8_t*) arg);
+}
+
+void bulk_test() {
+    queue_t bulk_queue;
+    uint8_t batch[MAX_QUEUE_SIZE * QUEUE_DATA_SIZE];
+
+    init_queue(&bulk_queue);
+    // Move the head away from index 0 so the batch wraps around
+    enqueue(&bulk_queue, r);
+    enqueue(&bulk_queue, r);
+    dequeue(&bulk_queue, NULL);
+    dequeue(&bulk_queue, NULL);
+
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
+            batch[i * QUEUE_DATA_SIZE + j] = w[i][j];
+        }
+    }
+    ASSERT_TRUE(enqueue_n(&bulk_queue, batch, 3));
+    ASSERT_EQ(queue_size(&bulk_queue), 3);
+    // All or nothing
+    ASSERT_FALSE(enqueue_n(&bulk_queue, batch, 3));
+    ASSERT_EQ(queue_size(&bulk_queue), 3);
+    ASSERT_TRUE(enqueue_n(&bulk_queue, batch + QUEUE_DATA_SIZE * 3, 0));
+
+    uint8_t data[QUEUE_DATA_SIZE];
+    ASSERT_TRUE(peek_queue_at(&bulk_queue, 2, data));
+    ASSERT_EQ(data[0], t[0]);
+    ASSERT_FALSE(peek_queue_at(&bulk_queue, 3, data));
+
+    // Walk in place
+    queue_iter_t iter;
+    init_queue_iter(&iter, &bulk_queue);
+    const uint8_t* elem;
+    uint8_t count = 0;
+    while ((elem = next_queue_iter(&iter)) != NULL) {
+        ASSERT_EQ(elem[0], w[count][0]);
+        ASSERT_EQ(elem[QUEUE_DATA_SIZE - 1], w[count][QUEUE_DATA_SIZE - 1]);
+        count++;
+    }
+    ASSERT_EQ(count, 3);
+
+    // Drain more than available
+    for (uint8_t i = 0; i < sizeof(batch); i++) {
+        batch[i] = 0;
+    }
+    ASSERT_EQ(dequeue_n(&bulk_queue, batch, MAX_QUEUE_SIZE), 3);
+    ASSERT_TRUE(queue_empty(&bulk_queue));
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
+            ASSERT_EQ(batch[i * QUEUE_DATA_SIZE + j], w[i][j]);
+        }
+    }
+    ASSERT_EQ(dequeue_n(&bulk_queue, batch, 1), 0);
 }
 
+void remove_if_test() {
+    queue_t cmd_queue;
+    init_queue(&cmd_queue);
+    // Wrap around
+    enqueue(&cmd_queue, r);
+    enqueue(&cmd_queue, r);
+    enqueue(&cmd_queue, r);
+    dequeue_n(&cmd_queue, NULL, 3);
+
+    // r, s, r, t, r
+    enqueue(&cmd_queue, r);
+    enqueue(&cmd_queue, s);
+    enqueue(&cmd_queue, r);
+    enqueue(&cmd_queue, t);
+    enqueue(&cmd_queue, r);
+
+    uint8_t cancel = r[0];
+    ASSERT_EQ(remove_queue_if(&cmd_queue, match_first_byte, &cancel), 3);
+    ASSERT_EQ(queue_size(&cmd_queue), 2);
+
+    uint8_t data[QUEUE_DATA_SIZE];
+    ASSERT_TRUE(peek_queue_at(&cmd_queue, 0, data));
+    ASSERT_EQ(data[0], s[0]);
+    ASSERT_TRUE(peek_queue_at(&cmd_queue, 1, data));
+    ASSERT_EQ(data[0], t[0]);
+
+    // The queue still works normally
+    ASSERT_TRUE(enqueue(&cmd_queue, u));
+    ASSERT_EQ(remove_queue_if(&cmd_queue, match_first_byte, &cancel), 0);
+    ASSERT_TRUE(dequeue(&cmd_queue, data));
+    ASSERT_EQ(data[0], s[0]);
+    ASSERT_TRUE(dequeue(&cmd_queue, data));
+    ASSERT_EQ(data[0], t[0]);
+    ASSERT_TRUE(dequeue(&cmd_queue, data));
+    ASSERT_EQ(data[0], u[0]);
+    ASSERT_TRUE(queue_empty(&cmd_queue));
+}
+
+#ifdef QUEUE_STATS
+void stats_test() {
+    queue_t stats_queue;
+    queue_stats_t stats;
+
+    uptime_s = 100;
+    init_queue(&stats_queue);
+    get_queue_stats(&stats_queue, &stats);
+    ASSERT_EQ(stats.high_water, 0);
+    ASSERT_EQ(stats.total, 0);
+
+    for (uint8_t i = 0; i < MAX_QUEUE_SIZE + 2; i++) {
+        enqueue(&stats_queue, r);
+    }
+    uptime_s = 107;
+    dequeue(&stats_queue, NULL);
+    enqueue_front(&stats_queue, s);
+    uptime_s = 110;
+    dequeue(&stats_queue, NULL);
+    dequeue(&stats_queue, NULL);
+
+    get_queue_stats(&stats_queue, &stats);
+    ASSERT_EQ(stats.high_water, MAX_QUEUE_SIZE);
+    ASSERT_EQ(stats.rejected, 2);
+    ASSERT_EQ(stats.total, MAX_QUEUE_SIZE + 1);
+    ASSERT_EQ(stats.max_wait_s, 10);
+
+    reset_queue_stats(&stats_queue);
+    get_queue_stats(&stats_queue, &stats);
+    ASSERT_EQ(stats.high_water, MAX_QUEUE_SIZE - 2);
+    ASSERT_EQ(stats.rejected, 0);
+    ASSERT_EQ(stats.max_wait_s, 0);
+}
+#endif
 
 test_t t1 = { .name = "init_queue", .fn = init_queue_test };
 test_t t2 = { .name = "simple enqueue", .fn = enqueue_simple };
@@ -249,10 +484,23 @@ test_t t5 = { .name = "advanced enqueue front", .fn = enqueue_front_advanced };
 test_t t6 = { .name = "queue_empty", .fn = is_empty_test };
 test_t t7 = { .name = "queue_full", .fn = is_full_test };
 test_t t8 = { .name = "mixed enqueue/dequeue", .fn = mixed_test };
+test_t t9 = { .name = "shift_queue_left", .fn = shift_left_test };
+test_t t10 = { .name = "DECLARE_QUEUE", .fn = declare_queue_test };
+test_t t11 = { .name = "SPSC ring", .fn = spsc_ring_test };
+test_t t12 = { .name = "bulk and indexed", .fn = bulk_test };
+test_t t13 = { .name = "remove_queue_if", .fn = remove_if_test };
+#ifdef QUEUE_STATS
+test_t t14 = { .name = "queue stats", .fn = stats_test };
+#endif
 
-test_t* suite[8] = { &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8 };
+test_t* suite[] = {
+    &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8, &t9, &t10, &t11, &t12, &t13,
+#ifdef QUEUE_STATS
+    &t14,
+#endif
+};
 
 int main() {
-    run_tests(suite, 8);
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
     return 0;
 }
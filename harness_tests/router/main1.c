@@ -0,0 +1,164 @@
+#include <test/test.h>
+#include <router/router.h>
+
+#define NODE_EPS    1
+#define NODE_PAY    2
+#define NODE_GROUND 3
+
+uint8_t eps_busy = 0;
+uint8_t eps_count = 0;
+uint8_t last_eps[ROUTER_FRAME_LEN];
+uint8_t ground_count = 0;
+uint8_t local_count = 0;
+
+uint8_t send_to_eps(const uint8_t* data, uint8_t len) {
+    if (eps_busy) {
+        return 0;
+    }
+    memcpy(last_eps, data, len);
+    eps_count++;
+    return 1;
+}
+
+uint8_t send_to_ground(const uint8_t* data, uint8_t len) {
+    ground_count++;
+    return 1;
+}
+
+uint8_t handle_locally(const uint8_t* data, uint8_t len) {
+    local_count++;
+    return 1;
+}
+
+router_port_t ports[] = {
+    ROUTER_PORT(send_to_eps, 2),
+    ROUTER_PORT(send_to_ground, 4),
+    ROUTER_PORT(handle_locally, 1),
+};
+
+router_route_t routes[] = {
+    ROUTER_ROUTE(NODE_EPS, ROUTER_ANY, 0),
+    // Only PAY housekeeping is handled locally, the rest is dropped
+    ROUTER_ROUTE(NODE_PAY, 0x03, 2),
+    ROUTER_ROUTE(NODE_GROUND, ROUTER_ANY, 1),
+};
+
+#define NUM_PORTS (sizeof(ports) / sizeof(ports[0]))
+#define NUM_ROUTES (sizeof(routes) / sizeof(routes[0]))
+
+void reset(void) {
+    init_router(routes, NUM_ROUTES, ports, NUM_PORTS);
+    eps_busy = 0;
+    eps_count = 0;
+    ground_count = 0;
+    local_count = 0;
+}
+
+void forward_test(void) {
+    reset();
+    uint8_t frame[8] = { 0x02, 0x05, 0, 0, 0x12, 0x34, 0x56, 0x78 };
+
+    ASSERT_TRUE(route_frame(NODE_EPS, frame, 8));
+    ASSERT_TRUE(route_frame(NODE_GROUND, frame, 8));
+    ASSERT_EQ(router_bufs_free(), ROUTER_NUM_BUFS - 2);
+
+    ASSERT_EQ(run_router(), 2);
+    ASSERT_EQ(eps_count, 1);
+    ASSERT_EQ(ground_count, 1);
+    ASSERT_EQ(last_eps[1], 0x05);
+    ASSERT_EQ(last_eps[7], 0x78);
+    ASSERT_EQ(router_bufs_free(), ROUTER_NUM_BUFS);
+
+    ASSERT_EQ(routes[0].count, 1);
+    ASSERT_EQ(routes[2].count, 1);
+    ASSERT_EQ(ports[0].sent, 1);
+}
+
+void no_route_test(void) {
+    reset();
+    uint8_t frame[8] = { 0x05, 0, 0, 0, 0, 0, 0, 0 };
+
+    // Wrong message type
+    ASSERT_FALSE(route_frame(NODE_PAY, frame, 8));
+    // Unknown destination
+    ASSERT_FALSE(route_frame(0x10, frame, 8));
+    ASSERT_EQ(router_bufs_free(), ROUTER_NUM_BUFS);
+
+    frame[0] = 0x03;
+    ASSERT_TRUE(route_frame(NODE_PAY, frame, 8));
+    ASSERT_EQ(run_router(), 1);
+    ASSERT_EQ(local_count, 1);
+
+    // Too long
+    uint8_t long_frame[ROUTER_FRAME_LEN + 1] = { 0 };
+    ASSERT_FALSE(route_frame(NODE_EPS, long_frame, sizeof(long_frame)));
+}
+
+void busy_port_test(void) {
+    reset();
+    uint8_t frame[8] = { 0x02, 0, 0, 0, 0, 0, 0, 0 };
+
+    eps_busy = 1;
+    for (uint8_t i = 0; i < 3; i++) {
+        frame[1] = i;
+        route_frame(NODE_EPS, frame, 8);
+    }
+    // Depth limit of 2
+    ASSERT_EQ(ports[0].depth, 2);
+    ASSERT_EQ(ports[0].dropped, 1);
+    ASSERT_EQ(routes[0].dropped, 1);
+
+    // Other ports are not blocked
+    ASSERT_TRUE(route_frame(NODE_GROUND, frame, 8));
+    ASSERT_EQ(run_router(), 1);
+    ASSERT_EQ(eps_count, 0);
+    ASSERT_EQ(router_bufs_free(), ROUTER_NUM_BUFS - 2);
+
+    // Frames are sent in order once the port is free
+    eps_busy = 0;
+    ASSERT_EQ(run_router(), 2);
+    ASSERT_EQ(eps_count, 2);
+    ASSERT_EQ(last_eps[1], 1);
+    ASSERT_EQ(router_bufs_free(), ROUTER_NUM_BUFS);
+}
+
+void handle_test(void) {
+    reset();
+
+    // Fill a buffer in place
+    uint8_t handle = alloc_router_buf();
+    ASSERT_NEQ(handle, ROUTER_NO_BUF);
+    router_frame_t* frame = get_router_buf(handle);
+    frame->data[0] = 0x02;
+    frame->data[1] = 0xAB;
+    frame->len = 2;
+    ASSERT_TRUE(route_router_buf(handle, NODE_EPS));
+    ASSERT_EQ(run_router(), 1);
+    ASSERT_EQ(last_eps[1], 0xAB);
+
+    // Run out of buffers
+    uint8_t handles[ROUTER_NUM_BUFS];
+    for (uint8_t i = 0; i < ROUTER_NUM_BUFS; i++) {
+        handles[i] = alloc_router_buf();
+        ASSERT_NEQ(handles[i], ROUTER_NO_BUF);
+    }
+    ASSERT_EQ(alloc_router_buf(), ROUTER_NO_BUF);
+    uint8_t data[1] = { 0x02 };
+    ASSERT_FALSE(route_frame(NODE_EPS, data, 1));
+    for (uint8_t i = 0; i < ROUTER_NUM_BUFS; i++) {
+        free_router_buf(handles[i]);
+    }
+    ASSERT_EQ(router_bufs_free(), ROUTER_NUM_BUFS);
+}
+
+test_t t1 = { .name = "forward", .fn = forward_test };
+test_t t2 = { .name = "no route", .fn = no_route_test };
+test_t t3 = { .name = "busy port", .fn = busy_port_test };
+test_t t4 = { .name = "handles", .fn = handle_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <test/test.h>
+#include <scheduler/scheduler.h>
+
+// The tests use a fake time source, which only changes when they set it
+
+uint32_t fake_ms = 0;
+
+uint32_t get_fake_ms(void) {
+    return fake_ms;
+}
+
+// Order in which the tasks ran (task numbers)
+uint8_t order[8];
+uint8_t order_count = 0;
+// Events seen by event_task
+uint8_t seen_events = 0;
+// Time event_task takes to run (ms)
+uint32_t slow_ms = 0;
+
+void record(uint8_t num) {
+    if (order_count < sizeof(order)) {
+        order[order_count] = num;
+    }
+    order_count++;
+}
+
+void task_a(void) {
+    record(0);
+}
+
+void task_b(void) {
+    record(1);
+}
+
+void event_task(void) {
+    record(2);
+    seen_events = get_sched_events();
+    fake_ms += slow_ms;
+}
+
+void setup(void) {
+    init_sched();
+    set_sched_time_fn(get_fake_ms);
+    fake_ms = 1000;
+    order_count = 0;
+    seen_events = 0;
+    slow_ms = 0;
+}
+
+void periodic_test(void) {
+    setup();
+    uint8_t a = add_sched_task(task_a, 10, 0);
+    ASSERT_EQ(a, 0);
+
+    // Not released yet (sleeps)
+    ASSERT_FALSE(run_sched());
+    fake_ms += 9;
+    ASSERT_FALSE(run_sched());
+    fake_ms += 1;
+    ASSERT_TRUE(run_sched());
+    ASSERT_FALSE(run_sched());
+    fake_ms += 10;
+    ASSERT_TRUE(run_sched());
+
+    sched_stats_t stats;
+    ASSERT_TRUE(get_sched_stats(a, &stats));
+    ASSERT_EQ(stats.runs, 2);
+    ASSERT_EQ(stats.overruns, 0);
+    ASSERT_FALSE(get_sched_stats(a + 1, &stats));
+}
+
+void deadline_test(void) {
+    setup();
+    add_sched_task(task_a, 10, 10);
+    add_sched_task(task_b, 10, 5);
+
+    // Both are released, the one with the earlier deadline runs first
+    fake_ms += 10;
+    ASSERT_TRUE(run_sched());
+    ASSERT_TRUE(run_sched());
+    ASSERT_FALSE(run_sched());
+    ASSERT_EQ(order_count, 2);
+    ASSERT_EQ(order[0], 1);
+    ASSERT_EQ(order[1], 0);
+}
+
+void event_test(void) {
+    setup();
+    uint8_t e = add_sched_task(event_task, 0, 20);
+
+    fake_ms += 1000;
+    ASSERT_FALSE(run_sched());
+
+    set_sched_event(e, 0x01);
+    set_sched_event(e, 0x04);
+    ASSERT_TRUE(run_sched());
+    ASSERT_EQ(seen_events, 0x05);
+    ASSERT_EQ(get_sched_events(), 0);
+    ASSERT_FALSE(run_sched());
+
+    // Invalid task
+    set_sched_event(e + 1, 0x01);
+    ASSERT_FALSE(run_sched());
+}
+
+void overrun_test(void) {
+    setup();
+    uint8_t a = add_sched_task(task_a, 10, 0);
+    uint8_t e = add_sched_task(event_task, 0, 20);
+    sched_stats_t stats;
+
+    // Finishes after its deadline
+    slow_ms = 25;
+    set_sched_event(e, 0x01);
+    ASSERT_TRUE(run_sched());
+    ASSERT_TRUE(get_sched_stats(e, &stats));
+    ASSERT_EQ(stats.runs, 1);
+    ASSERT_EQ(stats.overruns, 1);
+
+    // task_a is now more than 2 periods late, it runs once and skips ahead
+    // (one late run is one overrun, even though it also missed its deadline)
+    ASSERT_TRUE(run_sched());
+    ASSERT_FALSE(run_sched());
+    ASSERT_TRUE(get_sched_stats(a, &stats));
+    ASSERT_EQ(stats.runs, 1);
+    ASSERT_EQ(stats.overruns, 1);
+    fake_ms += 10;
+    ASSERT_TRUE(run_sched());
+
+    reset_sched_stats();
+    ASSERT_TRUE(get_sched_stats(a, &stats));
+    ASSERT_EQ(stats.runs, 0);
+    ASSERT_EQ(stats.overruns, 0);
+}
+
+void full_test(void) {
+    setup();
+    // Invalid tasks
+    ASSERT_EQ(add_sched_task(NULL, 100, 0), SCHED_NO_TASK);
+    ASSERT_EQ(add_sched_task(event_task, 0, 0), SCHED_NO_TASK);
+
+    for (uint8_t i = 0; i < SCHED_MAX_TASKS; i++) {
+        ASSERT_EQ(add_sched_task(task_a, 100, 0), i);
+    }
+    ASSERT_EQ(add_sched_task(task_a, 100, 0), SCHED_NO_TASK);
+    set_sched_time_fn(NULL);
+}
+
+test_t t1 = { .name = "periodic", .fn = periodic_test };
+test_t t2 = { .name = "deadline", .fn = deadline_test };
+test_t t3 = { .name = "event", .fn = event_test };
+test_t t4 = { .name = "overrun", .fn = overrun_test };
+test_t t5 = { .name = "full and invalid", .fn = full_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include <test/test.h>
 #include <stack/stack.h>
+#include <stack/declare_stack.h>
 
 #if MAX_STACK_SIZE != 5
 #undef MAX_STACK_SIZE
@@ -8,6 +9,8 @@
 
 stack_t stack;
 
+DECLARE_STACK(word_stack, uint16_t, 3)
+
 uint8_t r[] = { 0xfe, 0x25, 0xe3, 0x1d, 0x73, 0xff, 0x00, 0xa7 };
 uint8_t s[] = { 0xaa, 0xbb, 0xac, 0x41, 0xd2, 0x33, 0xe4, 0x55 };
 uint8_t t[] = { 0x07, 0xf2, 0x03, 0xb4, 0xc5, 0x06, 0xa2, 0x08 };
@@ -166,6 +169,57 @@ void mixed_test() {
     ASSERT_EQ(stack.index, 1);
 }
 
+void declare_stack_test() {
+    word_stack_init();
+    ASSERT_TRUE(word_stack_empty());
+
+    for (uint16_t i = 0; i < 3; i++) {
+        uint16_t data = 0x1000 + i;
+        ASSERT_TRUE(word_stack_push(&data));
+    }
+    ASSERT_TRUE(word_stack_full());
+    uint16_t data = 0;
+    ASSERT_FALSE(word_stack_push(&data));
+
+    ASSERT_TRUE(word_stack_peek(&data));
+    ASSERT_EQ(data, 0x1002);
+    for (uint16_t i = 0; i < 3; i++) {
+        ASSERT_TRUE(word_stack_pop(&data));
+        ASSERT_EQ(data, 0x1002 - i);
+    }
+    ASSERT_FALSE(word_stack_pop(NULL));
+    ASSERT_EQ(word_stack_size(), 0);
+}
+
+#ifdef STACK_STATS
+void stats_test() {
+    stack_t stats_stack;
+    stack_stats_t stats;
+
+    init_stack(&stats_stack);
+    get_stack_stats(&stats_stack, &stats);
+    ASSERT_EQ(stats.high_water, 0);
+    ASSERT_EQ(stats.total, 0);
+
+    for (uint8_t i = 0; i < MAX_STACK_SIZE + 2; i++) {
+        push_stack(&stats_stack, r);
+    }
+    pop_stack(&stats_stack, NULL);
+    pop_stack(&stats_stack, NULL);
+
+    get_stack_stats(&stats_stack, &stats);
+    ASSERT_EQ(stats.high_water, MAX_STACK_SIZE);
+    ASSERT_EQ(stats.rejected, 2);
+    ASSERT_EQ(stats.total, MAX_STACK_SIZE);
+
+    reset_stack_stats(&stats_stack);
+    get_stack_stats(&stats_stack, &stats);
+    ASSERT_EQ(stats.high_water, MAX_STACK_SIZE - 2);
+    ASSERT_EQ(stats.rejected, 0);
+    ASSERT_EQ(stats.total, 0);
+}
+#endif
+
 test_t t1 = { .name = "init_stack", .fn = init_stack_test };
 test_t t2 = { .name = "simple push_stack", .fn = push_stack_simple };
 test_t t3 = { .name = "simple peek_stack", .fn = peek_stack_simple };
@@ -173,10 +227,20 @@ test_t t4 = { .name = "simple pop_stack", .fn = pop_stack_simple };
 test_t t5 = { .name = "stack_empty", .fn = is_empty_test };
 test_t t6 = { .name = "stack_full", .fn = is_full_test };
 test_t t7 = { .name = "mixed push_stack/pop_stack", .fn = mixed_test };
+test_t t8 = { .name = "DECLARE_STACK", .fn = declare_stack_test };
 
-test_t* suite[7] = { &t1, &t2, &t3, &t4, &t5, &t6, &t7 };
+#ifdef STACK_STATS
+test_t t9 = { .name = "stack stats", .fn = stats_test };
+#endif
+
+test_t* suite[] = {
+    &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8,
+#ifdef STACK_STATS
+    &t9,
+#endif
+};
 
 int main() {
-    run_tests(suite, 7);
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
     return 0;
 }
@@ -0,0 +1,77 @@
+#include <test/test.h>
+#include <timer/timer.h>
+
+// Checks the prescaler, compare value and number of interrupts chosen for each
+// period (the callbacks are not called, the timers are stopped right away)
+
+extern timer_t timer8;
+extern timer_t timer16;
+
+#define CS0_MASK (_BV(CS02) | _BV(CS01) | _BV(CS00))
+#define CS1_MASK (_BV(CS12) | _BV(CS11) | _BV(CS10))
+
+// Clock select bits for each prescaler
+#define CS_1        1
+#define CS_8        2
+#define CS_64       3
+#define CS_256      4
+#define CS_1024     5
+
+void nop_cb(void) {}
+
+void timer_8bit_test(void) {
+    // 1 ms = 125 counts with a prescaler of 64 (one interrupt)
+    start_timer_8bit_ms(1, nop_cb);
+    ASSERT_EQ((TCCR0B & CS0_MASK) >> CS00, CS_64);
+    ASSERT_EQ(OCR0A, 124);
+    ASSERT_EQ(timer8.max_time_ints, 0);
+
+    // 8 ms = 250 counts with a prescaler of 256
+    start_timer_8bit_ms(8, nop_cb);
+    ASSERT_EQ((TCCR0B & CS0_MASK) >> CS00, CS_256);
+    ASSERT_EQ(OCR0A, 249);
+
+    // 1 s = 7812.5 counts with a prescaler of 1024 (30 full interrupts)
+    start_timer_8bit(1, nop_cb);
+    ASSERT_EQ((TCCR0B & CS0_MASK) >> CS00, CS_1024);
+    ASSERT_EQ(timer8.max_time_ints, 30);
+    ASSERT_EQ(timer8.remainder_time, 7813 - (30 * 256) - 1);
+    ASSERT_EQ(OCR0A, 0xFF);
+
+    stop_timer_8bit();
+    ASSERT_EQ((TCCR0B & CS0_MASK) >> CS00, 0);
+}
+
+void timer_16bit_test(void) {
+    // 1 ms = 8000 counts without a prescaler
+    start_timer_16bit_ms(1, nop_cb);
+    ASSERT_EQ((TCCR1B & CS1_MASK) >> CS10, CS_1);
+    ASSERT_EQ(OCR1A, 7999);
+    ASSERT_EQ(timer16.max_time_ints, 0);
+
+    // 1 s = 31250 counts with a prescaler of 256 (one interrupt)
+    start_timer_16bit(1, nop_cb);
+    ASSERT_EQ((TCCR1B & CS1_MASK) >> CS10, CS_256);
+    ASSERT_EQ(OCR1A, 31249);
+    ASSERT_EQ(timer16.max_time_ints, 0);
+
+    // 10 s = 78125 counts with a prescaler of 1024 (one full interrupt)
+    start_timer_16bit(10, nop_cb);
+    ASSERT_EQ((TCCR1B & CS1_MASK) >> CS10, CS_1024);
+    ASSERT_EQ(timer16.max_time_ints, 1);
+    ASSERT_EQ(timer16.remainder_time, 78125 - 65536 - 1);
+    ASSERT_EQ(OCR1A, 0xFFFF);
+
+    stop_timer_16bit();
+    ASSERT_EQ((TCCR1B & CS1_MASK) >> CS10, 0);
+}
+
+test_t t1 = { .name = "8-bit timer", .fn = timer_8bit_test };
+test_t t2 = { .name = "16-bit timer", .fn = timer_16bit_test };
+
+test_t* suite[] = { &t1, &t2 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
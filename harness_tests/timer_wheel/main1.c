@@ -0,0 +1,222 @@
+#include <test/test.h>
+#include <timer/clock.h>
+#include <timer/timer_wheel.h>
+
+// The tests call advance_timer_wheel() directly instead of waiting for the
+// timer (the hardware timer is only started by the last test)
+
+wheel_timer_t timer_a;
+wheel_timer_t timer_b;
+wheel_timer_t timer_c;
+
+volatile uint32_t count_a = 0;
+volatile uint32_t count_b = 0;
+volatile uint32_t count_c = 0;
+// wheel_ms of the last callback of timer_a
+volatile uint32_t last_a = 0;
+
+void cb_a(void) {
+    count_a += 1;
+    last_a = wheel_ms;
+}
+
+void cb_b(void) {
+    count_b += 1;
+}
+
+// Stops timer_a from another timer's callback
+void cb_c(void) {
+    count_c += 1;
+    stop_wheel_timer(&timer_a);
+}
+
+void tick_n(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            advance_timer_wheel(wheel_ms + 1);
+        }
+    }
+}
+
+// Advances n ticks at once (like the interrupt after ticks with nothing to do)
+void skip_n(uint32_t n) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        advance_timer_wheel(wheel_ms + n);
+    }
+}
+
+void reset_counts(void) {
+    count_a = 0;
+    count_b = 0;
+    count_c = 0;
+    last_a = 0;
+}
+
+void one_shot_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+    ASSERT_FALSE(wheel_timer_running(&timer_a));
+
+    uint32_t start = wheel_ms;
+    start_wheel_timer(&timer_a, 5, 0);
+    ASSERT_TRUE(wheel_timer_running(&timer_a));
+    tick_n(4);
+    ASSERT_EQ(count_a, 0);
+    tick_n(1);
+    ASSERT_EQ(count_a, 1);
+    ASSERT_EQ(last_a, start + 5);
+    ASSERT_FALSE(wheel_timer_running(&timer_a));
+    tick_n(100);
+    ASSERT_EQ(count_a, 1);
+}
+
+void periodic_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+    init_wheel_timer(&timer_b, cb_b, 0);
+
+    uint32_t start = wheel_ms;
+    start_wheel_timer(&timer_a, 7, 7);
+    start_wheel_timer(&timer_b, 1000, 250);
+    tick_n(2000);
+    ASSERT_EQ(count_a, 2000 / 7);
+    ASSERT_EQ(last_a, start + (2000 / 7) * 7);
+    ASSERT_EQ(count_b, 5);
+
+    stop_wheel_timer(&timer_a);
+    stop_wheel_timer(&timer_b);
+    tick_n(1000);
+    ASSERT_EQ(count_a, 2000 / 7);
+    ASSERT_EQ(count_b, 5);
+}
+
+void long_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+
+    // Longer than the wheel reaches directly (65.5 s)
+    uint32_t start = wheel_ms;
+    start_wheel_timer(&timer_a, 150000, 0);
+    tick_n(149999);
+    ASSERT_EQ(count_a, 0);
+    tick_n(1);
+    ASSERT_EQ(count_a, 1);
+    ASSERT_EQ(last_a, start + 150000);
+}
+
+void restart_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+
+    // Restarting pushes the expiry back (like a watchdog)
+    start_wheel_timer(&timer_a, 20, 0);
+    for (uint8_t i = 0; i < 10; i++) {
+        tick_n(15);
+        start_wheel_timer(&timer_a, 20, 0);
+    }
+    ASSERT_EQ(count_a, 0);
+    tick_n(20);
+    ASSERT_EQ(count_a, 1);
+}
+
+void callback_stop_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+    init_wheel_timer(&timer_c, cb_c, 0);
+
+    // Both expire on the same tick, the first callback stops the other timer
+    start_wheel_timer(&timer_a, 10, 10);
+    start_wheel_timer(&timer_c, 10, 0);
+    tick_n(10);
+    ASSERT_EQ(count_c, 1);
+    ASSERT_FALSE(wheel_timer_running(&timer_a));
+    tick_n(100);
+    ASSERT_EQ(count_a, 0);
+}
+
+void deferred_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_b, cb_b, WHEEL_TIMER_DEFERRED);
+
+    start_wheel_timer(&timer_b, 3, 3);
+    tick_n(3);
+    ASSERT_EQ(count_b, 0);
+    run_timer_wheel();
+    ASSERT_EQ(count_b, 1);
+
+    // Expiring again before run_timer_wheel() only calls it once
+    tick_n(9);
+    run_timer_wheel();
+    ASSERT_EQ(count_b, 2);
+    run_timer_wheel();
+    ASSERT_EQ(count_b, 2);
+
+    // Stopping cancels a waiting callback
+    tick_n(3);
+    stop_wheel_timer(&timer_b);
+    run_timer_wheel();
+    ASSERT_EQ(count_b, 2);
+    ASSERT_EQ(wheel_deferred_dropped, 0);
+}
+
+void skip_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+    init_wheel_timer(&timer_b, cb_b, 0);
+
+    // Each expiry is processed at its own tick, even if they are all advanced
+    // at once
+    uint32_t start = wheel_ms;
+    start_wheel_timer(&timer_a, 7, 7);
+    start_wheel_timer(&timer_b, 150000, 0);
+    skip_n(2000);
+    ASSERT_EQ(count_a, 2000 / 7);
+    ASSERT_EQ(last_a, start + (2000 / 7) * 7);
+    ASSERT_EQ(wheel_ms, start + 2000);
+
+    stop_wheel_timer(&timer_a);
+    skip_n(147999);
+    ASSERT_EQ(count_b, 0);
+    skip_n(1);
+    ASSERT_EQ(count_b, 1);
+}
+
+void hardware_test(void) {
+    reset_counts();
+    init_wheel_timer(&timer_a, cb_a, 0);
+    init_timer_wheel();
+    ASSERT_TRUE(timer_wheel_started());
+
+    // Expires from the compare interrupt (without a tick every 1 ms)
+    uint32_t start = millis();
+    start_wheel_timer(&timer_a, 20, 0);
+    _delay_ms(15);
+    ASSERT_EQ(count_a, 0);
+    _delay_ms(10);
+    ASSERT_EQ(count_a, 1);
+    ASSERT_FALSE(last_a - start < 20);
+    ASSERT_FALSE(last_a - start > 21);
+
+    // Longer than a period of the counter
+    start_wheel_timer(&timer_a, 700, 0);
+    _delay_ms(690);
+    ASSERT_EQ(count_a, 1);
+    _delay_ms(20);
+    ASSERT_EQ(count_a, 2);
+}
+
+test_t t1 = { .name = "one shot", .fn = one_shot_test };
+test_t t2 = { .name = "periodic", .fn = periodic_test };
+test_t t3 = { .name = "long", .fn = long_test };
+test_t t4 = { .name = "restart", .fn = restart_test };
+test_t t5 = { .name = "callback stop", .fn = callback_stop_test };
+test_t t6 = { .name = "deferred", .fn = deferred_test };
+test_t t7 = { .name = "skip", .fn = skip_test };
+test_t t8 = { .name = "hardware", .fn = hardware_test };
+
+test_t* suite[] = { &t1, &t2, &t3, &t4, &t5, &t6, &t7, &t8 };
+
+int main(void) {
+    run_tests(suite, sizeof(suite) / sizeof(suite[0]));
+    return 0;
+}
@@ -45,6 +45,35 @@ typedef struct {
 
 typedef void (*can_rx_callback_t)(const uint8_t*, uint8_t);
 typedef void (*can_tx_callback_t)(uint8_t*, uint8_t*);
+typedef void (*can_timer_callback_t)(void);
+// Called with the MOb number when a TX MOb finishes sending (TXOK)
+typedef void (*can_tx_done_callback_t)(uint8_t);
+// Called with the MOb number when a TX MOb reports an error (e.g. no ack) or
+// the CAN controller is reset after bus off, so the frame was not sent (yet)
+typedef void (*can_tx_err_callback_t)(uint8_t);
+// Called with the MOb number and the ID of every received frame, before the
+// MOb's RX callback
+typedef void (*can_rx_hook_t)(uint8_t, uint16_t);
+
+// Number of received frames that can wait for get_can_rx_frame() (power of 2)
+#ifndef CAN_RX_RING_SIZE
+#define CAN_RX_RING_SIZE 8
+#endif
+
+// Frame received by an RX MOb without an RX callback
+typedef struct {
+    uint8_t mob_num;
+    uint8_t len;
+    uint8_t data[8];
+} can_rx_frame_t;
+
+// Gets a buffer for a received frame (from the CAN interrupt)
+// handle - set to the handle of the buffer
+// Returns - pointer to the buffer, or NULL if none is free
+typedef can_rx_frame_t* (*can_rx_alloc_fn_t)(uint8_t* handle);
+// Hands a filled buffer to the main loop (from the CAN interrupt)
+// Returns - 1 if successful, 0 if it was dropped (the buffer is released)
+typedef uint8_t (*can_rx_commit_fn_t)(uint8_t handle);
 
 typedef struct {
     // common
@@ -56,11 +85,16 @@ typedef struct {
 
     // rx specific
     mob_id_mask_t id_mask;
+    // Called from the CAN interrupt, or NULL to queue received frames for
+    // get_can_rx_frame()
     can_rx_callback_t rx_cb;
 
     // tx specific
     can_tx_callback_t tx_data_cb;
     uint8_t data[8];
+    // Optional (NULL if not used), called from the CAN interrupt
+    can_tx_done_callback_t tx_done_cb;
+    can_tx_err_callback_t tx_err_cb;
 } mob_t;
 
 extern volatile uint8_t boffit_count;
@@ -80,4 +114,14 @@ void select_mob(uint8_t);
 
 void set_can_baud_rate(can_baud_rate_t);
 
+can_rx_hook_t set_can_rx_hook(can_rx_hook_t hook);
+void set_can_rx_buf_fns(can_rx_alloc_fn_t alloc_fn,
+    can_rx_commit_fn_t commit_fn);
+uint8_t get_can_rx_frame(can_rx_frame_t* frame);
+uint8_t get_can_rx_frame_count(void);
+uint16_t get_can_rx_dropped(void);
+
+void start_can_timer(uint8_t prescaler, can_timer_callback_t cb);
+void stop_can_timer(void);
+
 #endif
@@ -0,0 +1,16 @@
+#ifndef CAN_RX_POOL_H
+#define CAN_RX_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <util/atomic.h>
+
+#include <can/can.h>
+#include <pool/pool.h>
+
+uint8_t set_can_rx_pool(pool_t* pool);
+uint8_t get_can_rx_handle(uint8_t* handle);
+uint8_t get_can_rx_handle_count(void);
+
+#endif // CAN_RX_POOL_H
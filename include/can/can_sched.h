@@ -0,0 +1,49 @@
+#ifndef CAN_SCHED_H
+#define CAN_SCHED_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <util/atomic.h>
+
+#include <can/can.h>
+
+// CAN timer prescaler (CANTCON) used by the schedule
+// One slot is one CAN timer overflow, i.e. 65.536 ms * (CAN_SCHED_TPRSC + 1)
+#define CAN_SCHED_TPRSC 0
+// Length of one schedule slot in microseconds
+#define CAN_SCHED_SLOT_US (65536UL * (CAN_SCHED_TPRSC + 1UL))
+// Converts a time in milliseconds to a number of slots (rounded down, min 1)
+#define CAN_SCHED_MS_TO_SLOTS(ms) \
+    (((ms) * 1000UL) < CAN_SCHED_SLOT_US ? 1 : (((ms) * 1000UL) / CAN_SCHED_SLOT_US))
+
+// One periodic message in the schedule table
+typedef struct {
+    // TX MOb the message is loaded into
+    mob_t* mob;
+    // Number of slots between transmissions
+    uint16_t period;
+    // Slot of the first transmission (use different offsets to spread messages
+    // with the same period across the bus)
+    uint16_t offset;
+    // Fills in the message data when the slot comes up; if NULL, the MOb's
+    // tx_data_cb is used
+    can_tx_callback_t producer;
+
+    // Number of slots until the next transmission
+    uint16_t countdown;
+    // Number of messages that were sent (TXOK)
+    uint16_t sent_count;
+    // Number of slots where the previous message was still waiting to be sent
+    uint16_t missed_count;
+    // The MOb's own tx_done_cb, called after sent_count is updated
+    can_tx_done_callback_t tx_done_cb;
+} can_sched_entry_t;
+
+void init_can_sched(can_sched_entry_t* entries, uint8_t count);
+void start_can_sched(void);
+void stop_can_sched(void);
+void can_sched_tick(void);
+void can_sched_tx_done(uint8_t mob_num);
+
+#endif // CAN_SCHED_H
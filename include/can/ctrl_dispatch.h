@@ -0,0 +1,61 @@
+#ifndef CAN_CTRL_DISPATCH_H
+#define CAN_CTRL_DISPATCH_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include <can/data_protocol.h>
+
+// Runs one control command
+// arg - request data (bytes 4-7, big endian)
+// result - response data to send back (initialized to 0)
+// Returns - status byte for the response (CAN_STATUS_*)
+typedef uint8_t (*ctrl_handler_t)(uint32_t arg, uint32_t* result);
+
+// Gets the current time for latency accounting, in any unit (e.g. timer ticks)
+typedef uint16_t (*ctrl_time_fn_t)(void);
+
+// Describes one control opcode
+typedef struct {
+    uint8_t opcode;
+    // Minimum number of data bytes the request must contain (0 to 4)
+    uint8_t data_len;
+    // NULL if the opcode is not supported by this subsystem
+    ctrl_handler_t handler;
+} ctrl_cmd_t;
+
+// Designated initializer for the entry of one opcode
+#define CTRL_CMD(opcode, data_len, handler) [opcode] = { opcode, data_len, handler }
+
+// Usage statistics of one opcode
+typedef struct {
+    // Number of times the handler was called (saturates at 0xFFFF)
+    uint16_t count;
+    // Longest handler execution time, in units of the time source
+    uint16_t max_time;
+} ctrl_stats_t;
+
+// All opcodes of one message type
+typedef struct {
+    uint8_t msg_type;
+    // Number of opcodes, from the CAN_*_CTRL_FIELD_COUNT constants
+    uint8_t count;
+    // Commands in program memory, indexed by opcode
+    const ctrl_cmd_t* cmds;
+    // Array of count entries in RAM, or NULL to not keep statistics
+    ctrl_stats_t* stats;
+} ctrl_table_t;
+
+void set_ctrl_time_fn(ctrl_time_fn_t fn);
+
+uint8_t dispatch_ctrl_req(const ctrl_table_t* table, const uint8_t* req,
+    uint8_t len, uint8_t* resp);
+
+uint8_t get_ctrl_stats(const ctrl_table_t* table, uint8_t opcode,
+    ctrl_stats_t* stats);
+void reset_ctrl_stats(const ctrl_table_t* table);
+
+#endif // CAN_CTRL_DISPATCH_H
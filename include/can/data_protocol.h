@@ -5,6 +5,20 @@ CAN Data Protocol
 #ifndef CAN_DATA_PROTOCOL_H
 #define CAN_DATA_PROTOCOL_H
 
+#include <stdint.h>
+
+// Message Layout
+// Byte 0: Message type
+// Byte 1: Field number (or opcode)
+// Byte 2: Status (in responses)
+// Byte 3: Unused
+// Bytes 4-7: Data (big endian)
+#define CAN_MSG_TYPE_IDX    0
+#define CAN_MSG_FIELD_IDX   1
+#define CAN_MSG_STATUS_IDX  2
+#define CAN_MSG_DATA_IDX    4
+#define CAN_MSG_LEN         8
+
 
 // Message Types
 
@@ -70,7 +84,9 @@ CAN Data Protocol
 #define CAN_EPS_CTRL_GET_HEAT_CUR_THR       0x0B
 #define CAN_EPS_CTRL_SET_HEAT_CUR_THR_LOWER 0x0C
 #define CAN_EPS_CTRL_SET_HEAT_CUR_THR_UPPER 0x0D
-#define CAN_EPS_CTRL_FIELD_COUNT            0x0E  // Number of fields
+#define CAN_EPS_CTRL_READ_MEM_BLOCK         0x0E
+#define CAN_EPS_CTRL_READ_MEM_DATA          0x0F
+#define CAN_EPS_CTRL_FIELD_COUNT            0x10  // Number of fields
 
 // PAY housekeeping
 #define CAN_PAY_HK_UPTIME               0x00
@@ -133,7 +149,55 @@ CAN Data Protocol
 #define CAN_PAY_CTRL_MOTOR_UP               0x12
 #define CAN_PAY_CTRL_MOTOR_DOWN             0x13
 #define CAN_PAY_CTRL_SEND_OPT_SPI           0x14
-#define CAN_PAY_CTRL_FIELD_COUNT            0x15  // Number of fields
+#define CAN_PAY_CTRL_READ_MEM_BLOCK         0x15
+#define CAN_PAY_CTRL_READ_MEM_DATA          0x16
+#define CAN_PAY_CTRL_FIELD_COUNT            0x17  // Number of fields
+
+
+// Packed (bulk) housekeeping
+// Request: field number is CAN_HK_BULK_REQ, byte 4 is the first field and
+// byte 5 is the last field to send
+// Response: one or more packed frames
+// Byte 0: Message type
+// Byte 1: CAN_HK_PACKED_FLAG | number of the first field in this frame
+// Bytes 2-7: Raw values of consecutive fields in field number order, each
+// using its raw width from the field registry, packed MSB first
+#define CAN_HK_BULK_REQ             0xFF
+#define CAN_HK_BULK_FIRST_IDX       4
+#define CAN_HK_BULK_LAST_IDX        5
+#define CAN_HK_PACKED_FLAG          0x80
+#define CAN_HK_PACKED_DATA_IDX      2
+#define CAN_HK_PACKED_DATA_BITS     48
+
+
+// Bulk memory read
+// Start request: opcode CAN_*_CTRL_READ_MEM_BLOCK
+// Byte 2: Memory space (CAN_MEM_*)
+// Byte 3: Window (maximum number of unacknowledged data frames)
+// Bytes 4-5: Start address
+// Bytes 6-7: Number of bytes to read (0 to cancel a read in progress)
+// Start response: status byte, data is the number of data frames that follow
+//
+// Data frames: opcode CAN_*_CTRL_READ_MEM_DATA
+// Byte 2: Sequence number (low 8 bits of the frame index)
+// Bytes 3-7: Memory contents, the last data frame is padded with 0
+// The frame after the last data frame has the CRC-16 (CCITT, initial value
+// 0xFFFF, same as _crc_ccitt_update() in avr-libc) of all bytes read in
+// bytes 3-4 (big endian)
+//
+// Acknowledgement: opcode CAN_*_CTRL_READ_MEM_DATA
+// Byte 3: CAN_MEM_ACK_RESEND to resend all frames that were not acknowledged
+// Bytes 4-5: Number of frames received in order
+#define CAN_MEM_SRAM                0x00    // RAMSTART to RAMEND only
+#define CAN_MEM_EEPROM              0x01
+#define CAN_MEM_FLASH               0x02
+#define CAN_MEM_SPACE_IDX           2
+#define CAN_MEM_WINDOW_IDX          3
+#define CAN_MEM_SEQ_IDX             2
+#define CAN_MEM_FRAME_DATA_IDX      3
+#define CAN_MEM_FRAME_DATA_LEN      5
+#define CAN_MEM_ACK_FLAGS_IDX       3
+#define CAN_MEM_ACK_RESEND          0x01
 
 
 // CAN message status bytes
@@ -142,4 +206,8 @@ CAN Data Protocol
 #define CAN_STATUS_INVALID_FIELD_NUM    0x12
 #define CAN_STATUS_INVALID_DATA         0x13
 
+
+void fill_can_msg(uint8_t type, uint8_t field, uint8_t status, uint32_t data,
+    uint8_t* msg);
+
 #endif
@@ -0,0 +1,56 @@
+#ifndef CAN_HK_DELTA_H
+#define CAN_HK_DELTA_H
+
+#include <stdint.h>
+
+// Record header
+#define HK_DELTA_KEYFRAME_FLAG  0x80
+#define HK_DELTA_SEQ_MASK       0x7F
+
+// Token first byte
+#define HK_DELTA_TOKEN_CONT     0x80    // More bytes follow
+#define HK_DELTA_TOKEN_RUN      0x40    // Run of unchanged fields
+#define HK_DELTA_TOKEN_BITS     6       // Payload bits in the first byte
+
+// Maximum size of one token (a 32-bit payload) and of one record
+#define HK_DELTA_MAX_TOKEN_LEN  5
+#define HK_DELTA_MAX_LEN(count) (1 + ((uint16_t) (count) * HK_DELTA_MAX_TOKEN_LEN))
+
+// Value of since_keyframe that makes the next record a keyframe
+#define HK_DELTA_FORCE_KEYFRAME 0xFF
+
+// Default number of records between keyframes
+#define HK_DELTA_DEF_KEYFRAME_PERIOD 16
+
+// Decoder return values
+#define HK_DELTA_OK             0
+// Missed a record or haven't seen a keyframe yet, waiting for the next keyframe
+#define HK_DELTA_NEED_KEYFRAME  1
+// Malformed record
+#define HK_DELTA_INVALID        2
+
+// State of one encoder or decoder (one per message type)
+typedef struct {
+    // Number of fields per record
+    uint8_t count;
+    // Records between keyframes (0 to only send keyframes when forced)
+    uint8_t keyframe_period;
+    // Records since the last keyframe (HK_DELTA_FORCE_KEYFRAME if forced)
+    uint8_t since_keyframe;
+    // Sequence number of the next record
+    uint8_t seq;
+    // Decoder only - 1 if the last values are valid
+    uint8_t synced;
+    // Last value sent/received for each field (count entries)
+    uint32_t* last;
+} hk_delta_t;
+
+void init_hk_delta(hk_delta_t* state, uint32_t* last, uint8_t count,
+    uint8_t keyframe_period);
+void force_hk_keyframe(hk_delta_t* state);
+uint16_t encode_hk_delta(hk_delta_t* enc, const uint32_t* values,
+    uint8_t* buf, uint16_t buf_size);
+uint8_t decode_hk_delta(hk_delta_t* dec, const uint8_t* buf, uint16_t len,
+    uint32_t* values);
+
+#endif // CAN_HK_DELTA_H
@@ -0,0 +1,73 @@
+#ifndef CAN_HK_FIELDS_H
+#define CAN_HK_FIELDS_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <avr/pgmspace.h>
+
+#include <can/data_protocol.h>
+#include <conversions/conversions.h>
+
+// Units of converted housekeeping values
+typedef enum {
+    HK_UNIT_NONE,   // Raw value is used as-is (counts, reasons, IDs)
+    HK_UNIT_S,      // Seconds
+    HK_UNIT_V,      // Volts
+    HK_UNIT_A,      // Amperes
+    HK_UNIT_C,      // Degrees Celsius
+    HK_UNIT_PCT_RH, // Percent relative humidity
+    HK_UNIT_KPA,    // Kilopascals
+    HK_UNIT_DPS,    // Degrees per second
+    HK_UNIT_BITS,   // Bit field (one bit per channel)
+} hk_unit_t;
+
+// Converts a raw field value to its unit
+typedef double (*hk_conv_fn_t)(uint32_t raw);
+// Gets the current raw value of a field (provided by each subsystem)
+typedef uint32_t (*hk_get_fn_t)(void);
+
+// Describes one field of a housekeeping message
+typedef struct {
+    uint8_t field_num;
+    // Number of significant bits in the raw value
+    uint8_t width;
+    uint8_t unit;   // hk_unit_t
+    // NULL if the conversion depends on the board (e.g. voltage divider
+    // resistors), in which case the subsystem converts the value itself
+    hk_conv_fn_t conv;
+} hk_field_desc_t;
+
+// All fields of one message type
+typedef struct {
+    uint8_t msg_type;
+    // Number of fields, from the CAN_*_FIELD_COUNT constants
+    uint8_t count;
+    // If 1, every field is described by fields[0] (e.g. PAY optical)
+    uint8_t uniform;
+    // Descriptors in program memory, indexed by field number
+    const hk_field_desc_t* fields;
+} hk_table_t;
+
+// OBC housekeeping is not requested over CAN, so it has no message type
+#define HK_NO_MSG_TYPE 0x00
+
+extern const hk_table_t obc_hk_table;
+extern const hk_table_t eps_hk_table;
+extern const hk_table_t pay_hk_table;
+extern const hk_table_t pay_opt_table;
+
+const hk_table_t* get_hk_table(uint8_t msg_type);
+uint8_t get_hk_field(const hk_table_t* table, uint8_t field_num,
+    hk_field_desc_t* desc);
+double convert_hk_field(const hk_table_t* table, uint8_t field_num,
+    uint32_t raw);
+
+uint8_t encode_hk_msg(const hk_table_t* table, uint8_t field_num,
+    uint32_t raw, uint8_t* msg);
+uint8_t decode_hk_msg(const hk_table_t* table, const uint8_t* msg,
+    uint8_t* field_num, uint32_t* raw);
+uint8_t dispatch_hk_req(const hk_table_t* table, const hk_get_fn_t* getters,
+    const uint8_t* req, uint8_t* resp);
+
+#endif // CAN_HK_FIELDS_H
@@ -0,0 +1,21 @@
+#ifndef CAN_HK_PACKED_H
+#define CAN_HK_PACKED_H
+
+#include <stdint.h>
+
+#include <can/data_protocol.h>
+#include <can/hk_fields.h>
+
+void encode_hk_bulk_req(const hk_table_t* table, uint8_t first, uint8_t last,
+    uint8_t* req);
+uint8_t decode_hk_bulk_req(const hk_table_t* table, const uint8_t* req,
+    uint8_t* first, uint8_t* last);
+
+uint8_t is_hk_packed_frame(const uint8_t* frame);
+uint8_t pack_hk_frame(const hk_table_t* table, const hk_get_fn_t* getters,
+    uint8_t first, uint8_t last, uint8_t* frame);
+uint8_t unpack_hk_frame(const hk_table_t* table, const uint8_t* frame,
+    uint8_t last, uint32_t* values);
+uint8_t count_hk_frames(const hk_table_t* table, uint8_t first, uint8_t last);
+
+#endif // CAN_HK_PACKED_H
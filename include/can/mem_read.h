@@ -0,0 +1,48 @@
+#ifndef CAN_MEM_READ_H
+#define CAN_MEM_READ_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include <can/data_protocol.h>
+
+// Default window if the requester asks for 0
+#define MEM_READ_DEF_WINDOW 8
+
+// Number of data frames needed for len bytes
+#define MEM_READ_DATA_FRAMES(len) \
+    (((uint32_t) (len) + CAN_MEM_FRAME_DATA_LEN - 1) / CAN_MEM_FRAME_DATA_LEN)
+
+// State of one bulk read
+typedef struct {
+    uint8_t msg_type;
+    // Opcode of data frames and acknowledgements (CAN_*_CTRL_READ_MEM_DATA)
+    uint8_t opcode;
+    uint8_t active;
+    uint8_t space;
+    uint8_t window;
+    uint16_t addr;
+    uint16_t len;
+    // Total number of frames, including the CRC frame
+    uint16_t frames;
+    // Index of the next frame to send
+    uint16_t next;
+    // Number of frames acknowledged by the requester
+    uint16_t acked;
+    // CRC of the first crc_len bytes
+    uint16_t crc;
+    uint16_t crc_len;
+} mem_read_t;
+
+void init_mem_read(mem_read_t* read, uint8_t msg_type, uint8_t opcode);
+uint8_t start_mem_read(mem_read_t* read, const uint8_t* req, uint8_t* resp);
+void ack_mem_read(mem_read_t* read, const uint8_t* req);
+uint8_t next_mem_read_frame(mem_read_t* read, uint8_t* frame);
+
+#endif // CAN_MEM_READ_H
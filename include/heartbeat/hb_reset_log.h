@@ -0,0 +1,85 @@
+#ifndef HB_RESET_LOG_H
+#define HB_RESET_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <avr/eeprom.h>
+
+#include <utilities/eeprom_map.h>
+
+// The log is stored at HB_RESET_LOG_EEPROM_ADDR (see utilities/eeprom_map.h)
+// Number of entries kept (the oldest entries are overwritten)
+#ifndef HB_RESET_LOG_SIZE
+#define HB_RESET_LOG_SIZE           16
+#endif
+// Number of entries that can wait for flush_hb_reset_log()
+#ifndef HB_RESET_LOG_PENDING_SIZE
+#define HB_RESET_LOG_PENDING_SIZE   4
+#endif
+// Written before the log to know if it is valid
+#define HB_RESET_LOG_EEPROM_MAGIC   0x484C  // "HL"
+
+// Reasons for a reset
+#define HB_RESET_REASON_NO_RESP     0x01    // No response to a ping
+#define HB_RESET_REASON_MOB_BUSY    0x02    // Could not send the ping
+// Set in the reason if the escalation policy did not allow the reset (it was
+// only logged)
+#define HB_RESET_SUPPRESSED         0x80
+
+// Default escalation policy
+// Minimum time between two resets of the same peer, doubled after each reset
+#define HB_RESET_DEF_BACKOFF_S      (60UL * 60UL)
+// Maximum time between two resets of the same peer
+#define HB_RESET_DEF_MAX_BACKOFF_S  (24UL * 60UL * 60UL)
+// Maximum number of resets of the same peer in one window
+#define HB_RESET_DEF_MAX_RESETS     3
+#define HB_RESET_DEF_WINDOW_S       (24UL * 60UL * 60UL)
+
+// One entry of the reset log
+typedef struct {
+    // Uptime of this node when the reset was sent
+    uint32_t uptime_s;
+    // Heartbeat ID of the peer
+    uint8_t peer_id;
+    // HB_RESET_REASON_*, with HB_RESET_SUPPRESSED if not performed
+    uint8_t reason;
+    // Last restart count received from the peer
+    uint32_t peer_restart_count;
+} hb_reset_log_entry_t;
+
+// Escalation policy (applies to each peer separately)
+typedef struct {
+    uint32_t backoff_s;
+    uint32_t max_backoff_s;
+    uint8_t max_resets;
+    uint32_t window_s;
+} hb_reset_policy_t;
+
+// Escalation state of one peer
+typedef struct {
+    // If a reset was performed (last_reset_s is valid)
+    bool reset_sent;
+    uint32_t last_reset_s;
+    // Current minimum time between resets (0 before the first reset)
+    uint32_t backoff_s;
+    // Start and number of resets of the current window
+    uint32_t window_start_s;
+    uint8_t window_resets;
+} hb_reset_state_t;
+
+extern hb_reset_policy_t hb_reset_policy;
+// Number of entries dropped because too many were waiting to be written
+extern volatile uint16_t hb_reset_log_dropped;
+
+bool hb_reset_allowed(hb_reset_state_t* state, uint32_t now);
+void clear_hb_reset_backoff(hb_reset_state_t* state);
+
+void log_hb_reset(const hb_reset_log_entry_t* entry);
+uint8_t hb_reset_log_count(void);
+uint8_t read_hb_reset_log(uint8_t index, hb_reset_log_entry_t* entry);
+void clear_hb_reset_log(void);
+void queue_hb_reset_log(const hb_reset_log_entry_t* entry);
+uint8_t flush_hb_reset_log(void);
+
+#endif // HB_RESET_LOG_H
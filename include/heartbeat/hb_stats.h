@@ -0,0 +1,65 @@
+#ifndef HB_STATS_H
+#define HB_STATS_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+#include <string.h>
+
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+
+#include <timer/clock.h>
+#include <utilities/eeprom_map.h>
+
+// The statistics are stored at HB_STATS_EEPROM_ADDR (see
+// utilities/eeprom_map.h and save_hb_stats())
+// Written before the statistics to know if they are valid
+#define HB_STATS_EEPROM_MAGIC   0x4842  // "HB"
+
+// Gets the current time in milliseconds for round trip times
+typedef uint32_t (*hb_time_fn_t)(void);
+
+// Ping statistics of one peer
+typedef struct {
+    // Round trip times of successful pings (ms)
+    uint32_t last_rtt_ms;
+    uint32_t min_rtt_ms;
+    uint32_t max_rtt_ms;
+    // Sum of all round trip times (for the mean)
+    uint32_t total_rtt_ms;
+
+    // Number of successful pings
+    uint16_t num_pings;
+    // Number of successful pings that took more than half the wait time
+    uint16_t num_slow;
+    // Number of pings without a response
+    uint16_t num_misses;
+    // Number of pings without a response since the last successful one
+    uint8_t consec_misses;
+    uint8_t max_consec_misses;
+    // Number of times the peer was reset
+    uint16_t num_resets;
+
+    // Number of times the peer restarted (increase of its restart count
+    // between responses)
+    uint32_t restart_count_delta;
+    // Last restart count received, valid if restart_count_valid is 1
+    uint32_t last_restart_count;
+    uint8_t restart_count_valid;
+} hb_stats_t;
+
+void set_hb_time_fn(hb_time_fn_t fn);
+uint32_t hb_time_ms(void);
+
+void record_hb_rtt(hb_stats_t* stats, uint32_t rtt_ms, uint32_t wait_ms);
+void record_hb_miss(hb_stats_t* stats);
+void record_hb_reset(hb_stats_t* stats);
+void record_hb_restart_count(hb_stats_t* stats, uint32_t restart_count);
+
+uint8_t get_hb_stats(uint8_t id, hb_stats_t* stats);
+uint32_t get_hb_mean_rtt_ms(const hb_stats_t* stats);
+void reset_hb_stats(void);
+void save_hb_stats(void);
+uint8_t load_hb_stats(void);
+
+#endif // HB_STATS_H
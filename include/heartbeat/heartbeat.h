@@ -7,6 +7,9 @@
 #include <can/can.h>
 #include <can/ids.h>
 #include <uptime/uptime.h>
+#include <utilities/utilities.h>
+#include <heartbeat/hb_stats.h>
+#include <heartbeat/hb_reset_log.h>
 
 // OpCodes
 #define HB_PING_REQUEST 0x01
@@ -24,7 +27,18 @@
 #define HB_PAY 0x01
 #define HB_EPS 0x02
 
+// Number of nodes in the default node table (all_hb_devs)
 #define HB_NUM_DEVS 3
+// Maximum number of nodes in a node table (see set_hb_devs())
+// Node IDs must be 0 to HB_MAX_DEVS - 1, because HB_TX_MOB_ID() only has 2 bits
+// for the sender's ID
+#define HB_MAX_DEVS 4
+
+// ID tag of the TX MOb a sender uses to reach a receiver's heartbeat RX MOb
+// The sender's ID goes in bits 1-2, which are not in CAN_RX_MASK_ID, so
+// receivers can tell senders apart
+#define HB_TX_MOB_ID(rx_id, sender_id) \
+    (((rx_id) & CAN_RX_MASK_ID) | (((sender_id) & 0x03) << 1))
 
 // OBC resets EPS
 #define HB_OBC_RST_EPS_PIN  PC4
@@ -66,12 +80,19 @@
 #define HB_REQ_PERIOD_S    (3UL * 60UL * 60UL)
 // Number of seconds to wait for a response before sending a reset
 #define HB_RESP_WAIT_TIME_S 60
+// Minimum time a reset line is held low (if the clock is running)
+#define HB_RESET_PULSE_MS   10
 
 
 // Heartbeat device informataion
 typedef struct {
     char name[4];
     uint8_t id;
+    // MOb number used for this node (RX MOb on the node itself, TX MOb on the
+    // other nodes)
+    uint8_t mob_num;
+    // ID tag of the node's heartbeat RX MOb
+    uint16_t rx_id;
     mob_t mob;
 
     // When initiating request
@@ -81,13 +102,44 @@ typedef struct {
 
     // When responding to request
     bool send_resp_flag;
-    
+
+    // TX MOb is sending a message (cleared by the TX done or TX error
+    // callback)
+    bool tx_busy;
+    // Opcode of the message being loaded into the TX MOb (0 if none)
+    uint8_t tx_opcode;
+
     pin_info_t* reset;
+    // Reset line is asserted (released by run_hb())
+    bool reset_active;
+    // Time the reset line was asserted (millis(), or 0 if the clock is not
+    // running, and uptime_s)
+    uint32_t reset_start_ms;
+    uint32_t reset_start_s;
+    // Uptime when the last ping was started
     uint32_t ping_start_uptime_s;
+    // Uptime when the last frame was received from this node (implicit mode)
+    uint32_t last_seen_uptime_s;
+    // Times the last request was sent and the last response was received
+    // (from hb_time_ms())
+    uint32_t ping_start_ms;
+    uint32_t resp_time_ms;
+    hb_stats_t stats;
+    // Escalation state for resets of this node (see hb_reset_log.c)
+    hb_reset_state_t reset_state;
     uint8_t restart_reason;
     uint32_t restart_count;
 } hb_dev_t;
 
+// Reset line from one node to another
+typedef struct {
+    // Node that drives the reset line
+    uint8_t from_id;
+    // Node that is reset
+    uint8_t to_id;
+    pin_info_t* pin;
+} hb_reset_line_t;
+
 // Must all be volatile because they are modified inside CAN TX/RX interrupts
 // Don't initialize mobs here
 extern volatile hb_dev_t obc_hb_dev;
@@ -95,6 +147,14 @@ extern volatile hb_dev_t eps_hb_dev;
 extern volatile hb_dev_t pay_hb_dev;
 
 extern volatile hb_dev_t* all_hb_devs[];
+extern hb_reset_line_t all_hb_reset_lines[];
+
+// Node and reset line tables in use (all_hb_devs and all_hb_reset_lines unless
+// set_hb_devs() is called)
+extern volatile hb_dev_t** hb_devs;
+extern uint8_t hb_num_devs;
+extern hb_reset_line_t* hb_reset_lines;
+extern uint8_t hb_num_reset_lines;
 
 extern volatile hb_dev_t* self_hb_dev;
 
@@ -102,10 +162,19 @@ extern volatile uint32_t hb_req_prev_uptime_s;
 extern volatile uint32_t hb_req_period_s;
 extern volatile uint32_t hb_resp_wait_time_s;
 
+extern volatile bool hb_event_flag;
+extern volatile bool hb_implicit_mode;
+extern volatile uint32_t hb_silence_period_s;
+
 
+bool set_hb_devs(volatile hb_dev_t** devs, uint8_t num_devs,
+    hb_reset_line_t* reset_lines, uint8_t num_reset_lines);
 void init_hb(uint8_t self_id);
-bool wait_for_hb_mob_not_paused(mob_t* mob);
 bool send_hb_reset(hb_dev_t* device);
+void hb_tx_done_cb(uint8_t mob_num);
+void hb_tx_err_cb(uint8_t mob_num);
+void set_hb_implicit(bool enabled, uint32_t silence_period_s);
+void hb_can_rx_hook(uint8_t mob_num, uint16_t id);
 void run_hb(void);
 
 #endif // HEARTBEAT_H
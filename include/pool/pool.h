@@ -0,0 +1,49 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <util/atomic.h>
+
+// Handle returned when no block is available
+#define POOL_NO_BLOCK 0xFF
+// Maximum number of blocks in a pool (handles are one byte)
+#define POOL_MAX_BLOCKS 0xFF
+
+// Number of bytes of the map of free blocks (one bit per block)
+#define POOL_MAP_SIZE(num_blocks) (((uint16_t) (num_blocks) + 7) / 8)
+// Number of bytes of storage for a pool (the blocks, then the map of free
+// blocks)
+#define POOL_STORAGE_SIZE(block_size, num_blocks) \
+    ((uint16_t) (block_size) * (num_blocks) + POOL_MAP_SIZE(num_blocks))
+
+// Declares the storage for a pool of num_blocks blocks of block_size bytes
+#define POOL_STORAGE(name, block_size, num_blocks) \
+    uint8_t name[POOL_STORAGE_SIZE(block_size, num_blocks)]
+
+// Pool of fixed-size blocks
+typedef struct {
+    // Storage for all blocks (block_size * num_blocks bytes)
+    uint8_t* storage;
+    // Bit i is set if block i is free (after the blocks in the storage)
+    uint8_t* free_map;
+    // Number of bytes per block (at least 1)
+    uint8_t block_size;
+    // Number of blocks (at most POOL_MAX_BLOCKS)
+    uint8_t num_blocks;
+
+    // First free block (POOL_NO_BLOCK if none), each free block holds the
+    // handle of the next free block in its first byte
+    uint8_t free_head;
+    uint8_t free_count;
+} pool_t;
+
+void init_pool(pool_t* pool, uint8_t* storage, uint8_t block_size,
+    uint8_t num_blocks);
+uint8_t alloc_pool_block(pool_t* pool);
+void* get_pool_block(pool_t* pool, uint8_t handle);
+uint8_t free_pool_block(pool_t* pool, uint8_t handle);
+uint8_t pool_blocks_free(pool_t* pool);
+
+#endif // POOL_H
@@ -0,0 +1,128 @@
+#ifndef DECLARE_QUEUE_H
+#define DECLARE_QUEUE_H
+
+/*
+Queues with their own element type and capacity
+
+DECLARE_QUEUE(name, elem_type, capacity) declares a static queue called name
+(with type name_t) that stores capacity elements of elem_type, and static inline
+functions to use it:
+- void name_init(void)
+- uint8_t name_size(void)
+- uint8_t name_full(void)
+- uint8_t name_empty(void)
+- uint8_t name_enqueue(const elem_type* data)
+- uint8_t name_enqueue_front(const elem_type* data)
+- uint8_t name_peek(elem_type* data) - data can be NULL
+- uint8_t name_dequeue(elem_type* data) - data can be NULL
+The operations return 1 if successful, 0 otherwise, like queue.h.
+
+For example, DECLARE_QUEUE(cmd_queue, cmd_t, 8) only uses 2 + 8 * sizeof(cmd_t)
+bytes of SRAM. The queue is static, so declare it in the file that uses it.
+
+The capacity must be between 1 and 128. If it is a power of two, the indices
+wrap around with a mask instead of a comparison.
+
+Like queue_t, every operation uses an atomic block so the queue can be shared
+with interrupts.
+*/
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <util/atomic.h>
+
+// Wraps an index in [0, 2 * capacity) to [0, capacity) (constant folded)
+#define QUEUE_WRAP(index, capacity)                 \
+    ((((capacity) & ((capacity) - 1)) == 0) ?       \
+        ((index) & ((capacity) - 1)) :              \
+        (((index) >= (capacity)) ? ((index) - (capacity)) : (index)))
+
+#define DECLARE_QUEUE(name, elem_type, capacity)                            \
+    _Static_assert((capacity) > 0 && (capacity) <= 128,                     \
+        #name " capacity must be between 1 and 128");                       \
+                                                                            \
+    typedef struct {                                                        \
+        /* Index of the first element */                                    \
+        uint8_t head;                                                       \
+        /* Number of elements */                                            \
+        uint8_t size;                                                       \
+        elem_type content[capacity];                                        \
+    } name##_t;                                                             \
+                                                                            \
+    static name##_t name = { .head = 0, .size = 0 };                        \
+                                                                            \
+    static inline void name##_init(void) {                                  \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            name.head = 0;                                                  \
+            name.size = 0;                                                  \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_size(void) {                               \
+        return *((volatile uint8_t*) &name.size);                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_full(void) {                               \
+        return name##_size() == (capacity);                                 \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_empty(void) {                              \
+        return name##_size() == 0;                                          \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_enqueue(const elem_type* data) {           \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.size == (capacity)) {                                  \
+                return 0;                                                   \
+            }                                                               \
+            name.content[QUEUE_WRAP(name.head + name.size, (capacity))] =   \
+                *data;                                                      \
+            name.size += 1;                                                 \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_enqueue_front(const elem_type* data) {     \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.size == (capacity)) {                                  \
+                return 0;                                                   \
+            }                                                               \
+            name.head = QUEUE_WRAP(name.head + (capacity) - 1, (capacity)); \
+            name.content[name.head] = *data;                                \
+            name.size += 1;                                                 \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_peek(elem_type* data) {                    \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.size == 0) {                                           \
+                return 0;                                                   \
+            }                                                               \
+            if (data != NULL) {                                             \
+                *data = name.content[name.head];                            \
+            }                                                               \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_dequeue(elem_type* data) {                 \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.size == 0) {                                           \
+                return 0;                                                   \
+            }                                                               \
+            if (data != NULL) {                                             \
+                *data = name.content[name.head];                            \
+            }                                                               \
+            name.head = QUEUE_WRAP(name.head + 1, (capacity));              \
+            name.size -= 1;                                                 \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }
+
+#endif // DECLARE_QUEUE_H
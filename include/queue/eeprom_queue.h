@@ -0,0 +1,60 @@
+#ifndef EEPROM_QUEUE_H
+#define EEPROM_QUEUE_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <avr/eeprom.h>
+
+#include <queue/queue.h>
+#include <utilities/eeprom_map.h>
+
+// The default address and number of slots are EEPROM_QUEUE_DEF_ADDR and
+// EEPROM_QUEUE_DEF_NUM_SLOTS (see utilities/eeprom_map.h)
+
+// Returned by init_eeprom_queue() if the address or number of slots is invalid
+#define EEPROM_QUEUE_INIT_ERROR     0xFF
+
+// EEPROM slot layout
+#define EEPROM_QUEUE_STATE_OFFSET   0   // 1 byte
+#define EEPROM_QUEUE_SEQ_OFFSET     1   // 2 bytes
+#define EEPROM_QUEUE_DATA_OFFSET    3   // QUEUE_DATA_SIZE bytes
+#define EEPROM_QUEUE_CRC_OFFSET     (EEPROM_QUEUE_DATA_OFFSET + QUEUE_DATA_SIZE)
+#define EEPROM_QUEUE_SLOT_SIZE      (EEPROM_QUEUE_CRC_OFFSET + 2)
+
+// Slot states
+// Erased EEPROM, never used
+#define EEPROM_QUEUE_SLOT_ERASED    0xFF
+// Holds an element in the queue
+#define EEPROM_QUEUE_SLOT_VALID     0x5A
+// Element was removed (the sequence number is still valid)
+#define EEPROM_QUEUE_SLOT_DONE      0x00
+
+// Queue that keeps a copy of its elements in EEPROM
+typedef struct {
+    // Elements in RAM (reads don't touch the EEPROM)
+    queue_t queue;
+    // EEPROM slot and sequence number of each element (same indices as
+    // queue.content)
+    uint8_t slots[MAX_QUEUE_SIZE];
+    uint16_t seqs[MAX_QUEUE_SIZE];
+
+    // EEPROM address of the first slot
+    uint16_t addr;
+    uint8_t num_slots;
+    // Next slot to try for a new element
+    uint8_t next_slot;
+    // Sequence number of the next element added at the end
+    uint16_t next_seq;
+} eeprom_queue_t;
+
+uint8_t init_eeprom_queue(eeprom_queue_t* queue, uint16_t addr,
+    uint8_t num_slots);
+void clear_eeprom_queue(eeprom_queue_t* queue);
+uint8_t eeprom_queue_size(eeprom_queue_t* queue);
+uint8_t eeprom_enqueue(eeprom_queue_t* queue, const uint8_t* data);
+uint8_t eeprom_enqueue_front(eeprom_queue_t* queue, const uint8_t* data);
+uint8_t eeprom_peek_queue(eeprom_queue_t* queue, uint8_t* data);
+uint8_t eeprom_dequeue(eeprom_queue_t* queue, uint8_t* data);
+
+#endif // EEPROM_QUEUE_H
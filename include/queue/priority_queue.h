@@ -0,0 +1,47 @@
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <util/atomic.h>
+
+#include <queue/queue.h>
+
+// Maximum number of elements each priority queue can store
+#define MAX_PRIORITY_QUEUE_SIZE 8
+
+// Position of an element in the heap
+typedef struct {
+    // Priority (or deadline) - lowest comes out first
+    uint32_t key;
+    // Insertion order, for elements with the same key
+    uint32_t seq;
+    // Index of the element's data in content
+    uint8_t slot;
+} pq_entry_t;
+
+// Priority queue type (binary min-heap)
+typedef struct {
+    // Number of elements stored
+    uint8_t size;
+    // Sequence number for the next inserted element
+    uint32_t next_seq;
+    // Heap of keys, only these are moved around (not the data)
+    pq_entry_t heap[MAX_PRIORITY_QUEUE_SIZE];
+    // Stack of unused slots in content (MAX_PRIORITY_QUEUE_SIZE - size of them)
+    uint8_t free_slots[MAX_PRIORITY_QUEUE_SIZE];
+    // Element data (QUEUE_DATA_SIZE bytes, like queue_t)
+    uint8_t content[MAX_PRIORITY_QUEUE_SIZE][QUEUE_DATA_SIZE];
+} priority_queue_t;
+
+void init_priority_queue(priority_queue_t* queue);
+uint8_t priority_queue_size(priority_queue_t* queue);
+uint8_t priority_queue_full(priority_queue_t* queue);
+uint8_t priority_queue_empty(priority_queue_t* queue);
+uint8_t enqueue_priority(priority_queue_t* queue, uint32_t key,
+    const uint8_t* data);
+uint8_t peek_priority(priority_queue_t* queue, uint32_t* key, uint8_t* data);
+uint8_t dequeue_priority(priority_queue_t* queue, uint32_t* key, uint8_t* data);
+
+#endif // PRIORITY_QUEUE_H
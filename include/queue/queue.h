@@ -6,21 +6,67 @@
 
 #include <util/atomic.h>
 
+// Uncomment (or add -DQUEUE_STATS when compiling both lib-common and the
+// program) to collect statistics for each queue (see queue_stats_t)
+// #define QUEUE_STATS
+// This adds a field to queue_t, so lib-common and the program must be compiled
+// with the same setting. init_queue() is renamed with QUEUE_STATS, so a
+// mismatch fails to link instead of silently corrupting memory.
+#ifdef QUEUE_STATS
+#define init_queue init_queue_stats
+#endif
+
+#ifdef QUEUE_STATS
+#include <uptime/uptime.h>
+#endif
+
 // Maximum number of elements each queue can store
 #define MAX_QUEUE_SIZE 5
 // Number of bytes per element
 #define QUEUE_DATA_SIZE 8
 
-// Queue type
+#ifdef QUEUE_STATS
+// Queue statistics, to size MAX_QUEUE_SIZE from measured data
+typedef struct {
+    // Largest number of elements stored at once
+    uint8_t high_water;
+    // Number of elements rejected because the queue was full
+    uint16_t rejected;
+    // Number of elements inserted
+    uint32_t total;
+    // Longest time an element waited in the queue (uptime_s, in seconds)
+    uint32_t max_wait_s;
+    // Time each element was inserted (same indices as content)
+    uint32_t insert_time_s[MAX_QUEUE_SIZE];
+} queue_stats_t;
+#endif
+
+// Queue type (circular buffer)
 typedef struct {
     // Starting index of queue, points to first index stored
     uint8_t head;
     // Ending index of queue, points to next index to populate
     uint8_t tail;
+    // Number of elements stored
+    uint8_t size;
     // Queue data, static array dimensions
     uint8_t content[MAX_QUEUE_SIZE][QUEUE_DATA_SIZE];
+#ifdef QUEUE_STATS
+    queue_stats_t stats;
+#endif
 } queue_t;
-// NOTE: tail - head is always equal to the queue's size
+// NOTE: head and tail wrap around from MAX_QUEUE_SIZE - 1 to 0, so
+// (head + size) % MAX_QUEUE_SIZE is always equal to tail
+
+// Walks the elements of a queue in place (see init_queue_iter())
+typedef struct {
+    queue_t* queue;
+    // Number of elements already returned
+    uint8_t pos;
+} queue_iter_t;
+
+// Returns 1 if an element should be removed by remove_queue_if()
+typedef uint8_t (*queue_pred_t)(const uint8_t* data, void* arg);
 
 void init_queue(queue_t* queue);
 uint8_t queue_size(queue_t* queue);
@@ -31,5 +77,15 @@ uint8_t enqueue(queue_t* queue, const uint8_t* data);
 uint8_t enqueue_front(queue_t* queue, const uint8_t* data);
 uint8_t peek_queue(queue_t* queue, uint8_t* data);
 uint8_t dequeue(queue_t* queue, uint8_t* data);
+uint8_t enqueue_n(queue_t* queue, const uint8_t* data, uint8_t count);
+uint8_t dequeue_n(queue_t* queue, uint8_t* data, uint8_t count);
+uint8_t peek_queue_at(queue_t* queue, uint8_t index, uint8_t* data);
+void init_queue_iter(queue_iter_t* iter, queue_t* queue);
+const uint8_t* next_queue_iter(queue_iter_t* iter);
+uint8_t remove_queue_if(queue_t* queue, queue_pred_t pred, void* arg);
+#ifdef QUEUE_STATS
+void get_queue_stats(queue_t* queue, queue_stats_t* stats);
+void reset_queue_stats(queue_t* queue);
+#endif
 
 #endif // QUEUE_H
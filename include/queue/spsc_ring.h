@@ -0,0 +1,131 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+/*
+Single-producer/single-consumer ring buffers
+
+DECLARE_SPSC_RING(name, elem_type, capacity) declares a static ring called name
+(with type name_t) that passes up to capacity elements of elem_type from one
+producer to one consumer without disabling interrupts. This is meant for
+handing data from interrupts to the main loop (or the other way around).
+
+Producer only:
+- uint8_t name_push(const elem_type* data) - copies data into the ring
+- elem_type* name_alloc(void) - returns the next free slot (NULL if full) to
+  fill in place, the element is only visible once name_commit() is called
+- void name_commit(void)
+
+Consumer only:
+- uint8_t name_peek(elem_type* data)
+- uint8_t name_pop(elem_type* data) - data can be NULL
+- void name_clear(void) - drops all elements
+
+Either side:
+- uint8_t name_count(void)
+- uint8_t name_full(void)
+- uint8_t name_empty(void)
+
+The operations return 1 if successful, 0 otherwise, like queue.h.
+
+This works without atomic blocks because:
+- head is only written by the consumer and tail only by the producer
+- head and tail are single bytes (reads and writes are atomic on AVR)
+- they are free-running (wrapping at 256), so tail - head is always the number
+  of elements (which is why the capacity must be a power of two up to 128)
+- compiler barriers make sure an element is written before tail moves past it,
+  and read before head moves past it (the AVR core itself does not reorder
+  memory accesses)
+
+All interrupts count as a single producer (or consumer), since AVR interrupts
+do not nest unless an ISR enables them itself. Don't push from both an
+interrupt and the main loop.
+
+The ring is static, so declare it in the file that uses it.
+*/
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+// Prevents the compiler from moving memory accesses across this point
+#define SPSC_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+#define DECLARE_SPSC_RING(name, elem_type, capacity)                        \
+    _Static_assert((capacity) > 0 && (capacity) <= 128 &&                   \
+        ((capacity) & ((capacity) - 1)) == 0,                               \
+        #name " capacity must be a power of two up to 128");                \
+                                                                            \
+    typedef struct {                                                        \
+        /* Count of elements removed (written by the consumer only) */      \
+        volatile uint8_t head;                                              \
+        /* Count of elements added (written by the producer only) */        \
+        volatile uint8_t tail;                                              \
+        elem_type content[capacity];                                        \
+    } name##_t;                                                             \
+                                                                            \
+    static name##_t name = { .head = 0, .tail = 0 };                        \
+                                                                            \
+    static inline uint8_t name##_count(void) {                              \
+        return (uint8_t) (name.tail - name.head);                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_full(void) {                               \
+        return name##_count() == (capacity);                                \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_empty(void) {                              \
+        return name##_count() == 0;                                         \
+    }                                                                       \
+                                                                            \
+    static inline elem_type* name##_alloc(void) {                           \
+        uint8_t tail = name.tail;                                           \
+        if ((uint8_t) (tail - name.head) == (capacity)) {                   \
+            return NULL;                                                    \
+        }                                                                   \
+        SPSC_BARRIER();                                                     \
+        return &name.content[tail & ((capacity) - 1)];                      \
+    }                                                                       \
+                                                                            \
+    static inline void name##_commit(void) {                                \
+        SPSC_BARRIER();                                                     \
+        name.tail = name.tail + 1;                                          \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_push(const elem_type* data) {              \
+        elem_type* slot = name##_alloc();                                   \
+        if (slot == NULL) {                                                 \
+            return 0;                                                       \
+        }                                                                   \
+        *slot = *data;                                                      \
+        name##_commit();                                                    \
+        return 1;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_peek(elem_type* data) {                    \
+        uint8_t head = name.head;                                           \
+        if (name.tail == head) {                                            \
+            return 0;                                                       \
+        }                                                                   \
+        SPSC_BARRIER();                                                     \
+        *data = name.content[head & ((capacity) - 1)];                      \
+        return 1;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_pop(elem_type* data) {                     \
+        uint8_t head = name.head;                                           \
+        if (name.tail == head) {                                            \
+            return 0;                                                       \
+        }                                                                   \
+        SPSC_BARRIER();                                                     \
+        if (data != NULL) {                                                 \
+            *data = name.content[head & ((capacity) - 1)];                  \
+        }                                                                   \
+        SPSC_BARRIER();                                                     \
+        name.head = head + 1;                                               \
+        return 1;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline void name##_clear(void) {                                 \
+        name.head = name.tail;                                              \
+    }
+
+#endif // SPSC_RING_H
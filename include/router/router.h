@@ -0,0 +1,85 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+#include <string.h>
+
+#include <util/atomic.h>
+
+#include <pool/pool.h>
+
+// Maximum number of bytes per frame (one CAN message)
+#define ROUTER_FRAME_LEN 8
+// Number of frame buffers shared by all ports
+#define ROUTER_NUM_BUFS 8
+// Maximum number of frames waiting in each port (at most ROUTER_NUM_BUFS)
+#define ROUTER_PORT_QUEUE_SIZE 4
+
+// Handle returned when no buffer is available
+#define ROUTER_NO_BUF POOL_NO_BLOCK
+// Matches any destination or message type in a route
+#define ROUTER_ANY 0xFF
+
+// One frame buffer
+typedef struct {
+    uint8_t len;
+    uint8_t data[ROUTER_FRAME_LEN];
+} router_frame_t;
+
+// Sends a frame out of a port (e.g. loads a CAN TX MOb, sends a UART frame,
+// or processes the frame locally)
+// Returns - 1 if the frame was accepted, 0 if the port is busy (the router
+//     will try again later)
+typedef uint8_t (*router_out_fn_t)(const uint8_t* data, uint8_t len);
+
+// Output port
+typedef struct {
+    router_out_fn_t out;
+    // Maximum number of frames waiting in this port (1 to
+    // ROUTER_PORT_QUEUE_SIZE), frames are dropped past this limit
+    uint8_t max_depth;
+
+    // Handles of waiting frames (FIFO)
+    uint8_t queue[ROUTER_PORT_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t depth;
+
+    // Number of frames sent and dropped (saturate at 0xFFFF)
+    uint16_t sent;
+    uint16_t dropped;
+} router_port_t;
+
+// Default values for the state and counters of a `router_port_t` struct
+#define ROUTER_PORT(out, max_depth) { out, max_depth, { 0 }, 0, 0, 0, 0 }
+
+// Routing table entry, the first matching route is used
+typedef struct {
+    // Destination node (defined by the application) or ROUTER_ANY
+    uint8_t dest;
+    // Message type (byte 0 of the frame) or ROUTER_ANY
+    uint8_t msg_type;
+    // Index of the output port
+    uint8_t port;
+
+    // Number of frames forwarded and dropped (saturate at 0xFFFF)
+    uint16_t count;
+    uint16_t dropped;
+} router_route_t;
+
+// Default values for the counters of a `router_route_t` struct
+#define ROUTER_ROUTE(dest, msg_type, port) { dest, msg_type, port, 0, 0 }
+
+void init_router(router_route_t* routes, uint8_t num_routes,
+    router_port_t* ports, uint8_t num_ports);
+
+uint8_t alloc_router_buf(void);
+router_frame_t* get_router_buf(uint8_t handle);
+void free_router_buf(uint8_t handle);
+uint8_t router_bufs_free(void);
+
+uint8_t route_router_buf(uint8_t handle, uint8_t dest);
+uint8_t route_frame(uint8_t dest, const uint8_t* data, uint8_t len);
+uint8_t run_router(void);
+
+#endif // ROUTER_H
@@ -0,0 +1,60 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include <timer/clock.h>
+
+// Maximum number of tasks
+#define SCHED_MAX_TASKS 8
+// Returned by add_sched_task() if there is no space left
+#define SCHED_NO_TASK   0xFF
+
+// Function run for a task (must return, i.e. run to completion)
+typedef void (*sched_task_fn_t)(void);
+// Gets the current time in milliseconds
+typedef uint32_t (*sched_time_fn_t)(void);
+
+// Execution statistics of one task
+typedef struct {
+    // Number of times the task ran
+    uint16_t runs;
+    // Number of runs that finished after their deadline or skipped a period
+    // because they started too late (at most one per run)
+    uint16_t overruns;
+    // Longest execution time (us)
+    uint32_t max_exec_us;
+} sched_stats_t;
+
+typedef struct {
+    sched_task_fn_t fn;
+    // Time between runs (ms), 0 for a task that only runs on events
+    uint32_t period_ms;
+    // Time allowed from release to the end of the run (ms)
+    uint32_t deadline_ms;
+    // Time of the next periodic release
+    uint32_t next_ms;
+    // Time the pending events were first set
+    uint32_t event_ms;
+    // Event flags set by set_sched_event() and not handled yet
+    volatile uint8_t events;
+    sched_stats_t stats;
+} sched_task_t;
+
+void init_sched(void);
+void set_sched_time_fn(sched_time_fn_t fn);
+uint8_t add_sched_task(sched_task_fn_t fn, uint32_t period_ms,
+    uint32_t deadline_ms);
+void set_sched_event(uint8_t id, uint8_t events);
+uint8_t get_sched_events(void);
+uint8_t run_sched(void);
+
+uint8_t get_sched_stats(uint8_t id, sched_stats_t* stats);
+void reset_sched_stats(void);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,100 @@
+#ifndef DECLARE_STACK_H
+#define DECLARE_STACK_H
+
+/*
+Stacks with their own element type and capacity
+
+DECLARE_STACK(name, elem_type, capacity) declares a static stack called name
+(with type name_t) that stores capacity elements of elem_type, and static inline
+functions to use it:
+- void name_init(void)
+- uint8_t name_size(void)
+- uint8_t name_full(void)
+- uint8_t name_empty(void)
+- uint8_t name_push(const elem_type* data)
+- uint8_t name_peek(elem_type* data) - data can be NULL
+- uint8_t name_pop(elem_type* data) - data can be NULL
+The operations return 1 if successful, 0 otherwise, like stack.h.
+
+The stack is static, so declare it in the file that uses it. The capacity must
+be between 1 and 255.
+
+Like stack_t, every operation uses an atomic block so the stack can be shared
+with interrupts.
+*/
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <util/atomic.h>
+
+#define DECLARE_STACK(name, elem_type, capacity)                            \
+    _Static_assert((capacity) > 0 && (capacity) <= 255,                     \
+        #name " capacity must be between 1 and 255");                       \
+                                                                            \
+    typedef struct {                                                        \
+        /* Number of elements, points to the next index to populate */      \
+        uint8_t index;                                                      \
+        elem_type content[capacity];                                        \
+    } name##_t;                                                             \
+                                                                            \
+    static name##_t name = { .index = 0 };                                  \
+                                                                            \
+    static inline void name##_init(void) {                                  \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            name.index = 0;                                                 \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_size(void) {                               \
+        return *((volatile uint8_t*) &name.index);                          \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_full(void) {                               \
+        return name##_size() == (capacity);                                 \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_empty(void) {                              \
+        return name##_size() == 0;                                          \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_push(const elem_type* data) {              \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.index == (capacity)) {                                 \
+                return 0;                                                   \
+            }                                                               \
+            name.content[name.index] = *data;                               \
+            name.index += 1;                                                \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_peek(elem_type* data) {                    \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.index == 0) {                                          \
+                return 0;                                                   \
+            }                                                               \
+            if (data != NULL) {                                             \
+                *data = name.content[name.index - 1];                       \
+            }                                                               \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }                                                                       \
+                                                                            \
+    static inline uint8_t name##_pop(elem_type* data) {                     \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                 \
+            if (name.index == 0) {                                          \
+                return 0;                                                   \
+            }                                                               \
+            name.index -= 1;                                                \
+            if (data != NULL) {                                             \
+                *data = name.content[name.index];                           \
+            }                                                               \
+            return 1;                                                       \
+        }                                                                   \
+        return 0;                                                           \
+    }
+
+#endif // DECLARE_STACK_H
@@ -4,17 +4,44 @@
 #include <stdint.h>
 #include <stdlib.h> // for NULL
 
+#include <util/atomic.h>
+
+// Uncomment (or add -DSTACK_STATS when compiling both lib-common and the
+// program) to collect statistics for each stack (see stack_stats_t)
+// #define STACK_STATS
+// This adds a field to stack_t, so lib-common and the program must be compiled
+// with the same setting. init_stack() is renamed with STACK_STATS, so a
+// mismatch fails to link instead of silently corrupting memory.
+#ifdef STACK_STATS
+#define init_stack init_stack_stats
+#endif
+
 // Maximum number of elements each stack can store
 #define MAX_STACK_SIZE 5
 // Number of bytes per element
 #define STACK_DATA_SIZE 8
 
+#ifdef STACK_STATS
+// Stack statistics, to size MAX_STACK_SIZE from measured data
+typedef struct {
+    // Largest number of elements stored at once
+    uint8_t high_water;
+    // Number of elements rejected because the stack was full
+    uint16_t rejected;
+    // Number of elements pushed
+    uint32_t total;
+} stack_stats_t;
+#endif
+
 // Stack type
 typedef struct {
     // Ending index of stack, points to next index to populate
     uint8_t index;
     // Stack data, static array dimensions
     uint8_t content[MAX_STACK_SIZE][STACK_DATA_SIZE];
+#ifdef STACK_STATS
+    stack_stats_t stats;
+#endif
 } stack_t;
 // NOTE: index is always equal to the stack's size
 
@@ -24,5 +51,9 @@ uint8_t stack_empty(stack_t* stack);
 uint8_t push_stack(stack_t* stack, const uint8_t* data);
 uint8_t peek_stack(stack_t* stack, uint8_t* data);
 uint8_t pop_stack(stack_t* stack, uint8_t* data);
+#ifdef STACK_STATS
+void get_stack_stats(stack_t* stack, stack_stats_t* stats);
+void reset_stack_stats(stack_t* stack);
+#endif
 
 #endif // STACK_H
@@ -0,0 +1,28 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <timer/timer_wheel.h>
+
+// millis() has a resolution of 1 ms and micros() a resolution of 8 us (see
+// clock.c). The clock runs on the 16-bit timer (Timer 1) through the timer
+// wheel, so it can't be used with start_timer_16bit() or start_timer_16bit_ms().
+
+// Wrap-safe comparisons of millis() or micros() values (correct as long as the
+// times are less than 2^31 apart, i.e. 24.8 days for millis())
+// 1 if time a is after time b
+#define CLOCK_AFTER(a, b)       ((int32_t) ((uint32_t) (a) - (uint32_t) (b)) > 0)
+// 1 if time a is after or equal to time b
+#define CLOCK_AFTER_EQ(a, b)    ((int32_t) ((uint32_t) (a) - (uint32_t) (b)) >= 0)
+
+void init_clock(void);
+uint8_t clock_running(void);
+uint32_t millis(void);
+uint32_t micros(void);
+uint16_t micros_16bit(void);
+
+#endif // CLOCK_H
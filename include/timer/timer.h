@@ -9,16 +9,14 @@
 #include <utilities/utilities.h>
 
 
-//prescaler factor - divide F_CPU (main clock, 8MHz) by 1024
-#define PRESCALER 1024.0
-// timer clock period (ms)
-#define PERIOD ((PRESCALER / F_CPU) * 1000.0)
-//counter maximum (16-bit) p.127
-#define MAX_TIME_16BIT (PERIOD * 0xFFFF)
-//counter maximum (8 bit) p.127
-#define MAX_TIME_8BIT (PERIOD * 0xFF)
-// used to round double to int
-#define ROUND 0.5
+// timer counts per millisecond without a prescaler (8000 at 8 MHz)
+#define TIMER_COUNTS_PER_MS (F_CPU / 1000UL)
+// counts in a full period (compare value of 0xFF/0xFFFF) p.127
+#define TIMER_8BIT_COUNTS   0x100UL
+#define TIMER_16BIT_COUNTS  0x10000UL
+// longest period for the *_ms() functions (6.2 days at 8 MHz), the 8-bit timer
+// is also limited to 0xFFFF interrupts (35 minutes at 8 MHz)
+#define TIMER_MAX_MS        ((0xFFFFFFFFUL / TIMER_COUNTS_PER_MS) << 10)
 
 typedef void(*timer_fn_t)(void);
 
@@ -28,7 +26,10 @@ typedef struct {
     // that will occur to achieve the desired time, not including remainder time
     uint16_t max_time_ints;
     // remamining timer counter value after the desired time has ellapsed
+    // (compare value of the last interrupt)
     uint16_t remainder_time;
+    // clock select bits (CSn2:0) for the prescaler
+    uint8_t clock_sel;
     // The command to run once the desired time has passed
     timer_fn_t cmd;
     // Counts the number of interrupts that have occured for the timer
@@ -37,6 +38,8 @@ typedef struct {
 
 void start_timer_16bit(uint16_t seconds, timer_fn_t cmd);
 void start_timer_8bit(uint16_t seconds, timer_fn_t cmd);
+void start_timer_16bit_ms(uint32_t ms, timer_fn_t cmd);
+void start_timer_8bit_ms(uint32_t ms, timer_fn_t cmd);
 
 void stop_timer_16bit(void);
 void stop_timer_8bit(void);
@@ -0,0 +1,78 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdlib.h> // for NULL
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <timer/timer.h>
+
+// The wheel runs on the 16-bit timer (Timer 1) with a prescaler of 64 (8 us per
+// count at 8 MHz). The counter clears every TIMER_WHEEL_PERIOD_MS (input capture
+// interrupt, counted in wheel_periods), and compare channel B is set to the next
+// tick when a timer expires, so the ticks in between don't interrupt
+#define TIMER_WHEEL_PRESCALER       64
+// Timer counts per ms (125 at 8 MHz)
+#define TIMER_WHEEL_COUNTS_PER_MS   (F_CPU / 1000UL / TIMER_WHEEL_PRESCALER)
+#define TIMER_WHEEL_PERIOD_MS       500
+// Counts per period (62500 at 8 MHz, must fit in the 16-bit counter)
+#define TIMER_WHEEL_PERIOD_COUNTS   \
+    (TIMER_WHEEL_PERIOD_MS * TIMER_WHEEL_COUNTS_PER_MS)
+
+// Each level of the wheel has 2^TIMER_WHEEL_SLOT_BITS slots, and each slot of a
+// level covers as much time as a full turn of the level below it
+// With 4 levels of 16 slots, timers up to 65.5 s are placed directly, longer
+// ones are moved down every 4.1 s until they are close enough
+#define TIMER_WHEEL_SLOT_BITS   4
+#define TIMER_WHEEL_NUM_SLOTS   (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK   (TIMER_WHEEL_NUM_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS      4
+
+// Maximum number of deferred callbacks waiting for run_timer_wheel()
+// (must be a power of two)
+#define TIMER_WHEEL_DEFERRED_SIZE 8
+
+// Flags for init_wheel_timer()
+// Call the callback from run_timer_wheel() in the main loop instead of the
+// timer interrupt
+#define WHEEL_TIMER_DEFERRED    0x01
+
+// Internal flag - the callback is waiting for run_timer_wheel()
+#define WHEEL_TIMER_QUEUED      0x80
+
+typedef struct wheel_timer {
+    // Links in the wheel slot (pprev is NULL if the timer is not running)
+    struct wheel_timer* next;
+    struct wheel_timer** pprev;
+    // Tick (ms) when the timer expires
+    uint32_t expires;
+    // Number of ticks between callbacks, 0 for a one-shot timer
+    uint32_t period_ms;
+    timer_fn_t cb;
+    // WHEEL_TIMER_* flags
+    uint8_t flags;
+} wheel_timer_t;
+
+// Tick (ms) the wheel has been processed up to (can be behind millis() until
+// the next timer expires)
+extern volatile uint32_t wheel_ms;
+// Number of TIMER_WHEEL_PERIOD_MS periods of the hardware timer since
+// init_timer_wheel() (for the clock)
+extern volatile uint32_t wheel_periods;
+// Number of deferred callbacks that were dropped because too many were waiting
+extern volatile uint16_t wheel_deferred_dropped;
+
+void init_timer_wheel(void);
+uint8_t timer_wheel_started(void);
+void advance_timer_wheel(uint32_t now_ms);
+void run_timer_wheel(void);
+
+void init_wheel_timer(wheel_timer_t* timer, timer_fn_t cb, uint8_t flags);
+void start_wheel_timer(wheel_timer_t* timer, uint32_t delay_ms,
+    uint32_t period_ms);
+void stop_wheel_timer(wheel_timer_t* timer);
+uint8_t wheel_timer_running(wheel_timer_t* timer);
+
+#endif // TIMER_WHEEL_H
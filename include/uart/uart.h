@@ -35,6 +35,15 @@ This is probably better than 1 MHz so we can reach higher UART baud rates.
 
 #define PRINT_BUF_SIZE 80
 
+// Number of received characters that can wait to be processed (power of 2)
+#ifndef UART_RX_RING_SIZE
+#define UART_RX_RING_SIZE 16
+#endif
+// Number of log records that can wait to be printed (power of 2)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 16
+#endif
+
 // UART TXD is pin PD3
 // UART RXD is pin PD4
 
@@ -52,10 +61,15 @@ void set_uart_rx_cb(uart_rx_cb_t cb);
 uint8_t get_uart_rx_count(void);
 uint8_t* get_uart_rx_buf(void);
 void clear_uart_rx_buf(void);
+void set_uart_rx_deferred(uint8_t deferred);
+void run_uart_rx(void);
 
 // Printing (from log.c)
 int16_t print(char* fmt, ...);
 void print_bytes(uint8_t* data, uint16_t len);
 uint8_t* get_print_buf(void);
+uint8_t log_record(uint8_t code, uint32_t value);
+uint8_t flush_log_records(void);
+uint16_t get_log_records_dropped(void);
 
 #endif // UART_H
@@ -5,14 +5,14 @@
 
 #include <avr/eeprom.h>
 
-#include <timer/timer.h>
+#include <timer/timer_wheel.h>
 #include <uart/uart.h>
+#include <utilities/eeprom_map.h>
 #include <watchdog/watchdog.h>
 
-// EEPROM address for storing number of resets
-#define RESTART_COUNT_EEPROM_ADDR   0x10
-// EEPROM address for storing reason for last reset
-#define RESTART_REASON_EEPROM_ADDR  0x14
+// EEPROM addresses for storing the number of resets and the reason for the last
+// reset are RESTART_COUNT_EEPROM_ADDR and RESTART_REASON_EEPROM_ADDR (see
+// utilities/eeprom_map.h)
 
 // Number of seconds between timer callbacks
 #define UPTIME_TIMER_PERIOD 1
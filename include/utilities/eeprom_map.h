@@ -0,0 +1,37 @@
+#ifndef EEPROM_MAP_H
+#define EEPROM_MAP_H
+
+// EEPROM address map - every region of EEPROM used by lib-common is defined
+// here, so libraries can check for overlaps without including each other
+// Regions that hold arrays reserve a fixed number of bytes, and their libraries
+// check at compile time that the data fits
+
+// Restart count and reason (uptime, 4 bytes each)
+#define RESTART_COUNT_EEPROM_ADDR   0x10
+#define RESTART_REASON_EEPROM_ADDR  0x14
+// Number of bytes from RESTART_COUNT_EEPROM_ADDR
+#define RESTART_EEPROM_SIZE         8
+
+// Heartbeat statistics of up to HB_MAX_DEVS nodes (see save_hb_stats())
+#ifndef HB_STATS_EEPROM_ADDR
+#define HB_STATS_EEPROM_ADDR        0x100
+#endif
+#define HB_STATS_EEPROM_SIZE        0x100
+
+// Heartbeat reset log (header and HB_RESET_LOG_SIZE entries)
+#ifndef HB_RESET_LOG_EEPROM_ADDR
+#define HB_RESET_LOG_EEPROM_ADDR    (HB_STATS_EEPROM_ADDR + HB_STATS_EEPROM_SIZE)
+#endif
+#define HB_RESET_LOG_EEPROM_SIZE    0x100
+
+// Default slots of the EEPROM queue (see init_eeprom_queue())
+// More slots spread the writes over more of the EEPROM, there must be more than
+// MAX_QUEUE_SIZE
+#ifndef EEPROM_QUEUE_DEF_ADDR
+#define EEPROM_QUEUE_DEF_ADDR       0x400
+#endif
+#ifndef EEPROM_QUEUE_DEF_NUM_SLOTS
+#define EEPROM_QUEUE_DEF_NUM_SLOTS  32
+#endif
+
+#endif // EEPROM_MAP_H
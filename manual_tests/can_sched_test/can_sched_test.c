@@ -0,0 +1,90 @@
+/*
+Time-triggered CAN schedule test
+
+Sends two periodic messages from a schedule table and prints how many were
+sent and missed every second. Connect another board running can_print_rx to
+see the messages on the bus.
+
+With no other board on the bus (no ack), nothing should be counted as sent and
+every slot after the first should be counted as missed.
+*/
+
+#include <uart/uart.h>
+#include <can/can.h>
+#include <can/can_sched.h>
+#include <utilities/utilities.h>
+
+void fast_producer(uint8_t*, uint8_t*);
+void slow_producer(uint8_t*, uint8_t*);
+
+mob_t fast_mob = {
+    .mob_num = 0,
+    .mob_type = TX_MOB,
+    .id_tag = { 0x0001 },
+    .ctrl = default_tx_ctrl,
+};
+
+mob_t slow_mob = {
+    .mob_num = 1,
+    .mob_type = TX_MOB,
+    .id_tag = { 0x0002 },
+    .ctrl = default_tx_ctrl,
+};
+
+can_sched_entry_t schedule[] = {
+    {
+        .mob = &fast_mob,
+        .period = CAN_SCHED_MS_TO_SLOTS(250),
+        .offset = 0,
+        .producer = fast_producer,
+    },
+    {
+        // Offset so it is sent halfway between two fast messages
+        .mob = &slow_mob,
+        .period = CAN_SCHED_MS_TO_SLOTS(1000),
+        .offset = CAN_SCHED_MS_TO_SLOTS(125),
+        .producer = slow_producer,
+    },
+};
+
+uint8_t fast_count = 0;
+uint8_t slow_count = 0;
+
+void fast_producer(uint8_t* data, uint8_t* len) {
+    *len = 2;
+    data[0] = 0xAA;
+    data[1] = fast_count++;
+}
+
+void slow_producer(uint8_t* data, uint8_t* len) {
+    *len = 2;
+    data[0] = 0xBB;
+    data[1] = slow_count++;
+}
+
+int main(void) {
+    init_uart();
+    print("\n\nStarting CAN schedule test\n");
+    print("Slot length: %lu us\n", CAN_SCHED_SLOT_US);
+
+    init_can();
+    init_tx_mob(&fast_mob);
+    init_tx_mob(&slow_mob);
+
+    init_can_sched(schedule, sizeof(schedule) / sizeof(schedule[0]));
+    start_can_sched();
+
+    while (1) {
+        _delay_ms(1000);
+
+        for (uint8_t i = 0; i < sizeof(schedule) / sizeof(schedule[0]); i++) {
+            uint16_t sent = 0;
+            uint16_t missed = 0;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                sent = schedule[i].sent_count;
+                missed = schedule[i].missed_count;
+            }
+            print("Entry %u: sent = %u, missed = %u\n", i, sent, missed);
+        }
+    }
+}
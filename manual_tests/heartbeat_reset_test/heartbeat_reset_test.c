@@ -103,7 +103,10 @@ int main() {
 
     print_cmds();
     print("Press 'h' at any time to list the commands\n");
-    while (1) {}
+    while (1) {
+        // Releases the reset lines
+        run_hb();
+    }
 
     return 0;
 }
@@ -19,6 +19,10 @@ Full test of the heartbeat system
 // Uncomment to overwrite hb_resp_wait_time_s
 #define RESP_WAIT_TIME  5
 
+// Uncomment to use implicit heartbeat (only ping after this many seconds
+// without any frame from a peer)
+// #define IMPLICIT_SILENCE 30
+
 // Uncomment to ignore received pings and not respond
 // #define IGNORE_PINGS
 
@@ -56,6 +60,9 @@ int main(void) {
 
 #ifndef IGNORE_PINGS
     init_hb(SELF_ID);
+#ifdef IMPLICIT_SILENCE
+    set_hb_implicit(true, IMPLICIT_SILENCE);
+#endif
     print("Initialized heartbeat\n");
 #else
     print("Skipped initializing heartbeat\n");
@@ -81,10 +88,24 @@ int main(void) {
             for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
                 hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
                 print("%s: count = %lu, reason = %u\n", dev->name, dev->restart_count, dev->restart_reason);
+                print("%s: rtt = %lu ms (min %lu, max %lu, mean %lu), pings = %u, misses = %u, resets = %u\n",
+                    dev->name, dev->stats.last_rtt_ms, dev->stats.min_rtt_ms,
+                    dev->stats.max_rtt_ms, get_hb_mean_rtt_ms(&dev->stats),
+                    dev->stats.num_pings, dev->stats.num_misses, dev->stats.num_resets);
             }
 
             print("Stored count: %lu\n", restart_count);
             print("Stored reason: %u\n", restart_reason);
+
+            uint8_t count = hb_reset_log_count();
+            print("Reset log: %u entries\n", count);
+            for (uint8_t i = 0; i < count; i++) {
+                hb_reset_log_entry_t entry;
+                read_hb_reset_log(i, &entry);
+                print("%lu s: peer = %u, reason = 0x%.2x, peer count = %lu\n",
+                    entry.uptime_s, entry.peer_id, entry.reason,
+                    entry.peer_restart_count);
+            }
         }
 #endif
 
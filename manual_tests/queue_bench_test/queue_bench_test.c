@@ -0,0 +1,223 @@
+/*
+Measures the worst-case number of CPU cycles each queue operation takes (all
+of it is spent with interrupts disabled), for the circular queue in the queue
+library and for the previous implementation that shifted the elements when
+reaching either end of the array (copied below as legacy_*).
+
+Timer 1 runs without a prescaler, so TCNT1 counts CPU cycles. The cost of
+reading the timer is measured first and subtracted.
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <queue/queue.h>
+#include <uart/uart.h>
+
+// Number of times to run the workload
+#define NUM_ROUNDS 50
+
+
+// Previous implementation (shifting the elements, clearing removed elements)
+
+typedef struct {
+    uint8_t head;
+    uint8_t tail;
+    uint8_t content[MAX_QUEUE_SIZE][QUEUE_DATA_SIZE];
+} legacy_queue_t;
+
+uint8_t legacy_size(legacy_queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        return (queue->tail - queue->head);
+    }
+    return 0;
+}
+
+uint8_t legacy_full(legacy_queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        return (legacy_size(queue) == MAX_QUEUE_SIZE);
+    }
+    return 0;
+}
+
+uint8_t legacy_empty(legacy_queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        return (legacy_size(queue) == 0);
+    }
+    return 0;
+}
+
+void legacy_shift_left(legacy_queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t i = queue->head; i < queue->tail; i++) {
+            for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
+                queue->content[i - queue->head][j] = queue->content[i][j];
+                queue->content[i][j] = 0x00;
+            }
+        }
+        queue->tail = (queue->tail) - (queue->head);
+        queue->head = 0;
+    }
+}
+
+void legacy_shift_right(legacy_queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t i = queue->tail; i > queue->head; i-=1) {
+            for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
+                queue->content[i][j] = queue->content[i - 1][j];
+                queue->content[i - 1][j] = 0x00;
+            }
+        }
+        queue->tail += 1;
+        queue->head += 1;
+    }
+}
+
+uint8_t legacy_enqueue(legacy_queue_t* queue, const uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (legacy_full(queue)) {
+            return 0;
+        }
+        if (queue->tail == MAX_QUEUE_SIZE) {
+            legacy_shift_left(queue);
+        }
+        for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+            queue->content[queue->tail][i] = data[i];
+        }
+        queue->tail += 1;
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t legacy_enqueue_front(legacy_queue_t* queue, const uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (legacy_full(queue)) {
+            return 0;
+        }
+        if (queue->head == 0) {
+            legacy_shift_right(queue);
+        }
+        queue->head -= 1;
+        for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+            queue->content[queue->head][i] = data[i];
+        }
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t legacy_dequeue(legacy_queue_t* queue, uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (legacy_empty(queue)) {
+            return 0;
+        }
+        if (data != NULL) {
+            for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+                data[i] = queue->content[queue->head][i];
+            }
+        }
+        for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+            queue->content[queue->head][i] = 0x00;
+        }
+        queue->head += 1;
+        return 1;
+    }
+    return 0;
+}
+
+
+// Worst-case cycles for each operation
+typedef struct {
+    uint16_t enqueue;
+    uint16_t enqueue_front;
+    uint16_t dequeue;
+} bench_t;
+
+queue_t queue;
+legacy_queue_t legacy;
+uint8_t elem[QUEUE_DATA_SIZE] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+uint8_t out[QUEUE_DATA_SIZE];
+uint16_t overhead = 0;
+
+// Runs an expression and updates the maximum cycle count
+#define MEASURE(max, expr) do {         \
+    uint16_t start = TCNT1;             \
+    expr;                               \
+    uint16_t cycles = TCNT1 - start;    \
+    cycles -= overhead;                 \
+    if (cycles > (max)) {               \
+        (max) = cycles;                 \
+    }                                   \
+} while (0)
+
+void init_cycle_counter(void) {
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TCNT1 = 0;
+
+    uint16_t max = 0;
+    MEASURE(max, );
+    overhead = max;
+}
+
+// Workload hitting every case of both implementations: filling up, wrapping
+// (or shifting) at the end of the array, and inserting at the front when the
+// head is at index 0
+void run_bench(bench_t* ring, bench_t* old) {
+    init_queue(&queue);
+    legacy.head = 0;
+    legacy.tail = 0;
+
+    for (uint8_t round = 0; round < NUM_ROUNDS; round++) {
+        for (uint8_t i = 0; i < MAX_QUEUE_SIZE - 1; i++) {
+            MEASURE(ring->enqueue, enqueue(&queue, elem));
+            MEASURE(old->enqueue, legacy_enqueue(&legacy, elem));
+        }
+        for (uint8_t i = 0; i < MAX_QUEUE_SIZE - 2; i++) {
+            MEASURE(ring->dequeue, dequeue(&queue, out));
+            MEASURE(old->dequeue, legacy_dequeue(&legacy, out));
+        }
+        for (uint8_t i = 0; i < MAX_QUEUE_SIZE - 2; i++) {
+            MEASURE(ring->enqueue, enqueue(&queue, elem));
+            MEASURE(old->enqueue, legacy_enqueue(&legacy, elem));
+        }
+        while (!queue_empty(&queue)) {
+            MEASURE(ring->dequeue, dequeue(&queue, out));
+            MEASURE(old->dequeue, legacy_dequeue(&legacy, out));
+        }
+        for (uint8_t i = 0; i < MAX_QUEUE_SIZE - 1; i++) {
+            MEASURE(ring->enqueue_front, enqueue_front(&queue, elem));
+            MEASURE(old->enqueue_front, legacy_enqueue_front(&legacy, elem));
+        }
+        while (!queue_empty(&queue)) {
+            MEASURE(ring->dequeue, dequeue(&queue, out));
+            MEASURE(old->dequeue, legacy_dequeue(&legacy, out));
+        }
+    }
+}
+
+int main(void) {
+    init_uart();
+    print("\n\nStarting queue benchmark\n");
+    print("MAX_QUEUE_SIZE = %u, QUEUE_DATA_SIZE = %u\n",
+        MAX_QUEUE_SIZE, QUEUE_DATA_SIZE);
+
+    init_cycle_counter();
+    print("Measurement overhead: %u cycles\n", overhead);
+
+    bench_t ring = { 0 };
+    bench_t old = { 0 };
+    run_bench(&ring, &old);
+
+    print("Worst case cycles (interrupts disabled):\n");
+    print("%-15s %8s %8s\n", "", "before", "after");
+    print("%-15s %8u %8u\n", "enqueue", old.enqueue, ring.enqueue);
+    print("%-15s %8u %8u\n", "enqueue_front", old.enqueue_front,
+        ring.enqueue_front);
+    print("%-15s %8u %8u\n", "dequeue", old.dequeue, ring.dequeue);
+
+    print("Done\n");
+    while (1) {}
+    return 0;
+}
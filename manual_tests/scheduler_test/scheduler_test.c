@@ -0,0 +1,66 @@
+/*
+This program runs a few main loop services with the scheduler and prints their
+statistics every 5 seconds. Type characters over UART to trigger the
+event-driven task.
+*/
+
+#include <scheduler/scheduler.h>
+#include <uart/uart.h>
+#include <uptime/uptime.h>
+
+uint8_t rx_task = SCHED_NO_TASK;
+uint8_t stats_task = SCHED_NO_TASK;
+
+// Called from the UART RX interrupt
+uint8_t uart_rx_cb(const uint8_t* data, uint8_t len) {
+    set_sched_event(rx_task, 1);
+    // Discard the characters
+    return len;
+}
+
+void rx_task_fn(void) {
+    print("RX event\n");
+}
+
+void log_task_fn(void) {
+    log_record(0x01, millis());
+    flush_log_records();
+}
+
+// Busy task to show the execution time and overruns
+void busy_task_fn(void) {
+    _delay_ms(3);
+}
+
+void print_stats(void) {
+    print("\nuptime = %lu s, millis = %lu ms\n", uptime_s, millis());
+    for (uint8_t i = 0; i <= stats_task; i++) {
+        sched_stats_t stats;
+        if (get_sched_stats(i, &stats)) {
+            print("task %u: runs = %u, overruns = %u, max = %lu us\n",
+                i, stats.runs, stats.overruns, stats.max_exec_us);
+        }
+    }
+    reset_sched_stats();
+}
+
+int main(void) {
+    init_uart();
+    print("\n\nStarting test\n");
+
+    init_uptime();
+    init_sched();
+
+    rx_task = add_sched_task(rx_task_fn, 0, 10);
+    set_uart_rx_cb(uart_rx_cb);
+    add_sched_task(log_task_fn, 1000, 0);
+    // Deadline shorter than its execution time, so every run is an overrun
+    add_sched_task(busy_task_fn, 50, 2);
+    stats_task = add_sched_task(print_stats, 5000, 0);
+
+    while (1) {
+        run_sched();
+    }
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <can/can.h>
 #include <uart/uart.h>
+#include <queue/spsc_ring.h>
 
 // Uncomment for extra print statements
 // #define CAN_DEBUG
@@ -14,6 +15,22 @@ mob_t* mob_array[6] = {0};
 
 volatile uint8_t boffit_count = 0;
 
+// Called from the CAN ISR every time the CAN timer overflows
+can_timer_callback_t can_timer_cb = NULL;
+// Called for every received frame (NULL if not used)
+can_rx_hook_t can_rx_hook = NULL;
+
+// Frames received by RX MObs without an RX callback (the CAN ISR is the
+// producer, get_can_rx_frame() in the main loop is the consumer)
+DECLARE_SPSC_RING(can_rx_ring, can_rx_frame_t, CAN_RX_RING_SIZE)
+// Number of frames dropped because can_rx_ring was full or no buffer was free
+// (ISR only)
+volatile uint16_t can_rx_dropped = 0;
+// Buffers for frames received by RX MObs without an RX callback, instead of
+// can_rx_ring (NULL if not used, see set_can_rx_buf_fns())
+can_rx_alloc_fn_t can_rx_alloc_fn = NULL;
+can_rx_commit_fn_t can_rx_commit_fn = NULL;
+
 // Selects the relevant mob from the CANPAGE register, in order to access
 // registers that are duplicated for each mob
 void select_mob(uint8_t mob_num) {
@@ -252,6 +269,14 @@ void init_tx_mob(mob_t* mob) {
 void handle_rx_interrupt(mob_t* mob) {
     select_mob(mob->mob_num);
 
+    // The ID registers hold the ID of the received frame until they are reset
+    // below, so this is the only place the sender can be read from
+    if (can_rx_hook != NULL) {
+        uint16_t id = ((uint16_t) CANIDT1 << 3) | (CANIDT2 >> 5);
+        can_rx_hook(mob->mob_num, id);
+        select_mob(mob->mob_num);
+    }
+
     // we must reset the ID and various flags because they
     // have been copied over from the sender
     set_id_tag(mob->id_tag);
@@ -266,14 +291,48 @@ void handle_rx_interrupt(mob_t* mob) {
 
     CANPAGE &= ~(0x07); // reset data buffer index
 
+    // Frames for the main loop are read straight into a buffer if the
+    // application provides them (see set_can_rx_buf_fns())
+    uint8_t* data = mob->data;
+    can_rx_frame_t* buf = NULL;
+    uint8_t buf_handle = 0;
+    if (mob->rx_cb == NULL && can_rx_alloc_fn != NULL) {
+        buf = can_rx_alloc_fn(&buf_handle);
+        if (buf != NULL) {
+            data = buf->data;
+        }
+    }
+
     // Reads data from CANMSG
     // reading auto-increments the data buffer index
     for (uint8_t j = 0; j < len; j++) {
-        (mob->data)[j] = CANMSG;
+        data[j] = CANMSG;
     }
 
-    // executes rx callback
-    (mob->rx_cb)(mob->data, len);
+    // executes rx callback, or hands the frame to the main loop
+    if (mob->rx_cb != NULL) {
+        (mob->rx_cb)(mob->data, len);
+    } else if (can_rx_alloc_fn != NULL) {
+        if (buf != NULL) {
+            buf->mob_num = mob->mob_num;
+            buf->len = len;
+        }
+        if (buf == NULL || !can_rx_commit_fn(buf_handle)) {
+            can_rx_dropped += 1;
+        }
+    } else {
+        can_rx_frame_t* frame = can_rx_ring_alloc();
+        if (frame != NULL) {
+            frame->mob_num = mob->mob_num;
+            frame->len = len;
+            for (uint8_t j = 0; j < len; j++) {
+                frame->data[j] = (mob->data)[j];
+            }
+            can_rx_ring_commit();
+        } else {
+            can_rx_dropped += 1;
+        }
+    }
 
     // clear interrupt flag
     CANSTMOB &= ~(_BV(RXOK));
@@ -293,6 +352,11 @@ void handle_tx_interrupt(mob_t* mob) {
     // this is why we must resume the mob if there is still data left to send
 
     pause_mob(mob);
+
+    // Lets the sender know the MOb is free without polling is_paused()
+    if (mob->tx_done_cb != NULL) {
+        (mob->tx_done_cb)(mob->mob_num);
+    }
 }
 
 // Returns contents of CANSTMOB register
@@ -376,6 +440,98 @@ void set_can_baud_rate(can_baud_rate_t baud_rate){
     }
 }
 
+/*
+Sets a function to be called (from the CAN interrupt) with the MOb number and
+ID of every received frame, e.g. to track which nodes are alive. There is only
+one hook, so a new hook should call the one it replaces (chain it), and put it
+back when it is removed.
+hook - function to call, or NULL to remove the hook
+Returns - the hook that was set before (NULL if none)
+*/
+can_rx_hook_t set_can_rx_hook(can_rx_hook_t hook) {
+    can_rx_hook_t prev;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        prev = can_rx_hook;
+        can_rx_hook = hook;
+    }
+    return prev;
+}
+
+/*
+Sets functions that provide buffers for the frames received by RX MObs without
+an RX callback. The CAN interrupt then reads each frame straight into a buffer
+and passes its handle on, instead of copying it into the queue for
+get_can_rx_frame(). See set_can_rx_pool() for buffers from a pool.
+alloc_fn - gets a buffer, or NULL to go back to get_can_rx_frame()
+commit_fn - hands a filled buffer on
+*/
+void set_can_rx_buf_fns(can_rx_alloc_fn_t alloc_fn,
+        can_rx_commit_fn_t commit_fn) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        can_rx_commit_fn = commit_fn;
+        can_rx_alloc_fn = (commit_fn != NULL) ? alloc_fn : NULL;
+    }
+}
+
+/*
+Gets the oldest frame received by an RX MOb that has no RX callback (rx_cb is
+NULL). This never disables interrupts. Only call it from one context (normally
+the main loop).
+frame - will be populated with the frame
+Returns - 1 if a frame was received, 0 otherwise
+*/
+uint8_t get_can_rx_frame(can_rx_frame_t* frame) {
+    return can_rx_ring_pop(frame);
+}
+
+/*
+Returns - number of received frames waiting for get_can_rx_frame()
+*/
+uint8_t get_can_rx_frame_count(void) {
+    return can_rx_ring_count();
+}
+
+/*
+Returns - number of frames dropped because too many were waiting for
+get_can_rx_frame()
+*/
+uint16_t get_can_rx_dropped(void) {
+    uint16_t dropped;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dropped = can_rx_dropped;
+    }
+    return dropped;
+}
+
+/*
+Starts the CAN timer (CANTIM) and calls a function every time it overflows.
+The CAN timer is clocked at CLK_IO / (8 * (prescaler + 1)) (p.265), so with
+the 8 MHz clock it overflows every 65.536 ms * (prescaler + 1). Using it does
+not take up either of the general purpose timers.
+prescaler - value to write to CANTCON
+cb - function to call (from inside the CAN ISR) on each overflow
+*/
+void start_can_timer(uint8_t prescaler, can_timer_callback_t cb) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        can_timer_cb = cb;
+        CANTCON = prescaler;
+        // Writing 1 clears the flag, writing 0 to the other flags has no effect
+        CANGIT = _BV(OVRTIM);
+        CANGIE |= _BV(ENOVRT);
+    }
+}
+
+/*
+Stops calling the CAN timer callback. The CAN timer itself keeps running
+because it is also used for frame time stamps.
+*/
+void stop_can_timer(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        CANGIE &= ~_BV(ENOVRT);
+        can_timer_cb = NULL;
+    }
+}
+
 // Handles the circumstance where the CAN channel is not allowed to have
 // any influence on bus (i.e. entering bus off mode)
 // Reference pg. 237 for error management
@@ -417,12 +573,30 @@ ISR(CAN_INT_vect) {
     print("CANTEC: 0x%.2x\n", CANTEC);
 #endif
 
+    // CAN timer overflow interrupt
+    // Must be checked before the bus off interrupt, because clearing BOFFIT
+    // with |= also clears any other pending flags in CANGIT
+    if (CANGIT & _BV(OVRTIM)) {
+        CANGIT = _BV(OVRTIM);
+        if (can_timer_cb != NULL) {
+            can_timer_cb();
+        }
+    }
+
     // Bus off interrupt
     if (CANGIT & _BV(BOFFIT)){
         print(ERR_MSG, "BOFFIT");
         handle_bus_off_interrupt();
         boffit_count++;
         print("BOFFIT COUNT: %u\n",boffit_count);
+
+        // TX MObs will not report TXOK for the frames they were sending
+        for (uint8_t i = 0; i < 6; i++) {
+            mob_t* mob = mob_array[i];
+            if (mob != 0 && mob->mob_type == TX_MOB && mob->tx_err_cb != NULL) {
+                (mob->tx_err_cb)(mob->mob_num);
+            }
+        }
     }
 
 #ifdef CAN_DEBUG
@@ -436,7 +610,14 @@ ISR(CAN_INT_vect) {
         else {select_mob(i);}
         uint8_t status = mob_status(mob);
 
-        if (handle_err(mob)) {continue;}
+        if (handle_err(mob)) {
+            // Lets the sender know it can't wait for TXOK (without TTC mode,
+            // the MOb keeps retrying until it is reloaded)
+            if (mob->mob_type == TX_MOB && mob->tx_err_cb != NULL) {
+                (mob->tx_err_cb)(mob->mob_num);
+            }
+            continue;
+        }
 
         // RX interrupts
         if (status & _BV(RXOK)) {
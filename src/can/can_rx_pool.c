@@ -0,0 +1,101 @@
+/*
+Pool-backed CAN RX
+
+Frames received by RX MObs without an RX callback are normally copied into a
+queue and copied again by get_can_rx_frame(). With set_can_rx_pool(), the CAN
+interrupt reads each frame straight from the CAN controller into a block of a
+pool (see pool.c) and only passes the block's one-byte handle to the main loop.
+The handler can then work on the frame in place and pass the same handle on
+(e.g. in a queue of handles for a TX MOb, whose tx_data_cb copies the block into
+the CAN controller) without copying the payload again.
+
+Usage:
+    POOL_STORAGE(can_rx_storage, sizeof(can_rx_frame_t), 8);
+    pool_t can_rx_pool;
+
+    init_pool(&can_rx_pool, can_rx_storage, sizeof(can_rx_frame_t), 8);
+    set_can_rx_pool(&can_rx_pool);
+
+    uint8_t handle;
+    while (get_can_rx_handle(&handle)) {
+        can_rx_frame_t* frame = get_pool_block(&can_rx_pool, handle);
+        ...
+        free_pool_block(&can_rx_pool, handle);
+    }
+
+If no block is free or too many handles are waiting, the frame is dropped and
+counted in get_can_rx_dropped().
+
+This is in a separate file so programs that don't use it don't need to link the
+pool library.
+*/
+
+#include <can/can_rx_pool.h>
+#include <queue/spsc_ring.h>
+
+// Handles of received frames (the CAN ISR is the producer, get_can_rx_handle()
+// in the main loop is the consumer)
+DECLARE_SPSC_RING(can_rx_handle_ring, uint8_t, CAN_RX_RING_SIZE)
+
+static pool_t* can_rx_pool = NULL;
+
+
+static can_rx_frame_t* alloc_can_rx_block(uint8_t* handle) {
+    *handle = alloc_pool_block(can_rx_pool);
+    return get_pool_block(can_rx_pool, *handle);
+}
+
+static uint8_t commit_can_rx_block(uint8_t handle) {
+    if (!can_rx_handle_ring_push(&handle)) {
+        free_pool_block(can_rx_pool, handle);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+Makes the CAN interrupt receive frames into blocks of a pool (for RX MObs
+without an RX callback), see get_can_rx_handle(). Frames still waiting from a
+previous pool are dropped and their blocks are freed.
+pool - pool with blocks of at least sizeof(can_rx_frame_t) bytes, or NULL to go
+    back to get_can_rx_frame()
+Returns - 1 if successful, 0 if the blocks are too small
+*/
+uint8_t set_can_rx_pool(pool_t* pool) {
+    if (pool != NULL && pool->block_size < sizeof(can_rx_frame_t)) {
+        return 0;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t handle;
+        while (can_rx_handle_ring_pop(&handle)) {
+            free_pool_block(can_rx_pool, handle);
+        }
+        can_rx_pool = pool;
+        if (pool != NULL) {
+            set_can_rx_buf_fns(alloc_can_rx_block, commit_can_rx_block);
+        } else {
+            set_can_rx_buf_fns(NULL, NULL);
+        }
+    }
+    return 1;
+}
+
+/*
+Gets the handle of the oldest received frame. The frame is a can_rx_frame_t in
+the block of the pool given to set_can_rx_pool(), and the block must be freed
+(free_pool_block()) once it is no longer needed. This never disables
+interrupts. Only call it from one context (normally the main loop).
+handle - set to the handle of the block
+Returns - 1 if a frame was received, 0 otherwise
+*/
+uint8_t get_can_rx_handle(uint8_t* handle) {
+    return can_rx_handle_ring_pop(handle);
+}
+
+/*
+Returns - number of received frames waiting for get_can_rx_handle()
+*/
+uint8_t get_can_rx_handle_count(void) {
+    return can_rx_handle_ring_count();
+}
@@ -0,0 +1,117 @@
+/*
+Time-triggered CAN schedule
+
+Sends periodic messages (e.g. housekeeping) from a static table instead of
+ad hoc from the main loop. Each entry is a TX MOb with a period and offset
+(both in slots). On every slot, each entry that is due has its data produced
+and loaded into its MOb, so periodic traffic goes out at predictable times and
+messages with the same period can be spread across the bus with different
+offsets.
+
+By default the slots are driven by the CAN timer overflow (see
+start_can_timer()), which does not use up a general purpose timer. Instead of
+calling start_can_sched(), can_sched_tick() can also be called directly from a
+hardware timer callback.
+
+If an entry's MOb is still enabled when its next slot comes up, the previous
+message was never sent (e.g. it lost arbitration in TTC mode, or there was no
+ack). The stale message is aborted, the entry's missed_count is incremented,
+and the new message is loaded in its place. Messages are only counted as sent
+when their MOb reports TXOK, so each slot is counted either as sent or as
+missed, never both.
+*/
+
+#include <can/can_sched.h>
+
+// Schedule table (owned by the caller)
+can_sched_entry_t* can_sched_entries = NULL;
+uint8_t can_sched_count = 0;
+
+/*
+Sets up the schedule table. The MObs must already be initialized with
+init_tx_mob(). Each MOb's tx_done_cb is replaced with can_sched_tx_done(), which
+still calls the previous one.
+entries - array of schedule entries, with mob, period, offset and producer set
+count - number of entries
+*/
+void init_can_sched(can_sched_entry_t* entries, uint8_t count) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        can_sched_entries = entries;
+        can_sched_count = count;
+
+        for (uint8_t i = 0; i < count; i++) {
+            can_sched_entry_t* entry = &entries[i];
+            if (entry->period == 0) {
+                entry->period = 1;
+            }
+            if (entry->producer != NULL) {
+                entry->mob->tx_data_cb = entry->producer;
+            }
+            // Chain the MOb's own TXOK callback (unless it is already set up)
+            if (entry->mob->tx_done_cb != can_sched_tx_done) {
+                entry->tx_done_cb = entry->mob->tx_done_cb;
+                entry->mob->tx_done_cb = can_sched_tx_done;
+            }
+            entry->countdown = entry->offset;
+            entry->sent_count = 0;
+            entry->missed_count = 0;
+        }
+    }
+}
+
+// Starts driving the schedule from the CAN timer
+void start_can_sched(void) {
+    start_can_timer(CAN_SCHED_TPRSC, can_sched_tick);
+}
+
+void stop_can_sched(void) {
+    stop_can_timer();
+}
+
+/*
+Advances the schedule by one slot and loads every message that is due.
+Called from an ISR (CAN timer overflow or a hardware timer).
+*/
+void can_sched_tick(void) {
+    // The main loop may be in the middle of accessing another MOb
+    uint8_t canpage = CANPAGE;
+
+    for (uint8_t i = 0; i < can_sched_count; i++) {
+        can_sched_entry_t* entry = &can_sched_entries[i];
+
+        if (entry->countdown > 0) {
+            entry->countdown--;
+            continue;
+        }
+        entry->countdown = entry->period - 1;
+
+        if (!is_paused(entry->mob)) {
+            entry->missed_count++;
+            pause_mob(entry->mob);
+        }
+
+        resume_mob(entry->mob);
+    }
+
+    CANPAGE = canpage;
+}
+
+/*
+Counts a message as sent. This is set as the tx_done_cb of every MOb in the
+schedule by init_can_sched(), so it is called from the CAN ISR on TXOK.
+mob_num - MOb that finished sending
+*/
+void can_sched_tx_done(uint8_t mob_num) {
+    for (uint8_t i = 0; i < can_sched_count; i++) {
+        can_sched_entry_t* entry = &can_sched_entries[i];
+        if (entry->mob->mob_num != mob_num) {
+            continue;
+        }
+
+        entry->sent_count++;
+        if (entry->tx_done_cb != NULL) {
+            (entry->tx_done_cb)(mob_num);
+        }
+        break;
+    }
+}
@@ -0,0 +1,143 @@
+/*
+Control opcode dispatcher
+
+Each subsystem describes its control opcodes (CAN_EPS_CTRL_*, CAN_PAY_CTRL_*)
+with a table in program memory, indexed by opcode, of {opcode, minimum data
+length, handler}. dispatch_ctrl_req() looks up the opcode in constant time,
+validates the request, calls the handler and builds the response with the
+status byte, so subsystems don't need their own switch statements.
+
+For example:
+
+uint8_t ping(uint32_t arg, uint32_t* result) {
+    return CAN_STATUS_OK;
+}
+
+const ctrl_cmd_t eps_ctrl_cmds[CAN_EPS_CTRL_FIELD_COUNT] PROGMEM = {
+    CTRL_CMD(CAN_EPS_CTRL_PING, 0, ping),
+    ...
+};
+ctrl_stats_t eps_ctrl_stats[CAN_EPS_CTRL_FIELD_COUNT];
+const ctrl_table_t eps_ctrl_table = {
+    CAN_EPS_CTRL, CAN_EPS_CTRL_FIELD_COUNT, eps_ctrl_cmds, eps_ctrl_stats
+};
+
+The dispatcher also counts how many times each opcode is called and, if a time
+source is set with set_ctrl_time_fn(), the longest execution time of each
+handler, which can be read back with get_ctrl_stats(). For times in
+microseconds, start the clock and use micros_16bit():
+
+init_clock();
+set_ctrl_time_fn(micros_16bit);
+*/
+
+#include <can/ctrl_dispatch.h>
+
+// Time source for handler execution times (NULL to not measure them)
+static ctrl_time_fn_t ctrl_time_fn = NULL;
+
+/*
+Sets the function used to measure handler execution times.
+fn - returns the current time in any unit (e.g. a timer counter), or NULL to
+    stop measuring execution times
+*/
+void set_ctrl_time_fn(ctrl_time_fn_t fn) {
+    ctrl_time_fn = fn;
+}
+
+/*
+Handles one control request.
+table - table of the subsystem's control opcodes
+req - request message
+len - number of bytes in req
+resp - 8-byte array that will be populated with the response
+Returns - the status byte placed in the response (CAN_STATUS_*)
+*/
+uint8_t dispatch_ctrl_req(const ctrl_table_t* table, const uint8_t* req,
+        uint8_t len, uint8_t* resp) {
+    if (len <= CAN_MSG_FIELD_IDX) {
+        fill_can_msg(table->msg_type, 0, CAN_STATUS_INVALID_DATA, 0, resp);
+        return CAN_STATUS_INVALID_DATA;
+    }
+
+    uint8_t opcode = req[CAN_MSG_FIELD_IDX];
+    if (req[CAN_MSG_TYPE_IDX] != table->msg_type || opcode >= table->count) {
+        fill_can_msg(table->msg_type, opcode, CAN_STATUS_INVALID_OPCODE,
+            0, resp);
+        return CAN_STATUS_INVALID_OPCODE;
+    }
+
+    ctrl_cmd_t cmd;
+    memcpy_P(&cmd, &table->cmds[opcode], sizeof(cmd));
+    // The opcode is checked in case the table has gaps
+    if (cmd.handler == NULL || cmd.opcode != opcode) {
+        fill_can_msg(table->msg_type, opcode, CAN_STATUS_INVALID_OPCODE,
+            0, resp);
+        return CAN_STATUS_INVALID_OPCODE;
+    }
+    // Opcodes without data only need the type and field bytes
+    if (cmd.data_len > 0 && len < CAN_MSG_DATA_IDX + cmd.data_len) {
+        fill_can_msg(table->msg_type, opcode, CAN_STATUS_INVALID_DATA, 0, resp);
+        return CAN_STATUS_INVALID_DATA;
+    }
+
+    // Missing data bytes are treated as 0
+    uint32_t arg = 0;
+    for (uint8_t i = CAN_MSG_DATA_IDX; i < CAN_MSG_LEN; i++) {
+        arg = (arg << 8) | (i < len ? req[i] : 0);
+    }
+
+    uint32_t result = 0;
+    ctrl_time_fn_t time_fn = ctrl_time_fn;
+    uint16_t start = (time_fn != NULL) ? time_fn() : 0;
+    uint8_t status = cmd.handler(arg, &result);
+    uint16_t elapsed = (time_fn != NULL) ? (uint16_t) (time_fn() - start) : 0;
+
+    if (table->stats != NULL) {
+        ctrl_stats_t* stats = &table->stats[opcode];
+        if (stats->count < UINT16_MAX) {
+            stats->count++;
+        }
+        if (elapsed > stats->max_time) {
+            stats->max_time = elapsed;
+        }
+    }
+
+    fill_can_msg(table->msg_type, opcode, status, result, resp);
+    return status;
+}
+
+/*
+Gets the usage statistics of one opcode.
+table - table of control opcodes
+opcode - opcode
+stats - will be populated with the statistics
+Returns - 1 if successful, 0 if the opcode is invalid or the table has no
+    statistics
+*/
+uint8_t get_ctrl_stats(const ctrl_table_t* table, uint8_t opcode,
+        ctrl_stats_t* stats) {
+    if (table->stats == NULL || opcode >= table->count) {
+        return 0;
+    }
+    // Requests may be dispatched from the CAN interrupt
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = table->stats[opcode];
+    }
+    return 1;
+}
+
+/*
+Clears the usage statistics of all opcodes in a table.
+*/
+void reset_ctrl_stats(const ctrl_table_t* table) {
+    if (table->stats == NULL) {
+        return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t i = 0; i < table->count; i++) {
+            table->stats[i].count = 0;
+            table->stats[i].max_time = 0;
+        }
+    }
+}
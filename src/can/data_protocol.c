@@ -0,0 +1,21 @@
+#include <can/data_protocol.h>
+
+/*
+Populates all bytes of a message in the standard layout (see data_protocol.h).
+type - message type
+field - field number or opcode
+status - status byte (CAN_STATUS_*)
+data - data (bytes 4-7, big endian)
+msg - 8-byte array that will be populated with the message
+*/
+void fill_can_msg(uint8_t type, uint8_t field, uint8_t status, uint32_t data,
+        uint8_t* msg) {
+    msg[CAN_MSG_TYPE_IDX] = type;
+    msg[CAN_MSG_FIELD_IDX] = field;
+    msg[CAN_MSG_STATUS_IDX] = status;
+    msg[3] = 0x00;
+    msg[CAN_MSG_DATA_IDX + 0] = (data >> 24) & 0xFF;
+    msg[CAN_MSG_DATA_IDX + 1] = (data >> 16) & 0xFF;
+    msg[CAN_MSG_DATA_IDX + 2] = (data >> 8) & 0xFF;
+    msg[CAN_MSG_DATA_IDX + 3] = data & 0xFF;
+}
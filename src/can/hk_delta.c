@@ -0,0 +1,255 @@
+/*
+Delta-encoded housekeeping stream
+
+Most housekeeping values change slowly between collections, so instead of
+sending every raw value each time, the encoder keeps the last value sent for
+each field and only sends the differences. The decoder (on OBC, with a host
+twin in bin/hk_delta.py) keeps the same values to rebuild the full record.
+
+A record (one collection of all fields of a message type) is:
+- Header byte: HK_DELTA_KEYFRAME_FLAG (if a keyframe) | sequence number (7 bits)
+- Tokens, in field number order, until every field is covered
+
+Each field is compared to a reference value: 0 in a keyframe, or the last value
+sent in a delta record. A token is either:
+- A run: N consecutive fields equal to their reference (payload = N)
+- A value: one field (payload = raw value in a keyframe, or the zigzag-encoded
+  difference from the last value in a delta record)
+
+Tokens are variable length. The first byte has a continuation bit
+(HK_DELTA_TOKEN_CONT), a run bit (HK_DELTA_TOKEN_RUN) and the low 6 bits of the
+payload. Each following byte has a continuation bit and the next 7 bits. Small
+changes therefore take 1 byte, and any number of unchanged fields (up to 63)
+takes 1 byte.
+
+A keyframe is sent every keyframe_period records (or when forced) so the
+decoder can resynchronize after a lost record. The decoder detects lost records
+from a gap in the sequence numbers and ignores delta records until the next
+keyframe.
+*/
+
+#include <can/hk_delta.h>
+
+/*
+Initializes an encoder or decoder.
+state - state to initialize
+last - array of count values, used to store the last value of each field
+count - number of fields per record (e.g. CAN_EPS_HK_FIELD_COUNT)
+keyframe_period - number of records between keyframes (encoder only)
+*/
+void init_hk_delta(hk_delta_t* state, uint32_t* last, uint8_t count,
+        uint8_t keyframe_period) {
+    state->count = count;
+    state->keyframe_period = keyframe_period;
+    state->seq = 0;
+    state->synced = 0;
+    state->last = last;
+    for (uint8_t i = 0; i < count; i++) {
+        last[i] = 0;
+    }
+    force_hk_keyframe(state);
+}
+
+/*
+Makes the encoder send a keyframe as the next record (e.g. if the decoder asks
+to resynchronize).
+*/
+void force_hk_keyframe(hk_delta_t* state) {
+    state->since_keyframe = HK_DELTA_FORCE_KEYFRAME;
+    state->synced = 0;
+}
+
+static inline uint32_t zigzag_encode(uint32_t delta) {
+    return (delta << 1) ^ ((int32_t) delta >> 31);
+}
+
+static inline uint32_t zigzag_decode(uint32_t value) {
+    return (value >> 1) ^ -(value & 1);
+}
+
+/*
+Writes one token.
+Returns - number of bytes written, or 0 if it does not fit in the buffer
+*/
+static uint8_t put_token(uint8_t* buf, uint16_t space, uint8_t run,
+        uint32_t payload) {
+    uint8_t len = 0;
+    uint8_t byte = (payload & 0x3F) | (run ? HK_DELTA_TOKEN_RUN : 0);
+    payload >>= HK_DELTA_TOKEN_BITS;
+
+    while (1) {
+        if (len >= space) {
+            return 0;
+        }
+        if (payload != 0) {
+            byte |= HK_DELTA_TOKEN_CONT;
+        }
+        buf[len++] = byte;
+
+        if (payload == 0) {
+            return len;
+        }
+        byte = payload & 0x7F;
+        payload >>= 7;
+    }
+}
+
+/*
+Reads one token.
+Returns - number of bytes read, or 0 if the token is incomplete or too long
+*/
+static uint8_t get_token(const uint8_t* buf, uint16_t len, uint8_t* run,
+        uint32_t* payload) {
+    if (len == 0) {
+        return 0;
+    }
+
+    *run = (buf[0] & HK_DELTA_TOKEN_RUN) ? 1 : 0;
+    *payload = buf[0] & 0x3F;
+
+    uint8_t shift = HK_DELTA_TOKEN_BITS;
+    uint8_t i = 0;
+    while (buf[i] & HK_DELTA_TOKEN_CONT) {
+        i++;
+        if (i >= len || i >= HK_DELTA_MAX_TOKEN_LEN) {
+            return 0;
+        }
+        *payload |= (uint32_t) (buf[i] & 0x7F) << shift;
+        shift += 7;
+    }
+    return i + 1;
+}
+
+/*
+Encodes one record.
+enc - encoder state
+values - array of enc->count raw values, indexed by field number
+buf - buffer for the record (HK_DELTA_MAX_LEN(count) bytes is always enough)
+buf_size - size of buf
+Returns - number of bytes in the record, or 0 if it does not fit in buf (the
+    encoder state is unchanged in that case)
+*/
+uint16_t encode_hk_delta(hk_delta_t* enc, const uint32_t* values,
+        uint8_t* buf, uint16_t buf_size) {
+    if (buf_size < 1) {
+        return 0;
+    }
+
+    uint8_t keyframe = (enc->since_keyframe == HK_DELTA_FORCE_KEYFRAME) ||
+        (enc->keyframe_period > 0 && enc->since_keyframe >= enc->keyframe_period);
+    buf[0] = (enc->seq & HK_DELTA_SEQ_MASK) |
+        (keyframe ? HK_DELTA_KEYFRAME_FLAG : 0);
+    uint16_t len = 1;
+
+    uint8_t run = 0;
+    for (uint8_t i = 0; i <= enc->count; i++) {
+        uint8_t same = 0;
+        uint32_t payload = 0;
+        if (i < enc->count) {
+            uint32_t ref = keyframe ? 0 : enc->last[i];
+            same = (values[i] == ref);
+            payload = keyframe ? values[i] : zigzag_encode(values[i] - ref);
+        }
+
+        // Flush the current run at the end of the record or when a field
+        // changes (or the run length no longer fits in one byte)
+        if (run > 0 && (!same || i == enc->count || run == 0x3F)) {
+            uint8_t written = put_token(&buf[len], buf_size - len, 1, run);
+            if (written == 0) {
+                return 0;
+            }
+            len += written;
+            run = 0;
+        }
+
+        if (i == enc->count) {
+            break;
+        }
+        if (same) {
+            run++;
+        } else {
+            uint8_t written = put_token(&buf[len], buf_size - len, 0, payload);
+            if (written == 0) {
+                return 0;
+            }
+            len += written;
+        }
+    }
+
+    // Only update the state once the whole record has been written
+    for (uint8_t i = 0; i < enc->count; i++) {
+        enc->last[i] = values[i];
+    }
+    enc->seq = (enc->seq + 1) & HK_DELTA_SEQ_MASK;
+    if (keyframe) {
+        enc->since_keyframe = 1;
+    } else if (enc->since_keyframe < HK_DELTA_FORCE_KEYFRAME - 1) {
+        enc->since_keyframe++;
+    }
+
+    return len;
+}
+
+/*
+Decodes one record.
+dec - decoder state
+buf - record
+len - number of bytes in the record
+values - array of dec->count values that will be populated with the raw
+    values of all fields (only valid if HK_DELTA_OK is returned)
+Returns - HK_DELTA_OK, HK_DELTA_NEED_KEYFRAME or HK_DELTA_INVALID
+*/
+uint8_t decode_hk_delta(hk_delta_t* dec, const uint8_t* buf, uint16_t len,
+        uint32_t* values) {
+    if (len < 1) {
+        return HK_DELTA_INVALID;
+    }
+
+    uint8_t keyframe = (buf[0] & HK_DELTA_KEYFRAME_FLAG) ? 1 : 0;
+    uint8_t seq = buf[0] & HK_DELTA_SEQ_MASK;
+
+    // Can only apply a delta record on top of the previous record
+    if (!keyframe && (!dec->synced || seq != dec->seq)) {
+        dec->synced = 0;
+        return HK_DELTA_NEED_KEYFRAME;
+    }
+
+    uint16_t pos = 1;
+    uint8_t i = 0;
+    while (i < dec->count) {
+        uint8_t run = 0;
+        uint32_t payload = 0;
+        uint8_t read = get_token(&buf[pos], len - pos, &run, &payload);
+        if (read == 0) {
+            dec->synced = 0;
+            return HK_DELTA_INVALID;
+        }
+        pos += read;
+
+        if (run) {
+            if (payload == 0 || payload > (uint32_t) (dec->count - i)) {
+                dec->synced = 0;
+                return HK_DELTA_INVALID;
+            }
+            for (uint8_t j = 0; j < payload; j++, i++) {
+                values[i] = keyframe ? 0 : dec->last[i];
+            }
+        } else {
+            values[i] = keyframe ? payload :
+                dec->last[i] + zigzag_decode(payload);
+            i++;
+        }
+    }
+
+    if (pos != len) {
+        dec->synced = 0;
+        return HK_DELTA_INVALID;
+    }
+
+    for (uint8_t j = 0; j < dec->count; j++) {
+        dec->last[j] = values[j];
+    }
+    dec->seq = (seq + 1) & HK_DELTA_SEQ_MASK;
+    dec->synced = 1;
+    return HK_DELTA_OK;
+}
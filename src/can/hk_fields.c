@@ -0,0 +1,279 @@
+/*
+Housekeeping field registry
+
+Describes every housekeeping field in data_protocol.h (raw width, unit and
+conversion) in tables stored in program memory, so subsystems don't have to
+hand-write switch statements to encode and decode each field. Each table is
+indexed directly by field number and its size comes from the matching
+CAN_*_FIELD_COUNT constant, so looking up or validating a field is O(1).
+
+A subsystem answers a housekeeping request by passing dispatch_hk_req() an
+array of getter functions (one per field, indexed by field number).
+
+OBC/host code can decode any response with decode_hk_msg() and
+convert_hk_field() using the same tables.
+*/
+
+#include <can/hk_fields.h>
+
+// Wrappers to match the hk_conv_fn_t signature
+static double conv_therm_temp(uint32_t raw) {
+    return adc_raw_to_therm_temp((uint16_t) raw);
+}
+static double conv_heater_setpoint(uint32_t raw) {
+    return dac_raw_data_to_heater_setpoint((uint16_t) raw);
+}
+static double conv_gyro(uint32_t raw) {
+    return imu_raw_data_to_gyro((uint16_t) raw);
+}
+static double conv_humidity(uint32_t raw) {
+    return hum_raw_data_to_humidity((uint16_t) raw);
+}
+static double conv_pressure(uint32_t raw) {
+    return pres_raw_data_to_pressure(raw);
+}
+
+// Designated initializer for the descriptor of one field
+#define HK_FIELD(num, width, unit, conv) [num] = { num, width, unit, conv }
+
+// Fields common to all subsystems
+#define HK_COMMON_FIELDS(prefix) \
+    HK_FIELD(prefix##_UPTIME,           32, HK_UNIT_S,    NULL), \
+    HK_FIELD(prefix##_RESTART_COUNT,    32, HK_UNIT_NONE, NULL), \
+    HK_FIELD(prefix##_RESTART_REASON,   8,  HK_UNIT_NONE, NULL)
+
+
+const hk_field_desc_t obc_hk_fields[CAN_OBC_HK_FIELD_COUNT] PROGMEM = {
+    HK_COMMON_FIELDS(CAN_OBC_HK),
+    // Packed date/time (3 bytes, one per component)
+    HK_FIELD(CAN_OBC_HK_RESTART_DATE,   24, HK_UNIT_NONE, NULL),
+    HK_FIELD(CAN_OBC_HK_RESTART_TIME,   24, HK_UNIT_NONE, NULL),
+};
+
+const hk_field_desc_t eps_hk_fields[CAN_EPS_HK_FIELD_COUNT] PROGMEM = {
+    HK_COMMON_FIELDS(CAN_EPS_HK),
+    // Voltages and currents depend on each board's resistors
+    HK_FIELD(CAN_EPS_HK_BAT_VOL,        12, HK_UNIT_V,    NULL),
+    HK_FIELD(CAN_EPS_HK_BAT_CUR,        12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_X_POS_CUR,      12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_X_NEG_CUR,      12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_Y_POS_CUR,      12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_Y_NEG_CUR,      12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_3V3_VOL,        12, HK_UNIT_V,    NULL),
+    HK_FIELD(CAN_EPS_HK_3V3_CUR,        12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_5V_VOL,         12, HK_UNIT_V,    NULL),
+    HK_FIELD(CAN_EPS_HK_5V_CUR,         12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_PAY_CUR,        12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_EPS_HK_3V3_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_EPS_HK_5V_TEMP,        12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_EPS_HK_PAY_CON_TEMP,   12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_EPS_HK_BAT_TEMP1,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_EPS_HK_BAT_TEMP2,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_EPS_HK_HEAT1_SP,       12, HK_UNIT_C,    conv_heater_setpoint),
+    HK_FIELD(CAN_EPS_HK_HEAT2_SP,       12, HK_UNIT_C,    conv_heater_setpoint),
+    HK_FIELD(CAN_EPS_HK_GYR_UNCAL_X,    16, HK_UNIT_DPS,  conv_gyro),
+    HK_FIELD(CAN_EPS_HK_GYR_UNCAL_Y,    16, HK_UNIT_DPS,  conv_gyro),
+    HK_FIELD(CAN_EPS_HK_GYR_UNCAL_Z,    16, HK_UNIT_DPS,  conv_gyro),
+    HK_FIELD(CAN_EPS_HK_GYR_CAL_X,      16, HK_UNIT_DPS,  conv_gyro),
+    HK_FIELD(CAN_EPS_HK_GYR_CAL_Y,      16, HK_UNIT_DPS,  conv_gyro),
+    HK_FIELD(CAN_EPS_HK_GYR_CAL_Z,      16, HK_UNIT_DPS,  conv_gyro),
+};
+
+const hk_field_desc_t pay_hk_fields[CAN_PAY_HK_FIELD_COUNT] PROGMEM = {
+    HK_COMMON_FIELDS(CAN_PAY_HK),
+    HK_FIELD(CAN_PAY_HK_HUM,            14, HK_UNIT_PCT_RH, conv_humidity),
+    HK_FIELD(CAN_PAY_HK_PRES,           24, HK_UNIT_KPA,  conv_pressure),
+    HK_FIELD(CAN_PAY_HK_AMB_TEMP,       16, HK_UNIT_C,    NULL),
+    HK_FIELD(CAN_PAY_HK_6V_TEMP,        12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_10V_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MOT1_TEMP,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MOT2_TEMP,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF1_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF2_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF3_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF4_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF5_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF6_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF7_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF8_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF9_TEMP,       12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF10_TEMP,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF11_TEMP,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_MF12_TEMP,      12, HK_UNIT_C,    conv_therm_temp),
+    HK_FIELD(CAN_PAY_HK_HEAT_SP,        12, HK_UNIT_C,    conv_heater_setpoint),
+    HK_FIELD(CAN_PAY_HK_DEF_INV_THERM_TEMP, 12, HK_UNIT_C, conv_therm_temp),
+    // One bit per thermistor/heater
+    HK_FIELD(CAN_PAY_HK_THERM_EN,       12, HK_UNIT_BITS, NULL),
+    HK_FIELD(CAN_PAY_HK_HEAT_EN,        8,  HK_UNIT_BITS, NULL),
+    HK_FIELD(CAN_PAY_HK_BAT_VOL,        12, HK_UNIT_V,    NULL),
+    HK_FIELD(CAN_PAY_HK_6V_VOL,         12, HK_UNIT_V,    NULL),
+    HK_FIELD(CAN_PAY_HK_6V_CUR,         12, HK_UNIT_A,    NULL),
+    HK_FIELD(CAN_PAY_HK_10V_VOL,        12, HK_UNIT_V,    NULL),
+    HK_FIELD(CAN_PAY_HK_10V_CUR,        12, HK_UNIT_A,    NULL),
+};
+
+// Every optical field (optical density and fluorescence) is a 24-bit reading
+const hk_field_desc_t pay_opt_fields[1] PROGMEM = {
+    { 0, 24, HK_UNIT_NONE, NULL },
+};
+
+// Make sure every table has an entry for every field number
+_Static_assert(sizeof(obc_hk_fields) / sizeof(obc_hk_fields[0]) == CAN_OBC_HK_FIELD_COUNT,
+    "OBC HK table size");
+_Static_assert(sizeof(eps_hk_fields) / sizeof(eps_hk_fields[0]) == CAN_EPS_HK_FIELD_COUNT,
+    "EPS HK table size");
+_Static_assert(sizeof(pay_hk_fields) / sizeof(pay_hk_fields[0]) == CAN_PAY_HK_FIELD_COUNT,
+    "PAY HK table size");
+
+const hk_table_t obc_hk_table = {
+    .msg_type = HK_NO_MSG_TYPE,
+    .count = CAN_OBC_HK_FIELD_COUNT,
+    .uniform = 0,
+    .fields = obc_hk_fields,
+};
+const hk_table_t eps_hk_table = {
+    .msg_type = CAN_EPS_HK,
+    .count = CAN_EPS_HK_FIELD_COUNT,
+    .uniform = 0,
+    .fields = eps_hk_fields,
+};
+const hk_table_t pay_hk_table = {
+    .msg_type = CAN_PAY_HK,
+    .count = CAN_PAY_HK_FIELD_COUNT,
+    .uniform = 0,
+    .fields = pay_hk_fields,
+};
+const hk_table_t pay_opt_table = {
+    .msg_type = CAN_PAY_OPT,
+    .count = CAN_PAY_OPT_TOT_FIELD_COUNT,
+    .uniform = 1,
+    .fields = pay_opt_fields,
+};
+
+
+/*
+Gets the field table for a message type.
+msg_type - one of the CAN_*_HK or CAN_PAY_OPT message types
+Returns - pointer to the table, or NULL if the message type has no fields table
+*/
+const hk_table_t* get_hk_table(uint8_t msg_type) {
+    switch (msg_type) {
+        case CAN_EPS_HK:
+            return &eps_hk_table;
+        case CAN_PAY_HK:
+            return &pay_hk_table;
+        case CAN_PAY_OPT:
+            return &pay_opt_table;
+        default:
+            return NULL;
+    }
+}
+
+/*
+Copies the descriptor of a field out of program memory.
+table - table of the message type
+field_num - field number
+desc - will be populated with the descriptor
+Returns - 1 if the field number is valid, 0 otherwise
+*/
+uint8_t get_hk_field(const hk_table_t* table, uint8_t field_num,
+        hk_field_desc_t* desc) {
+    if (field_num >= table->count) {
+        return 0;
+    }
+
+    uint8_t index = table->uniform ? 0 : field_num;
+    memcpy_P(desc, &table->fields[index], sizeof(hk_field_desc_t));
+    desc->field_num = field_num;
+    return 1;
+}
+
+/*
+Converts a raw field value to its unit (see the field's hk_unit_t).
+Returns - the converted value, or the raw value if there is no conversion
+*/
+double convert_hk_field(const hk_table_t* table, uint8_t field_num,
+        uint32_t raw) {
+    hk_field_desc_t desc;
+    if (!get_hk_field(table, field_num, &desc) || desc.conv == NULL) {
+        return (double) raw;
+    }
+    return desc.conv(raw);
+}
+
+/*
+Builds a housekeeping response message for one field.
+table - table of the message type
+field_num - field number
+raw - raw value (truncated to the field's width)
+msg - 8-byte array that will be populated with the message
+Returns - the status byte placed in the message (CAN_STATUS_*)
+*/
+uint8_t encode_hk_msg(const hk_table_t* table, uint8_t field_num,
+        uint32_t raw, uint8_t* msg) {
+    hk_field_desc_t desc;
+    if (!get_hk_field(table, field_num, &desc)) {
+        fill_can_msg(table->msg_type, field_num, CAN_STATUS_INVALID_FIELD_NUM,
+            0, msg);
+        return CAN_STATUS_INVALID_FIELD_NUM;
+    }
+
+    if (desc.width < 32) {
+        raw &= (1UL << desc.width) - 1;
+    }
+    fill_can_msg(table->msg_type, field_num, CAN_STATUS_OK, raw, msg);
+    return CAN_STATUS_OK;
+}
+
+/*
+Parses a housekeeping response message.
+table - table of the expected message type
+msg - 8-byte received message
+field_num - will be set to the field number
+raw - will be set to the raw value
+Returns - CAN_STATUS_OK if the message is valid for this table, otherwise the
+    error status (either from the message or from validation)
+*/
+uint8_t decode_hk_msg(const hk_table_t* table, const uint8_t* msg,
+        uint8_t* field_num, uint32_t* raw) {
+    *field_num = msg[CAN_MSG_FIELD_IDX];
+    *raw =
+        ((uint32_t) msg[CAN_MSG_DATA_IDX + 0] << 24) |
+        ((uint32_t) msg[CAN_MSG_DATA_IDX + 1] << 16) |
+        ((uint32_t) msg[CAN_MSG_DATA_IDX + 2] << 8) |
+        ((uint32_t) msg[CAN_MSG_DATA_IDX + 3]);
+
+    if (msg[CAN_MSG_TYPE_IDX] != table->msg_type) {
+        return CAN_STATUS_INVALID_OPCODE;
+    }
+    if (*field_num >= table->count) {
+        return CAN_STATUS_INVALID_FIELD_NUM;
+    }
+    return msg[CAN_MSG_STATUS_IDX];
+}
+
+/*
+Answers a housekeeping request by calling the getter for the requested field.
+table - table of the message type
+getters - array (in program memory) of CAN_*_FIELD_COUNT getter functions,
+    indexed by field number; an entry can be NULL if the field is not supported
+req - 8-byte received request
+resp - 8-byte array that will be populated with the response
+Returns - the status byte placed in the response
+*/
+uint8_t dispatch_hk_req(const hk_table_t* table, const hk_get_fn_t* getters,
+        const uint8_t* req, uint8_t* resp) {
+    uint8_t field_num = req[CAN_MSG_FIELD_IDX];
+    if (field_num >= table->count) {
+        return encode_hk_msg(table, field_num, 0, resp);
+    }
+
+    hk_get_fn_t getter = (hk_get_fn_t) pgm_read_ptr(&getters[field_num]);
+    if (getter == NULL) {
+        fill_can_msg(table->msg_type, field_num, CAN_STATUS_INVALID_FIELD_NUM,
+            0, resp);
+        return CAN_STATUS_INVALID_FIELD_NUM;
+    }
+
+    return encode_hk_msg(table, field_num, getter(), resp);
+}
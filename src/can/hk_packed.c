@@ -0,0 +1,198 @@
+/*
+Packed (bulk) housekeeping frames
+
+Instead of one request and one response per field, OBC can ask for a range of
+fields (first to last) with a single bulk request. The subsystem answers with
+packed frames that each carry as many consecutive fields as fit in 48 bits,
+using each field's raw width from the field registry (e.g. four 12-bit ADC
+readings or three 16-bit gyroscope readings per frame).
+
+Both sides derive the field order and widths from the same tables, so only the
+first field number needs to be sent in each frame. The requester passes the
+last field it asked for to unpack_hk_frame() so it knows where the final frame
+ends.
+
+Subsystem:
+    if (decode_hk_bulk_req(table, req, &first, &last) == CAN_STATUS_OK) {
+        while (first <= last) {
+            first += pack_hk_frame(table, getters, first, last, frame);
+            (send frame)
+        }
+    }
+*/
+
+#include <can/hk_packed.h>
+
+/*
+Writes the `width` least significant bits of value into buf, starting at bit
+position pos (MSB first).
+*/
+static void put_bits(uint8_t* buf, uint8_t pos, uint8_t width, uint32_t value) {
+    while (width > 0) {
+        uint8_t space = 8 - (pos & 0x07);
+        uint8_t count = (width < space) ? width : space;
+        uint8_t chunk = (value >> (width - count)) & ((1 << count) - 1);
+
+        buf[pos >> 3] |= chunk << (space - count);
+        pos += count;
+        width -= count;
+    }
+}
+
+/*
+Reads `width` bits from buf, starting at bit position pos (MSB first).
+*/
+static uint32_t get_bits(const uint8_t* buf, uint8_t pos, uint8_t width) {
+    uint32_t value = 0;
+    while (width > 0) {
+        uint8_t space = 8 - (pos & 0x07);
+        uint8_t count = (width < space) ? width : space;
+        uint8_t chunk = (buf[pos >> 3] >> (space - count)) & ((1 << count) - 1);
+
+        value = (value << count) | chunk;
+        pos += count;
+        width -= count;
+    }
+    return value;
+}
+
+/*
+Builds a bulk request for fields first to last (inclusive).
+req - 8-byte array that will be populated with the request
+*/
+void encode_hk_bulk_req(const hk_table_t* table, uint8_t first, uint8_t last,
+        uint8_t* req) {
+    for (uint8_t i = 0; i < CAN_MSG_LEN; i++) {
+        req[i] = 0x00;
+    }
+    req[CAN_MSG_TYPE_IDX] = table->msg_type;
+    req[CAN_MSG_FIELD_IDX] = CAN_HK_BULK_REQ;
+    req[CAN_HK_BULK_FIRST_IDX] = first;
+    req[CAN_HK_BULK_LAST_IDX] = last;
+}
+
+/*
+Parses a bulk request.
+first, last - will be set to the range of fields requested
+Returns - CAN_STATUS_OK if req is a valid bulk request for this table,
+    CAN_STATUS_INVALID_OPCODE if it is not a bulk request,
+    CAN_STATUS_INVALID_FIELD_NUM if the range is invalid
+*/
+uint8_t decode_hk_bulk_req(const hk_table_t* table, const uint8_t* req,
+        uint8_t* first, uint8_t* last) {
+    if (req[CAN_MSG_TYPE_IDX] != table->msg_type ||
+            req[CAN_MSG_FIELD_IDX] != CAN_HK_BULK_REQ) {
+        return CAN_STATUS_INVALID_OPCODE;
+    }
+
+    *first = req[CAN_HK_BULK_FIRST_IDX];
+    *last = req[CAN_HK_BULK_LAST_IDX];
+    if (*first > *last || *last >= table->count) {
+        return CAN_STATUS_INVALID_FIELD_NUM;
+    }
+    return CAN_STATUS_OK;
+}
+
+/*
+Returns - 1 if the frame is a packed housekeeping frame, 0 otherwise
+*/
+uint8_t is_hk_packed_frame(const uint8_t* frame) {
+    return (frame[CAN_MSG_FIELD_IDX] & CAN_HK_PACKED_FLAG) &&
+        (frame[CAN_MSG_FIELD_IDX] != CAN_HK_BULK_REQ);
+}
+
+/*
+Builds one packed frame, starting at field `first` and containing as many
+consecutive fields (up to `last`) as fit.
+getters - array (in program memory) of getter functions, indexed by field
+    number; fields without a getter are sent as 0
+frame - 8-byte array that will be populated with the frame
+Returns - number of fields packed (0 if the range is invalid)
+*/
+uint8_t pack_hk_frame(const hk_table_t* table, const hk_get_fn_t* getters,
+        uint8_t first, uint8_t last, uint8_t* frame) {
+    if (first > last || last >= table->count) {
+        return 0;
+    }
+
+    frame[CAN_MSG_TYPE_IDX] = table->msg_type;
+    frame[CAN_MSG_FIELD_IDX] = CAN_HK_PACKED_FLAG | first;
+    for (uint8_t i = CAN_HK_PACKED_DATA_IDX; i < CAN_MSG_LEN; i++) {
+        frame[i] = 0x00;
+    }
+
+    uint8_t pos = 0;
+    uint8_t field_num = first;
+    hk_field_desc_t desc;
+    for (; field_num <= last; field_num++) {
+        get_hk_field(table, field_num, &desc);
+        if (pos + desc.width > CAN_HK_PACKED_DATA_BITS) {
+            break;
+        }
+
+        hk_get_fn_t getter = (hk_get_fn_t) pgm_read_ptr(&getters[field_num]);
+        uint32_t raw = (getter != NULL) ? getter() : 0;
+        put_bits(&frame[CAN_HK_PACKED_DATA_IDX], pos, desc.width, raw);
+        pos += desc.width;
+    }
+
+    return field_num - first;
+}
+
+/*
+Extracts the fields from a packed frame.
+last - last field of the bulk request this frame answers
+values - array of table->count raw values, indexed by field number; the fields
+    contained in the frame will be set
+Returns - number of fields unpacked (0 if the frame is not a valid packed frame)
+*/
+uint8_t unpack_hk_frame(const hk_table_t* table, const uint8_t* frame,
+        uint8_t last, uint32_t* values) {
+    if (frame[CAN_MSG_TYPE_IDX] != table->msg_type ||
+            !is_hk_packed_frame(frame)) {
+        return 0;
+    }
+
+    uint8_t first = frame[CAN_MSG_FIELD_IDX] & ~CAN_HK_PACKED_FLAG;
+    if (first > last || last >= table->count) {
+        return 0;
+    }
+
+    uint8_t pos = 0;
+    uint8_t field_num = first;
+    hk_field_desc_t desc;
+    for (; field_num <= last; field_num++) {
+        get_hk_field(table, field_num, &desc);
+        if (pos + desc.width > CAN_HK_PACKED_DATA_BITS) {
+            break;
+        }
+
+        values[field_num] = get_bits(&frame[CAN_HK_PACKED_DATA_IDX], pos,
+            desc.width);
+        pos += desc.width;
+    }
+
+    return field_num - first;
+}
+
+/*
+Returns - number of packed frames needed to send fields first to last
+*/
+uint8_t count_hk_frames(const hk_table_t* table, uint8_t first, uint8_t last) {
+    if (first > last || last >= table->count) {
+        return 0;
+    }
+
+    uint8_t frames = 1;
+    uint8_t pos = 0;
+    hk_field_desc_t desc;
+    for (uint8_t field_num = first; field_num <= last; field_num++) {
+        get_hk_field(table, field_num, &desc);
+        if (pos + desc.width > CAN_HK_PACKED_DATA_BITS) {
+            frames++;
+            pos = 0;
+        }
+        pos += desc.width;
+    }
+    return frames;
+}
@@ -0,0 +1,197 @@
+/*
+Bulk memory read
+
+Reading memory one byte (READ_RAM_BYTE) or one dword (READ_EEPROM) per CAN
+request is very slow for debugging dumps. Instead, the requester sends one
+CAN_*_CTRL_READ_MEM_BLOCK request with the memory space (SRAM, EEPROM or flash),
+start address and length, and the subsystem streams the contents back in
+consecutive CAN_*_CTRL_READ_MEM_DATA frames (5 bytes per frame), followed by a
+CRC frame. See data_protocol.h for the message layouts.
+
+The transfer is windowed: the subsystem only sends up to `window` frames past
+the last acknowledgement, so the requester can pace the transfer. If a frame is
+missing (the sequence number skips), the requester acknowledges the frames it
+received in order with the CAN_MEM_ACK_RESEND flag and the subsystem goes back
+to the first missing frame.
+
+Usage on the subsystem:
+- Call start_mem_read() when a READ_MEM_BLOCK request is received and send back
+  the response
+- Call ack_mem_read() when a READ_MEM_DATA acknowledgement is received
+- Whenever the TX MOb is free, call next_mem_read_frame() and send the frame if
+  it returns 1
+*/
+
+#include <can/mem_read.h>
+
+/*
+Initializes the state of a bulk read.
+msg_type - message type of the subsystem's control messages (e.g. CAN_EPS_CTRL)
+opcode - opcode of data frames (e.g. CAN_EPS_CTRL_READ_MEM_DATA)
+*/
+void init_mem_read(mem_read_t* read, uint8_t msg_type, uint8_t opcode) {
+    read->msg_type = msg_type;
+    read->opcode = opcode;
+    read->active = 0;
+}
+
+// Returns the first valid address of a memory space
+// (SRAM starts after the register file and I/O registers, which can have side
+// effects when read, e.g. CANMSG advances the CAN message pointer)
+static uint16_t mem_start(uint8_t space) {
+    switch (space) {
+        case CAN_MEM_SRAM:
+            return RAMSTART;
+        default:
+            return 0;
+    }
+}
+
+// Returns the last valid address of a memory space, or 0 if it is invalid
+static uint16_t mem_end(uint8_t space) {
+    switch (space) {
+        case CAN_MEM_SRAM:
+            return RAMEND;
+        case CAN_MEM_EEPROM:
+            return E2END;
+        case CAN_MEM_FLASH:
+            return FLASHEND;
+        default:
+            return 0;
+    }
+}
+
+static uint8_t mem_read_byte(uint8_t space, uint16_t addr) {
+    switch (space) {
+        case CAN_MEM_SRAM:
+            return *((const volatile uint8_t*) addr);
+        case CAN_MEM_EEPROM:
+            return eeprom_read_byte((const uint8_t*) addr);
+        case CAN_MEM_FLASH:
+            return pgm_read_byte(addr);
+        default:
+            return 0;
+    }
+}
+
+/*
+Starts (or cancels) a bulk read. Any read in progress is replaced.
+read - state of the bulk read
+req - READ_MEM_BLOCK request message (8 bytes)
+resp - 8-byte array that will be populated with the response
+Returns - the status byte placed in the response (CAN_STATUS_*)
+*/
+uint8_t start_mem_read(mem_read_t* read, const uint8_t* req, uint8_t* resp) {
+    uint8_t opcode = req[CAN_MSG_FIELD_IDX];
+    uint8_t space = req[CAN_MEM_SPACE_IDX];
+    uint8_t window = req[CAN_MEM_WINDOW_IDX];
+    uint16_t addr = ((uint16_t) req[CAN_MSG_DATA_IDX + 0] << 8) |
+        req[CAN_MSG_DATA_IDX + 1];
+    uint16_t len = ((uint16_t) req[CAN_MSG_DATA_IDX + 2] << 8) |
+        req[CAN_MSG_DATA_IDX + 3];
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        read->active = 0;
+    }
+
+    if (len == 0) {
+        fill_can_msg(read->msg_type, opcode, CAN_STATUS_OK, 0, resp);
+        return CAN_STATUS_OK;
+    }
+
+    uint16_t end = mem_end(space);
+    if (end == 0 || addr < mem_start(space) ||
+            (uint32_t) addr + len - 1 > end) {
+        fill_can_msg(read->msg_type, opcode, CAN_STATUS_INVALID_DATA, 0, resp);
+        return CAN_STATUS_INVALID_DATA;
+    }
+
+    uint16_t data_frames = MEM_READ_DATA_FRAMES(len);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        read->space = space;
+        read->window = (window == 0) ? MEM_READ_DEF_WINDOW : window;
+        read->addr = addr;
+        read->len = len;
+        read->frames = data_frames + 1;
+        read->next = 0;
+        read->acked = 0;
+        read->crc = 0xFFFF;
+        read->crc_len = 0;
+        read->active = 1;
+    }
+
+    fill_can_msg(read->msg_type, opcode, CAN_STATUS_OK, data_frames, resp);
+    return CAN_STATUS_OK;
+}
+
+/*
+Processes an acknowledgement from the requester.
+read - state of the bulk read
+req - READ_MEM_DATA acknowledgement message (8 bytes)
+*/
+void ack_mem_read(mem_read_t* read, const uint8_t* req) {
+    uint16_t count = ((uint16_t) req[CAN_MSG_DATA_IDX + 0] << 8) |
+        req[CAN_MSG_DATA_IDX + 1];
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        // Can't acknowledge frames that were not sent yet
+        if (!read->active || count > read->next) {
+            return;
+        }
+
+        read->acked = count;
+        if (req[CAN_MEM_ACK_FLAGS_IDX] & CAN_MEM_ACK_RESEND) {
+            read->next = count;
+        }
+        if (read->acked >= read->frames) {
+            read->active = 0;
+        }
+    }
+}
+
+/*
+Gets the next frame to send, if the window allows it.
+read - state of the bulk read
+frame - 8-byte array that will be populated with the frame
+Returns - 1 if a frame was produced, 0 if there is nothing to send now
+*/
+uint8_t next_mem_read_frame(mem_read_t* read, uint8_t* frame) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!read->active || read->next >= read->frames ||
+                read->next - read->acked >= read->window) {
+            return 0;
+        }
+
+        frame[CAN_MSG_TYPE_IDX] = read->msg_type;
+        frame[CAN_MSG_FIELD_IDX] = read->opcode;
+        frame[CAN_MEM_SEQ_IDX] = read->next & 0xFF;
+
+        uint8_t* data = &frame[CAN_MEM_FRAME_DATA_IDX];
+        if (read->next < read->frames - 1) {
+            uint16_t offset = read->next * CAN_MEM_FRAME_DATA_LEN;
+            for (uint8_t i = 0; i < CAN_MEM_FRAME_DATA_LEN; i++) {
+                if (offset + i >= read->len) {
+                    data[i] = 0;
+                    continue;
+                }
+
+                data[i] = mem_read_byte(read->space, read->addr + offset + i);
+                // Resent frames are already included in the CRC
+                if (offset + i == read->crc_len) {
+                    read->crc = _crc_ccitt_update(read->crc, data[i]);
+                    read->crc_len++;
+                }
+            }
+        } else {
+            data[0] = (read->crc >> 8) & 0xFF;
+            data[1] = read->crc & 0xFF;
+            for (uint8_t i = 2; i < CAN_MEM_FRAME_DATA_LEN; i++) {
+                data[i] = 0;
+            }
+        }
+
+        read->next++;
+    }
+    return 1;
+}
@@ -0,0 +1,289 @@
+/*
+Heartbeat reset log and escalation policy
+
+Every time a ping fails, the heartbeat wants to reset the peer. Resetting a peer
+that is stuck in a boot loop every time just wastes time, so each reset first
+goes through an escalation policy (hb_reset_policy) for that peer:
+- After each reset, the next reset is only allowed after a backoff time, which
+  starts at backoff_s and doubles after each reset up to max_backoff_s (it goes
+  back to 0 once the peer answers a ping)
+- At most max_resets resets are allowed in each window of window_s seconds
+
+Resets that are not allowed are only reported (logged with HB_RESET_SUPPRESSED).
+
+Every reset (performed or not) is recorded in a ring log in EEPROM, starting at
+HB_RESET_LOG_EEPROM_ADDR, with the uptime, peer, reason and the peer's last
+restart count, so the history can be read back (e.g. for downlink) with
+read_hb_reset_log().
+
+log_hb_reset() writes an entry right away (up to about 15 bytes, a few ms per
+byte). run_hb() uses queue_hb_reset_log() instead, and flush_hb_reset_log()
+then writes one byte per call, only when the EEPROM is ready, so the heartbeat
+never waits for the EEPROM. Don't call log_hb_reset() while queued entries are
+being written.
+
+EEPROM layout:
+- Magic word (2 bytes)
+- Index of the next entry to write (1 byte)
+- Number of valid entries (1 byte)
+- HB_RESET_LOG_SIZE entries
+*/
+
+#include <heartbeat/hb_reset_log.h>
+
+#define HB_RESET_LOG_HEAD_ADDR      (HB_RESET_LOG_EEPROM_ADDR + 2)
+#define HB_RESET_LOG_COUNT_ADDR     (HB_RESET_LOG_EEPROM_ADDR + 3)
+#define HB_RESET_LOG_ENTRIES_ADDR   (HB_RESET_LOG_EEPROM_ADDR + 4)
+
+_Static_assert(4 + HB_RESET_LOG_SIZE * sizeof(hb_reset_log_entry_t) <=
+    HB_RESET_LOG_EEPROM_SIZE, "Heartbeat reset log is too large");
+_Static_assert(HB_STATS_EEPROM_ADDR + HB_STATS_EEPROM_SIZE <=
+    HB_RESET_LOG_EEPROM_ADDR, "Heartbeat reset log overlaps the statistics");
+_Static_assert(HB_RESET_LOG_EEPROM_ADDR + HB_RESET_LOG_EEPROM_SIZE <= E2END + 1,
+    "Heartbeat reset log does not fit in EEPROM");
+
+// Entries waiting for flush_hb_reset_log()
+static hb_reset_log_entry_t hb_log_pending[HB_RESET_LOG_PENDING_SIZE];
+static uint8_t hb_log_pending_head = 0;
+static uint8_t hb_log_pending_count = 0;
+volatile uint16_t hb_reset_log_dropped = 0;
+
+// Progress of the entry flush_hb_reset_log() is writing
+// (the entry, then the new head and count, then the magic word if the log was
+// not valid yet, so a restart in between never leaves a bad entry in the log)
+#define HB_RESET_LOG_WRITE_STEPS (2 + sizeof(hb_reset_log_entry_t) + 2)
+static uint8_t hb_log_step = 0;
+static uint8_t hb_log_new_head = 0;
+static uint8_t hb_log_new_count = 0;
+
+hb_reset_policy_t hb_reset_policy = {
+    .backoff_s = HB_RESET_DEF_BACKOFF_S,
+    .max_backoff_s = HB_RESET_DEF_MAX_BACKOFF_S,
+    .max_resets = HB_RESET_DEF_MAX_RESETS,
+    .window_s = HB_RESET_DEF_WINDOW_S,
+};
+
+/*
+Checks the escalation policy before resetting a peer, and updates the peer's
+escalation state if the reset is allowed.
+state - escalation state of the peer
+now - current uptime (s)
+Returns - true if the peer should be reset, false if it should only be reported
+*/
+bool hb_reset_allowed(hb_reset_state_t* state, uint32_t now) {
+    if (state->window_resets == 0 ||
+            now >= state->window_start_s + hb_reset_policy.window_s) {
+        state->window_start_s = now;
+        state->window_resets = 0;
+    }
+
+    if (state->window_resets >= hb_reset_policy.max_resets) {
+        return false;
+    }
+    if (state->reset_sent && now < state->last_reset_s + state->backoff_s) {
+        return false;
+    }
+
+    state->window_resets++;
+    state->reset_sent = true;
+    state->last_reset_s = now;
+
+    if (state->backoff_s == 0) {
+        state->backoff_s = hb_reset_policy.backoff_s;
+    } else if (state->backoff_s < hb_reset_policy.max_backoff_s / 2) {
+        state->backoff_s *= 2;
+    } else {
+        state->backoff_s = hb_reset_policy.max_backoff_s;
+    }
+
+    return true;
+}
+
+/*
+Clears the backoff of a peer (e.g. once it answers a ping again). The number of
+resets in the current window is kept.
+*/
+void clear_hb_reset_backoff(hb_reset_state_t* state) {
+    state->reset_sent = false;
+    state->backoff_s = 0;
+}
+
+// Makes sure the log header is valid (the EEPROM is 0xFF when erased)
+static void init_hb_reset_log(void) {
+    if (eeprom_read_word((const uint16_t*) HB_RESET_LOG_EEPROM_ADDR) !=
+            HB_RESET_LOG_EEPROM_MAGIC) {
+        clear_hb_reset_log();
+    }
+}
+
+/*
+Adds an entry to the reset log, overwriting the oldest entry if the log is full.
+Note this writes up to about 15 bytes of EEPROM (a few ms per byte).
+*/
+void log_hb_reset(const hb_reset_log_entry_t* entry) {
+    init_hb_reset_log();
+
+    uint8_t head = eeprom_read_byte((const uint8_t*) HB_RESET_LOG_HEAD_ADDR);
+    uint8_t count = eeprom_read_byte((const uint8_t*) HB_RESET_LOG_COUNT_ADDR);
+    if (head >= HB_RESET_LOG_SIZE) {
+        head = 0;
+    }
+
+    uint16_t addr = HB_RESET_LOG_ENTRIES_ADDR +
+        (uint16_t) head * sizeof(hb_reset_log_entry_t);
+    eeprom_update_block(entry, (void*) addr, sizeof(hb_reset_log_entry_t));
+
+    head = (head + 1) % HB_RESET_LOG_SIZE;
+    if (count < HB_RESET_LOG_SIZE) {
+        count++;
+    }
+    eeprom_update_byte((uint8_t*) HB_RESET_LOG_HEAD_ADDR, head);
+    eeprom_update_byte((uint8_t*) HB_RESET_LOG_COUNT_ADDR, count);
+}
+
+/*
+Returns - number of entries in the reset log
+*/
+uint8_t hb_reset_log_count(void) {
+    if (eeprom_read_word((const uint16_t*) HB_RESET_LOG_EEPROM_ADDR) !=
+            HB_RESET_LOG_EEPROM_MAGIC) {
+        return 0;
+    }
+
+    uint8_t count = eeprom_read_byte((const uint8_t*) HB_RESET_LOG_COUNT_ADDR);
+    if (count > HB_RESET_LOG_SIZE) {
+        count = HB_RESET_LOG_SIZE;
+    }
+    return count;
+}
+
+/*
+Reads an entry of the reset log.
+index - 0 for the oldest entry, up to hb_reset_log_count() - 1 for the newest
+entry - will be populated with the entry
+Returns - 1 if successful, 0 if there is no entry at this index
+*/
+uint8_t read_hb_reset_log(uint8_t index, hb_reset_log_entry_t* entry) {
+    uint8_t count = hb_reset_log_count();
+    if (index >= count) {
+        return 0;
+    }
+
+    uint8_t head = eeprom_read_byte((const uint8_t*) HB_RESET_LOG_HEAD_ADDR);
+    if (head >= HB_RESET_LOG_SIZE) {
+        head = 0;
+    }
+    // The oldest entry is count entries before the head
+    uint8_t slot = (head + HB_RESET_LOG_SIZE - count + index) % HB_RESET_LOG_SIZE;
+
+    uint16_t addr = HB_RESET_LOG_ENTRIES_ADDR +
+        (uint16_t) slot * sizeof(hb_reset_log_entry_t);
+    eeprom_read_block(entry, (const void*) addr, sizeof(hb_reset_log_entry_t));
+    return 1;
+}
+
+/*
+Removes all entries from the reset log.
+*/
+void clear_hb_reset_log(void) {
+    // Start the entry flush_hb_reset_log() is writing again after the new head
+    hb_log_step = 0;
+    eeprom_update_word((uint16_t*) HB_RESET_LOG_EEPROM_ADDR,
+        HB_RESET_LOG_EEPROM_MAGIC);
+    eeprom_update_byte((uint8_t*) HB_RESET_LOG_HEAD_ADDR, 0);
+    eeprom_update_byte((uint8_t*) HB_RESET_LOG_COUNT_ADDR, 0);
+}
+
+/*
+Adds an entry to the reset log without waiting for the EEPROM. The entry is
+written by flush_hb_reset_log(). If HB_RESET_LOG_PENDING_SIZE entries are
+already waiting, the entry is dropped (counted in hb_reset_log_dropped).
+*/
+void queue_hb_reset_log(const hb_reset_log_entry_t* entry) {
+    if (hb_log_pending_count >= HB_RESET_LOG_PENDING_SIZE) {
+        hb_reset_log_dropped += 1;
+        return;
+    }
+
+    uint8_t tail = (hb_log_pending_head + hb_log_pending_count) %
+        HB_RESET_LOG_PENDING_SIZE;
+    hb_log_pending[tail] = *entry;
+    hb_log_pending_count++;
+}
+
+// Gets the address and value of a step of writing the oldest pending entry
+static uint16_t hb_log_step_byte(uint8_t step, uint8_t* value) {
+    if (step < sizeof(hb_reset_log_entry_t)) {
+        *value = ((const uint8_t*) &hb_log_pending[hb_log_pending_head])[step];
+        // The new head is one past the slot being written
+        uint8_t slot = (hb_log_new_head + HB_RESET_LOG_SIZE - 1) %
+            HB_RESET_LOG_SIZE;
+        return HB_RESET_LOG_ENTRIES_ADDR +
+            (uint16_t) slot * sizeof(hb_reset_log_entry_t) + step;
+    }
+    step -= sizeof(hb_reset_log_entry_t);
+
+    if (step == 0) {
+        *value = hb_log_new_head;
+        return HB_RESET_LOG_HEAD_ADDR;
+    }
+    if (step == 1) {
+        *value = hb_log_new_count;
+        return HB_RESET_LOG_COUNT_ADDR;
+    }
+    step -= 2;
+
+    *value = (HB_RESET_LOG_EEPROM_MAGIC >> (step * 8)) & 0xFF;
+    return HB_RESET_LOG_EEPROM_ADDR + step;
+}
+
+/*
+Writes the entries added with queue_hb_reset_log() to EEPROM, at most one byte
+per call (like eeprom_update_byte(), bytes that don't change are skipped).
+Never waits for the EEPROM. This should be called regularly (run_hb() does).
+Returns - 1 if entries are still waiting to be written, 0 otherwise
+*/
+uint8_t flush_hb_reset_log(void) {
+    while (hb_log_pending_count > 0) {
+        if (!eeprom_is_ready()) {
+            return 1;
+        }
+
+        if (hb_log_step == 0) {
+            // Start writing the oldest pending entry after the current head
+            // (the log starts empty if the header is not valid)
+            uint8_t head = 0;
+            uint8_t count = 0;
+            if (eeprom_read_word((const uint16_t*) HB_RESET_LOG_EEPROM_ADDR) ==
+                    HB_RESET_LOG_EEPROM_MAGIC) {
+                head = eeprom_read_byte((const uint8_t*) HB_RESET_LOG_HEAD_ADDR);
+                count = eeprom_read_byte(
+                    (const uint8_t*) HB_RESET_LOG_COUNT_ADDR);
+            }
+            if (head >= HB_RESET_LOG_SIZE) {
+                head = 0;
+            }
+            hb_log_new_head = (head + 1) % HB_RESET_LOG_SIZE;
+            hb_log_new_count = (count < HB_RESET_LOG_SIZE) ? count + 1 :
+                HB_RESET_LOG_SIZE;
+        }
+
+        uint8_t value;
+        uint8_t* addr = (uint8_t*) hb_log_step_byte(hb_log_step, &value);
+        hb_log_step++;
+        if (hb_log_step >= HB_RESET_LOG_WRITE_STEPS) {
+            hb_log_step = 0;
+            hb_log_pending_head = (hb_log_pending_head + 1) %
+                HB_RESET_LOG_PENDING_SIZE;
+            hb_log_pending_count--;
+        }
+
+        if (eeprom_read_byte(addr) != value) {
+            // Starts the write, which finishes in the background
+            eeprom_write_byte(addr, value);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+Heartbeat statistics
+
+Keeps ping statistics for each peer (round trip time, missed pings, resets and
+peer restarts) so the heartbeat period (hb_req_period_s) and wait time
+(hb_resp_wait_time_s) can be chosen from real data. The statistics are kept in
+RAM in each hb_dev_t and can optionally be saved to EEPROM with
+save_hb_stats() and restored after a restart with load_hb_stats().
+
+Round trip times use hb_time_ms(), which defaults to millis() if the clock is
+running (init_clock()), or uptime_s * 1000 (1 second resolution) otherwise. Use
+set_hb_time_fn() to provide another clock.
+*/
+
+#include <heartbeat/heartbeat.h>
+
+_Static_assert(sizeof(uint16_t) + HB_MAX_DEVS * sizeof(hb_stats_t) <=
+    HB_STATS_EEPROM_SIZE, "Heartbeat statistics are too large");
+
+// Time source for round trip times (NULL to use millis() or uptime_s)
+static hb_time_fn_t hb_time_fn = NULL;
+
+/*
+Sets the function used to get the time for round trip times.
+fn - returns the current time in milliseconds, or NULL to use millis() or
+    uptime_s
+*/
+void set_hb_time_fn(hb_time_fn_t fn) {
+    hb_time_fn = fn;
+}
+
+/*
+Returns - the current time in milliseconds (only useful for differences)
+*/
+uint32_t hb_time_ms(void) {
+    if (hb_time_fn != NULL) {
+        return hb_time_fn();
+    }
+    if (clock_running()) {
+        return millis();
+    }
+
+    uint32_t uptime;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uptime = uptime_s;
+    }
+    return uptime * 1000UL;
+}
+
+/*
+Records a successful ping.
+rtt_ms - round trip time
+wait_ms - time allowed for the response (to count slow responses)
+*/
+void record_hb_rtt(hb_stats_t* stats, uint32_t rtt_ms, uint32_t wait_ms) {
+    stats->last_rtt_ms = rtt_ms;
+    if (stats->num_pings == 0 || rtt_ms < stats->min_rtt_ms) {
+        stats->min_rtt_ms = rtt_ms;
+    }
+    if (rtt_ms > stats->max_rtt_ms) {
+        stats->max_rtt_ms = rtt_ms;
+    }
+
+    // Stop adding to the total once the count saturates so the mean stays
+    // correct
+    if (stats->num_pings < UINT16_MAX) {
+        stats->total_rtt_ms += rtt_ms;
+        stats->num_pings++;
+    }
+    if (rtt_ms > wait_ms / 2 && stats->num_slow < UINT16_MAX) {
+        stats->num_slow++;
+    }
+
+    stats->consec_misses = 0;
+}
+
+/*
+Records a ping without a response.
+*/
+void record_hb_miss(hb_stats_t* stats) {
+    if (stats->num_misses < UINT16_MAX) {
+        stats->num_misses++;
+    }
+    if (stats->consec_misses < UINT8_MAX) {
+        stats->consec_misses++;
+    }
+    if (stats->consec_misses > stats->max_consec_misses) {
+        stats->max_consec_misses = stats->consec_misses;
+    }
+}
+
+/*
+Records a reset of the peer.
+*/
+void record_hb_reset(hb_stats_t* stats) {
+    if (stats->num_resets < UINT16_MAX) {
+        stats->num_resets++;
+    }
+}
+
+/*
+Records the restart count received in a ping response.
+*/
+void record_hb_restart_count(hb_stats_t* stats, uint32_t restart_count) {
+    if (stats->restart_count_valid && restart_count > stats->last_restart_count) {
+        stats->restart_count_delta += restart_count - stats->last_restart_count;
+    }
+    stats->last_restart_count = restart_count;
+    stats->restart_count_valid = 1;
+}
+
+/*
+Gets the statistics of one peer.
+id - heartbeat ID of the peer (e.g. HB_EPS)
+stats - will be populated with the statistics
+Returns - 1 if successful, 0 if there is no node with this ID
+*/
+uint8_t get_hb_stats(uint8_t id, hb_stats_t* stats) {
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        if (hb_devs[i]->id == id) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                *stats = hb_devs[i]->stats;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+Returns - mean round trip time of successful pings (ms), 0 if there are none
+*/
+uint32_t get_hb_mean_rtt_ms(const hb_stats_t* stats) {
+    if (stats->num_pings == 0) {
+        return 0;
+    }
+    return stats->total_rtt_ms / stats->num_pings;
+}
+
+/*
+Clears the statistics of all nodes (in RAM only).
+*/
+void reset_hb_stats(void) {
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            memset((hb_stats_t*) &hb_devs[i]->stats, 0, sizeof(hb_stats_t));
+        }
+    }
+}
+
+/*
+Saves the statistics of all nodes to EEPROM, starting at HB_STATS_EEPROM_ADDR,
+in the order of the node table. Only changed bytes are written.
+*/
+void save_hb_stats(void) {
+    uint16_t addr = HB_STATS_EEPROM_ADDR;
+    eeprom_update_word((uint16_t*) addr, HB_STATS_EEPROM_MAGIC);
+    addr += sizeof(uint16_t);
+
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_stats_t stats;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            stats = hb_devs[i]->stats;
+        }
+        eeprom_update_block(&stats, (void*) addr, sizeof(stats));
+        addr += sizeof(stats);
+    }
+}
+
+/*
+Restores the statistics of all nodes saved with save_hb_stats().
+Returns - 1 if successful, 0 if no statistics were saved
+*/
+uint8_t load_hb_stats(void) {
+    uint16_t addr = HB_STATS_EEPROM_ADDR;
+    if (eeprom_read_word((const uint16_t*) addr) != HB_STATS_EEPROM_MAGIC) {
+        return 0;
+    }
+    addr += sizeof(uint16_t);
+
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_stats_t stats;
+        eeprom_read_block(&stats, (const void*) addr, sizeof(stats));
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            hb_devs[i]->stats = stats;
+        }
+        addr += sizeof(stats);
+    }
+    return 1;
+}
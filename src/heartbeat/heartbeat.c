@@ -58,11 +58,16 @@ pin_info_t pay_rst_eps = {
 volatile hb_dev_t obc_hb_dev = {
     .name = "OBC",
     .id = HB_OBC,
+    .mob_num = OBC_HB_MOB_NUM,
+    .rx_id = OBC_OBC_HB_RX_MOB_ID,
     .ping_in_progress = false,
     .send_req_flag = false,
     .rcvd_resp_flag = false,
     .send_resp_flag = false,
+    .tx_busy = false,
+    .tx_opcode = 0,
     .reset = NULL,
+    .reset_active = false,
     .ping_start_uptime_s = 0,
     .restart_reason = 0,
     .restart_count = 0,
@@ -70,11 +75,16 @@ volatile hb_dev_t obc_hb_dev = {
 volatile hb_dev_t eps_hb_dev = {
     .name = "EPS",
     .id = HB_EPS,
+    .mob_num = EPS_HB_MOB_NUM,
+    .rx_id = EPS_EPS_HB_RX_MOB_ID,
     .ping_in_progress = false,
     .send_req_flag = false,
     .rcvd_resp_flag = false,
     .send_resp_flag = false,
+    .tx_busy = false,
+    .tx_opcode = 0,
     .reset = NULL,
+    .reset_active = false,
     .ping_start_uptime_s = 0,
     .restart_reason = 0,
     .restart_count = 0,
@@ -82,11 +92,16 @@ volatile hb_dev_t eps_hb_dev = {
 volatile hb_dev_t pay_hb_dev = {
     .name = "PAY",
     .id = HB_PAY,
+    .mob_num = PAY_HB_MOB_NUM,
+    .rx_id = PAY_PAY_HB_RX_MOB_ID,
     .ping_in_progress = false,
     .send_req_flag = false,
     .rcvd_resp_flag = false,
     .send_resp_flag = false,
+    .tx_busy = false,
+    .tx_opcode = 0,
     .reset = NULL,
+    .reset_active = false,
     .ping_start_uptime_s = 0,
     .restart_reason = 0,
     .restart_count = 0,
@@ -98,6 +113,21 @@ volatile hb_dev_t* all_hb_devs[HB_NUM_DEVS] = {
     &pay_hb_dev,
 };
 
+hb_reset_line_t all_hb_reset_lines[] = {
+    { HB_OBC, HB_EPS, &obc_rst_eps },
+    { HB_OBC, HB_PAY, &obc_rst_pay },
+    { HB_EPS, HB_OBC, &eps_rst_obc },
+    { HB_EPS, HB_PAY, &eps_rst_pay },
+    { HB_PAY, HB_OBC, &pay_rst_obc },
+    { HB_PAY, HB_EPS, &pay_rst_eps },
+};
+
+volatile hb_dev_t** hb_devs = all_hb_devs;
+uint8_t hb_num_devs = HB_NUM_DEVS;
+hb_reset_line_t* hb_reset_lines = all_hb_reset_lines;
+uint8_t hb_num_reset_lines =
+    sizeof(all_hb_reset_lines) / sizeof(all_hb_reset_lines[0]);
+
 // Assume OBC just in case
 volatile hb_dev_t* self_hb_dev = &obc_hb_dev;
 
@@ -107,6 +137,24 @@ volatile uint32_t hb_req_prev_uptime_s = 0;
 volatile uint32_t hb_req_period_s = HB_REQ_PERIOD_S;
 volatile uint32_t hb_resp_wait_time_s = HB_RESP_WAIT_TIME_S;
 
+// Set by the CAN RX/TX interrupts when run_hb() has something to do
+volatile bool hb_event_flag = false;
+// Earliest uptime at which run_hb() has a deadline to check (other than the
+// regular request period)
+volatile uint32_t hb_next_check_s = UINT32_MAX;
+// Number of reset lines that are asserted (released by run_hb())
+static uint8_t hb_resets_active = 0;
+
+// If true, any frame received from a peer counts as a sign of life and
+// requests are only sent to peers that have been silent for
+// hb_silence_period_s (see set_hb_implicit())
+volatile bool hb_implicit_mode = false;
+volatile uint32_t hb_silence_period_s = HB_REQ_PERIOD_S;
+// CAN RX hook that was set before hb_can_rx_hook() (called from it)
+static can_rx_hook_t hb_prev_rx_hook = NULL;
+// If hb_can_rx_hook() is set as the CAN RX hook
+static bool hb_rx_hook_set = false;
+
 
 void init_hb_resets(void);
 void init_hb_rx_mob(mob_t* mob, uint8_t mob_num, uint16_t id_tag);
@@ -116,12 +164,45 @@ void hb_tx_cb(uint8_t* data, uint8_t* len);
 void hb_rx_cb(const uint8_t* data, uint8_t len);
 
 
+/*
+Uses a different table of nodes and reset lines (e.g. to add another board).
+Must be called before init_hb().
+devs - array of pointers to all nodes, including this one
+num_devs - number of nodes (at most HB_MAX_DEVS)
+reset_lines - array of reset lines between nodes
+num_reset_lines - number of reset lines
+Returns - true if the tables are used, false if there are too many nodes or a
+    node ID is out of range (0 to HB_MAX_DEVS - 1) or used twice (the tables in
+    use don't change)
+*/
+bool set_hb_devs(volatile hb_dev_t** devs, uint8_t num_devs,
+        hb_reset_line_t* reset_lines, uint8_t num_reset_lines) {
+    if (num_devs > HB_MAX_DEVS) {
+        return false;
+    }
+    // Nodes are told apart by the 2-bit sender ID in HB_TX_MOB_ID()
+    uint8_t ids = 0;
+    for (uint8_t i = 0; i < num_devs; i++) {
+        uint8_t id = devs[i]->id;
+        if (id >= HB_MAX_DEVS || (ids & _BV(id))) {
+            return false;
+        }
+        ids |= _BV(id);
+    }
+
+    hb_devs = devs;
+    hb_num_devs = num_devs;
+    hb_reset_lines = reset_lines;
+    hb_num_reset_lines = num_reset_lines;
+    return true;
+}
+
 // Assumes init_uptime() and init_can() have already been called,
 // but init_rx_mob() and init_tx_mob() have NOT been called on the HB MOBs
 void init_hb(uint8_t self_id) {
-    for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-        if (all_hb_devs[i]->id == self_id) {
-            self_hb_dev = all_hb_devs[i];
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        if (hb_devs[i]->id == self_id) {
+            self_hb_dev = hb_devs[i];
         }
     }
 
@@ -130,38 +211,32 @@ void init_hb(uint8_t self_id) {
 }
 
 void init_hb_resets(void) {
-    // Set self heartbeat reset just in case, but it should never be triggered
-    switch (self_hb_dev->id) {
-        case HB_OBC:
-            obc_hb_dev.reset = &obc_rst_pay;
-            pay_hb_dev.reset = &obc_rst_pay;
-            eps_hb_dev.reset = &obc_rst_eps;
-            break;
-        case HB_PAY:
-            obc_hb_dev.reset = &pay_rst_obc;
-            pay_hb_dev.reset = &pay_rst_obc;
-            eps_hb_dev.reset = &pay_rst_eps;
-            break;
-        case HB_EPS:
-            obc_hb_dev.reset = &eps_rst_obc;
-            pay_hb_dev.reset = &eps_rst_pay;
-            eps_hb_dev.reset = &eps_rst_pay;
-            break;
-        default:
-#ifdef HB_DEBUG
-            print("Error: %s\n", __FUNCTION__);
-#endif
-            return;
-    }
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+        dev->reset = NULL;
+
+        if (dev == self_hb_dev) {
+            continue;
+        }
 
-    for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-        hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
+        for (uint8_t j = 0; j < hb_num_reset_lines; j++) {
+            hb_reset_line_t* line = &hb_reset_lines[j];
+            if (line->from_id == self_hb_dev->id && line->to_id == dev->id) {
+                dev->reset = line->pin;
+                break;
+            }
+        }
 
-        if (dev != self_hb_dev) {
+        if (dev->reset != NULL) {
             // See table on p.96 - by default, need tri-state input with pullup (DDR = 0, PORT = 1)
             init_input_pin(dev->reset->pin, dev->reset->ddr);
             set_pin_pullup(dev->reset->pin, dev->reset->port, 1);
         }
+#ifdef HB_DEBUG
+        else {
+            print("No reset line to %u (%s)\n", dev->id, dev->name);
+        }
+#endif
     }
 }
 
@@ -192,137 +267,130 @@ void init_hb_tx_mob(mob_t* mob, uint8_t mob_num, uint16_t id_tag) {
     mob->id_tag.std = id_tag;
     mob->ctrl = hb_tx_ctrl;
     mob->tx_data_cb = hb_tx_cb;
+    mob->tx_done_cb = hb_tx_done_cb;
+    mob->tx_err_cb = hb_tx_err_cb;
 
     init_tx_mob(mob);
 }
 
 void init_hb_mobs(void) {
-    switch (self_hb_dev->id) {
-        case HB_OBC:
-            init_hb_rx_mob((mob_t*) &obc_hb_dev.mob, OBC_HB_MOB_NUM, OBC_OBC_HB_RX_MOB_ID);
-            init_hb_tx_mob((mob_t*) &pay_hb_dev.mob, PAY_HB_MOB_NUM, OBC_PAY_HB_TX_MOB_ID);
-            init_hb_tx_mob((mob_t*) &eps_hb_dev.mob, EPS_HB_MOB_NUM, OBC_EPS_HB_TX_MOB_ID);
-            break;
-        case HB_PAY:
-            init_hb_tx_mob((mob_t*) &obc_hb_dev.mob, OBC_HB_MOB_NUM, PAY_OBC_HB_TX_MOB_ID);
-            init_hb_rx_mob((mob_t*) &pay_hb_dev.mob, PAY_HB_MOB_NUM, PAY_PAY_HB_RX_MOB_ID);
-            init_hb_tx_mob((mob_t*) &eps_hb_dev.mob, EPS_HB_MOB_NUM, PAY_EPS_HB_TX_MOB_ID);
-            break;
-        case HB_EPS:
-            init_hb_tx_mob((mob_t*) &obc_hb_dev.mob, OBC_HB_MOB_NUM, EPS_OBC_HB_TX_MOB_ID);
-            init_hb_tx_mob((mob_t*) &pay_hb_dev.mob, PAY_HB_MOB_NUM, EPS_PAY_HB_TX_MOB_ID);
-            init_hb_rx_mob((mob_t*) &eps_hb_dev.mob, EPS_HB_MOB_NUM, EPS_EPS_HB_RX_MOB_ID);
-            break;
-        default:
- #ifdef HB_DEBUG
-            print("Error: %s\n", __FUNCTION__);
-#endif
-            break;
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+
+        if (dev == self_hb_dev) {
+            init_hb_rx_mob(&dev->mob, dev->mob_num, dev->rx_id);
+        } else {
+            init_hb_tx_mob(&dev->mob, dev->mob_num,
+                HB_TX_MOB_ID(dev->rx_id, self_hb_dev->id));
+        }
     }
 }
 
 
+// Called by resume_mob() when run_hb() loads a message into a TX MOb
 void hb_tx_cb(uint8_t* data, uint8_t* len) {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        // Set up CAN message data to be sent
-        *len = 8;
-        for (uint8_t i = 0; i < *len; i++){
-            data[i] = 0x00;
-        }
+    // Set up CAN message data to be sent
+    *len = 8;
+    for (uint8_t i = 0; i < *len; i++){
+        data[i] = 0x00;
+    }
 
-        // Must return after setting message contents to make sure the data
-        // bytes are not overwritten by another message that needs to be sent
+    // run_hb() sets tx_opcode on only one device before calling resume_mob()
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
 
-        // Send ping response
-        for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-            hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
+        if (dev != self_hb_dev && dev->tx_opcode != 0) {
+            data[HB_SENDER] = self_hb_dev->id;
+            data[HB_RECEIVER] = dev->id;
+            data[HB_OPCODE] = dev->tx_opcode;
 
-            if (dev != self_hb_dev && dev->send_resp_flag) {
-                dev->send_resp_flag = false;
-
-                data[HB_SENDER] = self_hb_dev->id;
-                data[HB_RECEIVER] = dev->id;
-                data[HB_OPCODE] = HB_PING_RESPONSE;
+            if (dev->tx_opcode == HB_PING_RESPONSE) {
                 data[HB_RESTART_REASON] = restart_reason;
                 data[HB_RESTART_COUNT+0] = (restart_count >> 24) & 0xFF;
                 data[HB_RESTART_COUNT+1] = (restart_count >> 16) & 0xFF;
                 data[HB_RESTART_COUNT+2] = (restart_count >> 8) & 0xFF;
                 data[HB_RESTART_COUNT+3] = (restart_count & 0xFF);
-
-                print("HB TX: ");
-                print_bytes(data, *len);
-                return;
             }
-        }
-
-        // Send ping request
-        for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-            hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
-
-            if (dev != self_hb_dev && dev->send_req_flag) {
-                dev->send_req_flag = false;
-
-                data[HB_SENDER] = self_hb_dev->id;
-                data[HB_RECEIVER] = dev->id;
-                data[HB_OPCODE] = HB_PING_REQUEST;
 
-                print("HB TX: ");
-                print_bytes(data, *len);
-                return;
-            }
+            dev->tx_opcode = 0;
+            return;
         }
     }
 
-    print("HB TX: ");
-    print_bytes(data, *len);
-
 #ifdef HB_DEBUG
     print("Error: %s\n", __FUNCTION__);
 #endif
 }
 
+// Called within the CAN ISR when a heartbeat TX MOb finishes sending
+void hb_tx_done_cb(uint8_t mob_num) {
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+        if (dev != self_hb_dev && dev->mob.mob_num == mob_num) {
+            dev->tx_busy = false;
+            // Another message might be waiting for this MOb
+            hb_event_flag = true;
+            return;
+        }
+    }
+}
+
+// Called within the CAN ISR when a heartbeat TX MOb reports an error (e.g. the
+// peer is not on the bus) or the CAN controller was reset after bus off
+void hb_tx_err_cb(uint8_t mob_num) {
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+        if (dev != self_hb_dev && dev->mob.mob_num == mob_num) {
+            // TXOK may never come, so don't wait for it before loading the
+            // next message (which replaces the one being retried)
+            if (dev->tx_busy) {
+                dev->tx_busy = false;
+                hb_event_flag = true;
+            }
+            return;
+        }
+    }
+}
+
 // This function will be called within an ISR when we receive a message
 void hb_rx_cb(const uint8_t* data, uint8_t len) {
+#ifdef HB_DEBUG
     print("HB RX: ");
     print_bytes((uint8_t*) data, len);
+#endif
 
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if (len != 8) {
-            return;
-        }
-        if (data[HB_RECEIVER] != self_hb_dev->id) {
-            return;
+    if (len != 8) {
+        return;
+    }
+    if (data[HB_RECEIVER] != self_hb_dev->id) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+        if (dev == self_hb_dev || data[HB_SENDER] != dev->id) {
+            continue;
         }
 
         // Ping Request received
         if (data[HB_OPCODE] == HB_PING_REQUEST) {
-            for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-                hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
-                if (data[HB_SENDER] == dev->id) {
-                    dev->send_resp_flag = true;
-                    return;
-                }
-            }
+            dev->send_resp_flag = true;
+            hb_event_flag = true;
+            return;
         }
 
         // Ping Response received
         if (data[HB_OPCODE] == HB_PING_RESPONSE) {
-            uint8_t reason = data[HB_RESTART_REASON];
-            uint32_t count =
+            dev->rcvd_resp_flag = true;
+            dev->resp_time_ms = hb_time_ms();
+            dev->restart_reason = data[HB_RESTART_REASON];
+            dev->restart_count =
                 ((uint32_t) data[HB_RESTART_COUNT+0] << 24) |
                 ((uint32_t) data[HB_RESTART_COUNT+1] << 16) |
                 ((uint32_t) data[HB_RESTART_COUNT+2] << 8) |
                 ((uint32_t) data[HB_RESTART_COUNT+3]);
-
-            for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-                hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
-                if (data[HB_SENDER] == dev->id) {
-                    dev->rcvd_resp_flag = true;
-                    dev->restart_reason = reason;
-                    dev->restart_count = count;
-                    return;
-                }
-            }
+            hb_event_flag = true;
+            return;
         }
     }
 
@@ -331,146 +399,332 @@ void hb_rx_cb(const uint8_t* data, uint8_t len) {
 #endif
 }
 
-bool wait_for_hb_mob_not_paused(mob_t* mob) {
-    // Wait up to 5 ms
-    for (uint16_t i = 0; i < 5; i++) {
-        if (is_paused(mob)) {
-            return true;
-        }
-        _delay_ms(1);
-    }
-
+/*
+Starts resetting a device by asserting its reset line. This does not wait: the
+line is released by run_hb() after HB_RESET_PULSE_MS if the clock is running
+(init_clock()), or after 1-2 s otherwise (uptime_s resolution).
+Returns - true if the reset was started (or is already in progress), false if
+    there is no reset line to the device
+*/
+bool send_hb_reset(hb_dev_t* device) {
+    if (device->reset == NULL) {
 #ifdef HB_DEBUG
-    print("Error: %s\n", __FUNCTION__);
+        print("HB no reset line to %u (%s)\n", device->id, device->name);
 #endif
-    return false;
-}
+        return false;
+    }
+    if (device->reset_active) {
+        return true;
+    }
 
-bool send_hb_reset(hb_dev_t* device) {
+#ifdef HB_DEBUG
     print("HB reset to %u (%s)\n", device->id, device->name);
+#endif
+    record_hb_reset(&device->stats);
 
     // Assert the reset
     // See table on p.96 - for reset, need to output low (DDR = 1, PORT = 0)
-    // Then go back to tri-state input with pullup (DDR = 0, PORT = 1)
     init_output_pin(device->reset->pin, device->reset->ddr, 0);
-    _delay_ms(10);
-    init_input_pin(device->reset->pin, device->reset->ddr);
-    set_pin_pullup(device->reset->pin, device->reset->port, 1);
+    device->reset_active = true;
+    device->reset_start_ms = clock_running() ? millis() : 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        device->reset_start_s = uptime_s;
+    }
+    hb_resets_active++;
 
     return true;
 }
 
-// This should be run in the main loop
-// because we can't interrupt inside of an interrupt, etc.
-void run_hb(void) {
-#ifdef HB_VERBOSE
-    print("%s\n", __FUNCTION__);
-#endif
+// Releases the reset lines that have been asserted for long enough
+static void release_hb_resets(uint32_t now) {
+    if (hb_resets_active == 0) {
+        return;
+    }
 
-    // If we are currently in the process of sending a CAN message, wait until
-    // all TX MOBs are paused before possibly trying to send another message
-    // Don't check self (RX MOB) because it is always in receive mode and never
-    // paused
-    // This must be outside the atomic block because the MOB is only unpaused
-    // (set CONMOB[1:0] = 0b00) by our CAN library when a TX interrupt occurs
-    // (after it actually sends a message)
-    for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-        hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];        
-        if (dev != self_hb_dev) {
-            wait_for_hb_mob_not_paused(&dev->mob);
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+        if (!dev->reset_active) {
+            continue;
         }
-    }
 
-    // Do all this logic in an atomic block because the structs and flags could
-    // be modified by CAN RX interrupts
-    // Note if we send a CAN message we return from the ISR because we can only
-    // load one message at a time
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        // Send response - check if we need to respond to a request first so we
-        // don't get reset
-        for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-            hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
+        // reset_start_ms is 0 if the clock was not running, then wait at least
+        // one full second of uptime instead
+        if ((dev->reset_start_ms != 0 &&
+                millis() - dev->reset_start_ms >= HB_RESET_PULSE_MS) ||
+                now >= dev->reset_start_s + 2) {
+            // Go back to tri-state input with pullup (DDR = 0, PORT = 1)
+            init_input_pin(dev->reset->pin, dev->reset->ddr);
+            set_pin_pullup(dev->reset->pin, dev->reset->port, 1);
+            dev->reset_active = false;
+            hb_resets_active--;
+        }
+    }
+}
 
-            if ((dev != self_hb_dev) && dev->send_resp_flag) {
+// Loads a heartbeat message into a device's TX MOb without waiting for it to
+// be sent
+static void send_hb_msg(hb_dev_t* dev, uint8_t opcode) {
 #ifdef HB_DEBUG
-                print("HB resp to %u (%s)\n", dev->id, dev->name);
+    print("HB %s to %u (%s)\n",
+        (opcode == HB_PING_REQUEST) ? "req" : "resp", dev->id, dev->name);
 #endif
 
-                resume_mob(&dev->mob);
-
-                // Make sure to do this after resume_mob, which calls the TX
-                // callback which checks this flag to be true
-                dev->send_resp_flag = false;
+    // resume_mob() changes CANPAGE, which the CAN ISR also uses
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dev->tx_busy = true;
+        dev->tx_opcode = opcode;
+        resume_mob(&dev->mob);
+    }
+}
 
-                return;
+/*
+Enables or disables implicit heartbeat. In implicit mode, every frame received
+from a peer (heartbeat, housekeeping, commands, ...) refreshes its liveness, and
+a ping request is only sent once a peer has been silent for silence_period_s.
+Peers that don't answer that request are still reset. Must be called after
+init_can().
+
+Uses the CAN RX hook (see set_can_rx_hook()). A hook the application set before
+is still called for every frame, and is put back when implicit mode is
+disabled. If the application sets its own hook after this, it must chain
+hb_can_rx_hook() (the previous hook returned by set_can_rx_hook()).
+enabled - true to enable implicit heartbeat, false to go back to pinging every
+    hb_req_period_s
+silence_period_s - number of seconds without any frame from a peer before
+    pinging it
+*/
+void set_hb_implicit(bool enabled, uint32_t silence_period_s) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        hb_implicit_mode = enabled;
+        hb_silence_period_s = silence_period_s;
+        for (uint8_t i = 0; i < hb_num_devs; i++) {
+            hb_devs[i]->last_seen_uptime_s = uptime_s;
+        }
+        // Let run_hb() recompute its deadlines
+        hb_next_check_s = 0;
+
+        if (enabled && !hb_rx_hook_set) {
+            hb_prev_rx_hook = set_can_rx_hook(hb_can_rx_hook);
+            hb_rx_hook_set = true;
+        } else if (!enabled && hb_rx_hook_set) {
+            // Only remove the hook if no other hook was set after it (that
+            // one still calls hb_can_rx_hook(), which only chains when
+            // implicit mode is disabled)
+            can_rx_hook_t hook = set_can_rx_hook(hb_prev_rx_hook);
+            if (hook == hb_can_rx_hook) {
+                hb_rx_hook_set = false;
+            } else {
+                set_can_rx_hook(hook);
             }
         }
+    }
+}
 
-        // Check for response - check that we received responses to any requests
-        // we already sent out
-        for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-            hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
+// Called within the CAN ISR for every received frame
+void hb_can_rx_hook(uint8_t mob_num, uint16_t id) {
+    if (hb_prev_rx_hook != NULL) {
+        hb_prev_rx_hook(mob_num, id);
+    }
+    if (!hb_implicit_mode) {
+        return;
+    }
 
-            if ((dev != self_hb_dev) && dev->ping_in_progress) {
-                // If we received a response
-                if (dev->rcvd_resp_flag) {
-                    dev->ping_in_progress = false;
-                    dev->send_req_flag = false;
-                    dev->rcvd_resp_flag = false;
+    // Sender ID is in bits 1-2 (see HB_TX_MOB_ID())
+    uint8_t sender = (id >> 1) & 0x03;
 
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        if (hb_devs[i]->id == sender && hb_devs[i] != self_hb_dev) {
+            hb_devs[i]->last_seen_uptime_s = uptime_s;
+            return;
+        }
+    }
+}
+
+// Marks a ping request to a peer as needed, it is sent once the MOb is free
+static void start_hb_ping(hb_dev_t* dev, uint32_t now) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dev->ping_in_progress = false;
+        dev->send_req_flag = true;
+        dev->rcvd_resp_flag = false;
+    }
+    dev->ping_start_uptime_s = now;
+}
+
+/*
+Resets a peer that failed a ping if the escalation policy allows it, and
+records the reset (or the suppressed reset) in the reset log.
+*/
+static void escalate_hb_reset(hb_dev_t* dev, uint8_t reason, uint32_t now) {
+    hb_reset_log_entry_t entry = {
+        .uptime_s = now,
+        .peer_id = dev->id,
+        .reason = reason,
+        .peer_restart_count = dev->restart_count,
+    };
+
+    if (hb_reset_allowed(&dev->reset_state, now)) {
+        send_hb_reset(dev);
+    } else {
+        entry.reason |= HB_RESET_SUPPRESSED;
 #ifdef HB_DEBUG
-                    print("HB ping to %u (%s) - success\n", dev->id, dev->name);
+        print("HB reset of %u (%s) suppressed\n", dev->id, dev->name);
 #endif
-                }
-                
-                // If the wait period has elapsed without receiving a response
-                else if (uptime_s >= hb_req_prev_uptime_s + hb_resp_wait_time_s) {
-                    dev->ping_in_progress = false;
-                    dev->send_req_flag = false;
-                    dev->rcvd_resp_flag = false;
+    }
 
-#ifdef HB_DEBUG
-                    print("HB ping to %u (%s) - fail\n", dev->id, dev->name);
+    // Written to EEPROM a byte at a time by run_hb()
+    queue_hb_reset_log(&entry);
+}
+
+/*
+This should be run in the main loop. It never waits: it only does work when a
+CAN interrupt reported an event (request or response received, TX MOb free or
+failed) or a heartbeat deadline has passed, and returns right away otherwise.
+Resets and reset log writes are also finished a step at a time by later calls
+(a reset line is released by the first call after HB_RESET_PULSE_MS).
+*/
+void run_hb(void) {
+#ifdef HB_VERBOSE
+    print("%s\n", __FUNCTION__);
 #endif
 
-                    send_hb_reset(dev);
-                }
+    // Snapshot everything the interrupts can modify
+    bool event;
+    uint32_t now;
+    uint32_t prev;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        event = hb_event_flag;
+        hb_event_flag = false;
+        now = uptime_s;
+        prev = hb_req_prev_uptime_s;
+    }
+
+    // Finish the resets and reset log writes started by earlier calls
+    release_hb_resets(now);
+    flush_hb_reset_log();
+
+    bool req_due = !hb_implicit_mode && (now >= prev + hb_req_period_s);
+    if (!event && !req_due && now < hb_next_check_s) {
+        return;
+    }
+
+    // Start pings - it is time to send another ping to all other devices, but
+    // the requests are only sent once the MObs are free
+    if (req_due) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            hb_req_prev_uptime_s = now;
+        }
+
+        for (uint8_t i = 0; i < hb_num_devs; i++) {
+            hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+            if (dev != self_hb_dev) {
+                start_hb_ping(dev, now);
             }
         }
+    }
 
-        // Set request flag - check if it is time to send another ping to both
-        // other devices - just set the flags if so, but don't send yet
-        if (uptime_s >= hb_req_prev_uptime_s + hb_req_period_s) {
-            hb_req_prev_uptime_s = uptime_s;
-            
-            for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-                hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
+    uint32_t next_check = UINT32_MAX;
+    for (uint8_t i = 0; i < hb_num_devs; i++) {
+        hb_dev_t* dev = (hb_dev_t*) hb_devs[i];
+        if (dev == self_hb_dev) {
+            continue;
+        }
 
-                if (dev != self_hb_dev) {
+        bool tx_busy;
+        bool send_resp;
+        bool rcvd_resp;
+        uint32_t resp_time_ms;
+        uint32_t peer_restart_count;
+        uint32_t last_seen;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            tx_busy = dev->tx_busy;
+            send_resp = dev->send_resp_flag;
+            rcvd_resp = dev->rcvd_resp_flag;
+            resp_time_ms = dev->resp_time_ms;
+            peer_restart_count = dev->restart_count;
+            last_seen = dev->last_seen_uptime_s;
+            if (!tx_busy && send_resp) {
+                dev->send_resp_flag = false;
+            }
+        }
+
+        // Send response - before anything else so we don't get reset
+        if (!tx_busy && send_resp) {
+            send_hb_msg(dev, HB_PING_RESPONSE);
+            tx_busy = true;
+        }
+
+        // Implicit mode - only ping peers that have been silent for too long
+        uint32_t last = (last_seen > dev->ping_start_uptime_s) ?
+            last_seen : dev->ping_start_uptime_s;
+        if (hb_implicit_mode && !dev->ping_in_progress && !dev->send_req_flag &&
+                now >= last + hb_silence_period_s) {
+            start_hb_ping(dev, now);
+        }
+
+        uint32_t deadline = dev->ping_start_uptime_s + hb_resp_wait_time_s;
+
+        // Check for response - check that we received responses to any
+        // requests we already sent out
+        if (dev->ping_in_progress) {
+            if (rcvd_resp) {
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
                     dev->ping_in_progress = false;
-                    dev->send_req_flag = true;
                     dev->rcvd_resp_flag = false;
                 }
+                record_hb_rtt(&dev->stats, resp_time_ms - dev->ping_start_ms,
+                    hb_resp_wait_time_s * 1000UL);
+                record_hb_restart_count(&dev->stats, peer_restart_count);
+                clear_hb_reset_backoff(&dev->reset_state);
+#ifdef HB_DEBUG
+                print("HB ping to %u (%s) - success (%lu ms)\n", dev->id,
+                    dev->name, dev->stats.last_rtt_ms);
+#endif
             }
-        }
-
-        // Send request - if the flag is set, send a request to another device
-        for (uint8_t i = 0; i < HB_NUM_DEVS; i++) {
-            hb_dev_t* dev = (hb_dev_t*) all_hb_devs[i];
 
-            if ((dev != self_hb_dev) && dev->send_req_flag) {
+            // If the wait period has elapsed without receiving a response
+            else if (now >= deadline) {
+                dev->ping_in_progress = false;
+                record_hb_miss(&dev->stats);
 #ifdef HB_DEBUG
-                print("HB req to %u (%s)\n", dev->id, dev->name);
+                print("HB ping to %u (%s) - fail\n", dev->id, dev->name);
 #endif
+                escalate_hb_reset(dev, HB_RESET_REASON_NO_RESP, now);
+            }
+        }
 
-                resume_mob(&dev->mob);
+        // If the request could not even be sent (the MOb never became free)
+        // within the wait period, treat it the same as a missing response
+        else if (dev->send_req_flag && now >= deadline) {
+            dev->send_req_flag = false;
+            record_hb_miss(&dev->stats);
+#ifdef HB_DEBUG
+            print("HB ping to %u (%s) - MOb busy\n", dev->id, dev->name);
+#endif
+            escalate_hb_reset(dev, HB_RESET_REASON_MOB_BUSY, now);
+        }
 
+        // Send request - if the flag is set and the MOb is free
+        if (!tx_busy && dev->send_req_flag) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
                 dev->ping_in_progress = true;
                 dev->send_req_flag = false;
                 dev->rcvd_resp_flag = false;
-                
-                return;
             }
+            dev->ping_start_ms = hb_time_ms();
+            send_hb_msg(dev, HB_PING_REQUEST);
+        }
+
+        if (dev->ping_in_progress || dev->send_req_flag) {
+            if (deadline < next_check) {
+                next_check = deadline;
+            }
+        }
+        // Once a ping is over (including after a timeout), wake up again when
+        // the peer has been silent for too long
+        else if (hb_implicit_mode && last + hb_silence_period_s < next_check) {
+            next_check = last + hb_silence_period_s;
         }
     }
+
+    hb_next_check_s = next_check;
 }
@@ -0,0 +1,144 @@
+/*
+Fixed-block memory pool
+
+A pool hands out blocks of one fixed size from static storage, identified by a
+one-byte handle. Messages can then be passed around by handle (e.g. in a
+DECLARE_QUEUE or DECLARE_SPSC_RING of uint8_t) instead of copying their payload
+at every hop: the CAN RX interrupt writes a frame into a block once, and the
+same block goes through the handler and out to a TX MOb.
+
+Example with one pool for CAN frames and one for framed UART messages:
+
+POOL_STORAGE(can_storage, sizeof(can_rx_frame_t), 8);
+POOL_STORAGE(uart_storage, 32, 4);
+pool_t can_pool;
+pool_t uart_pool;
+
+init_pool(&can_pool, can_storage, sizeof(can_rx_frame_t), 8);
+init_pool(&uart_pool, uart_storage, 32, 4);
+
+uint8_t handle = alloc_pool_block(&can_pool);
+if (handle != POOL_NO_BLOCK) {
+    can_rx_frame_t* frame = get_pool_block(&can_pool, handle);
+    ...
+    free_pool_block(&can_pool, handle);
+}
+
+The free blocks form a linked list through their first byte, so alloc and free
+take constant time. A map with one bit per block (at the end of the storage)
+records which blocks are free, so freeing a block twice or freeing an invalid
+handle is detected and rejected instead of corrupting the list. Alloc and free
+use an atomic block so interrupts and the main loop can share a pool.
+*/
+
+#include <pool/pool.h>
+
+// Returns a pointer to the start of a block
+static inline uint8_t* block_ptr(pool_t* pool, uint8_t handle) {
+    return pool->storage + (uint16_t) handle * pool->block_size;
+}
+
+static inline uint8_t block_free(pool_t* pool, uint8_t handle) {
+    return (pool->free_map[handle >> 3] >> (handle & 0x07)) & 0x01;
+}
+
+static inline void set_block_free(pool_t* pool, uint8_t handle, uint8_t free) {
+    if (free) {
+        pool->free_map[handle >> 3] |= (1 << (handle & 0x07));
+    } else {
+        pool->free_map[handle >> 3] &= ~(1 << (handle & 0x07));
+    }
+}
+
+/*
+Initializes a pool with all blocks free.
+pool - pool to initialize
+storage - POOL_STORAGE_SIZE(block_size, num_blocks) bytes (e.g. from
+    POOL_STORAGE())
+block_size - number of bytes per block (at least 1)
+num_blocks - number of blocks (at most POOL_MAX_BLOCKS)
+*/
+void init_pool(pool_t* pool, uint8_t* storage, uint8_t block_size,
+        uint8_t num_blocks) {
+    if (block_size == 0) {
+        num_blocks = 0;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pool->storage = storage;
+        pool->block_size = block_size;
+        pool->num_blocks = num_blocks;
+        pool->free_map = storage + (uint16_t) block_size * num_blocks;
+
+        // Link all blocks in order
+        for (uint8_t i = 0; i < num_blocks; i++) {
+            *block_ptr(pool, i) = (i + 1 < num_blocks) ? (i + 1) : POOL_NO_BLOCK;
+            set_block_free(pool, i, 1);
+        }
+        pool->free_head = (num_blocks > 0) ? 0 : POOL_NO_BLOCK;
+        pool->free_count = num_blocks;
+    }
+}
+
+/*
+Gets a free block. Its contents are undefined.
+Returns - handle of the block, or POOL_NO_BLOCK if all blocks are in use
+*/
+uint8_t alloc_pool_block(pool_t* pool) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t handle = pool->free_head;
+        if (handle == POOL_NO_BLOCK) {
+            return POOL_NO_BLOCK;
+        }
+        pool->free_head = *block_ptr(pool, handle);
+        pool->free_count--;
+        set_block_free(pool, handle, 0);
+        return handle;
+    }
+
+    return POOL_NO_BLOCK;
+}
+
+/*
+handle - handle from alloc_pool_block()
+Returns - pointer to the block, or NULL if the handle is invalid or the block is
+    free
+*/
+void* get_pool_block(pool_t* pool, uint8_t handle) {
+    if (handle >= pool->num_blocks || block_free(pool, handle)) {
+        return NULL;
+    }
+    return block_ptr(pool, handle);
+}
+
+/*
+Returns a block to the pool. It must not be used after this.
+handle - handle from alloc_pool_block()
+Returns - 1 if the block was freed, 0 if the handle is invalid or the block is
+    already free (nothing is changed)
+*/
+uint8_t free_pool_block(pool_t* pool, uint8_t handle) {
+    if (handle >= pool->num_blocks) {
+        return 0;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (block_free(pool, handle)) {
+            return 0;
+        }
+        set_block_free(pool, handle, 1);
+        *block_ptr(pool, handle) = pool->free_head;
+        pool->free_head = handle;
+        pool->free_count++;
+    }
+
+    return 1;
+}
+
+/*
+Returns - number of free blocks
+*/
+uint8_t pool_blocks_free(pool_t* pool) {
+    // Single byte, reading it is atomic
+    return *((volatile uint8_t*) &pool->free_count);
+}
@@ -0,0 +1,335 @@
+/*
+EEPROM-persistent queue
+
+An eeprom_queue_t works like a queue_t, but every element is also written to
+an EEPROM slot, so queued commands survive a reset (watchdog, heartbeat reset,
+reset_self_mcu()) and don't need to be sent again over the ground link.
+init_eeprom_queue() rebuilds the queue from the EEPROM after a reset.
+
+Reads (eeprom_peek_queue(), eeprom_queue_size()) only use the copy in RAM. Only
+changes write to the EEPROM:
+- Adding an element writes the sequence number, data and CRC of a free slot,
+  then sets its state to VALID. If a reset happens in between, the slot is not
+  valid and the element is lost (it was never added).
+- Removing an element sets its slot's state to DONE (1 byte). If a reset happens
+  before that, the element is restored (it will be processed again).
+All writes use eeprom_update_*, so bytes that don't change are not written.
+
+Wear levelling - new elements go in the next slot after the last one used, so
+the writes go around all num_slots slots instead of always using the same ones.
+The position continues after a reset (from the highest sequence number).
+
+Each slot has a CRC (CRC-16-CCITT) of its sequence number and data, and valid
+slots with a bad CRC are discarded when the queue is rebuilt.
+
+EEPROM writes take a few ms per byte, so these functions must only be called
+from the main loop (not interrupts).
+
+The slots must fit in the EEPROM and must not overlap the restart count and
+reason (uptime), the heartbeat statistics or the heartbeat reset log, otherwise
+init_eeprom_queue() returns EEPROM_QUEUE_INIT_ERROR and the queue rejects all
+elements.
+
+Slot layout (EEPROM_QUEUE_SLOT_SIZE bytes):
+- state (EEPROM_QUEUE_SLOT_*)
+- sequence number (order of the elements)
+- data (QUEUE_DATA_SIZE bytes)
+- CRC
+*/
+
+#include <util/crc16.h>
+
+#include <queue/eeprom_queue.h>
+
+_Static_assert(EEPROM_QUEUE_DEF_NUM_SLOTS > MAX_QUEUE_SIZE,
+    "EEPROM queue needs more slots than elements");
+_Static_assert(EEPROM_QUEUE_DEF_ADDR +
+    EEPROM_QUEUE_DEF_NUM_SLOTS * EEPROM_QUEUE_SLOT_SIZE <= E2END + 1,
+    "EEPROM queue does not fit in the EEPROM");
+
+// EEPROM address of a byte in a slot
+static inline uint16_t slot_addr(eeprom_queue_t* queue, uint8_t slot,
+        uint8_t offset) {
+    return queue->addr + (uint16_t) slot * EEPROM_QUEUE_SLOT_SIZE + offset;
+}
+
+// CRC of a sequence number and data
+static uint16_t slot_crc(uint16_t seq, const uint8_t* data) {
+    uint16_t crc = 0xFFFF;
+    crc = _crc_ccitt_update(crc, (uint8_t) (seq >> 8));
+    crc = _crc_ccitt_update(crc, (uint8_t) seq);
+    for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+        crc = _crc_ccitt_update(crc, data[i]);
+    }
+    return crc;
+}
+
+static void set_slot_state(eeprom_queue_t* queue, uint8_t slot, uint8_t state) {
+    eeprom_update_byte(
+        (uint8_t*) slot_addr(queue, slot, EEPROM_QUEUE_STATE_OFFSET), state);
+}
+
+// Writes an element to a slot and marks it as valid (last)
+static void write_slot(eeprom_queue_t* queue, uint8_t slot, uint16_t seq,
+        const uint8_t* data) {
+    eeprom_update_word(
+        (uint16_t*) slot_addr(queue, slot, EEPROM_QUEUE_SEQ_OFFSET), seq);
+    eeprom_update_block(data,
+        (void*) slot_addr(queue, slot, EEPROM_QUEUE_DATA_OFFSET),
+        QUEUE_DATA_SIZE);
+    eeprom_update_word(
+        (uint16_t*) slot_addr(queue, slot, EEPROM_QUEUE_CRC_OFFSET),
+        slot_crc(seq, data));
+    set_slot_state(queue, slot, EEPROM_QUEUE_SLOT_VALID);
+}
+
+// Returns 1 if a slot is used by an element in the queue
+static uint8_t slot_in_use(eeprom_queue_t* queue, uint8_t slot) {
+    uint8_t size = queue->queue.size;
+    for (uint8_t pos = 0; pos < size; pos++) {
+        uint8_t index = queue->queue.head + pos;
+        if (index >= MAX_QUEUE_SIZE) {
+            index -= MAX_QUEUE_SIZE;
+        }
+        if (queue->slots[index] == slot) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Finds a free slot, starting from next_slot
+// Returns - slot, or num_slots if there is no free slot (should not happen)
+static uint8_t find_free_slot(eeprom_queue_t* queue) {
+    uint8_t slot = queue->next_slot;
+    for (uint8_t i = 0; i < queue->num_slots; i++) {
+        if (!slot_in_use(queue, slot)) {
+            queue->next_slot = (slot + 1 < queue->num_slots) ? (slot + 1) : 0;
+            return slot;
+        }
+        slot = (slot + 1 < queue->num_slots) ? (slot + 1) : 0;
+    }
+    return queue->num_slots;
+}
+
+// Returns 1 if the EEPROM bytes [start, end) overlap [res_start, res_end)
+static uint8_t overlaps(uint32_t start, uint32_t end, uint32_t res_start,
+        uint32_t res_end) {
+    return start < res_end && res_start < end;
+}
+
+// Returns 1 if the slots fit in the EEPROM without overwriting other data
+static uint8_t valid_slots(uint16_t addr, uint8_t num_slots) {
+    uint32_t end = (uint32_t) addr +
+        (uint32_t) num_slots * EEPROM_QUEUE_SLOT_SIZE;
+
+    if (num_slots <= MAX_QUEUE_SIZE || end > (uint32_t) E2END + 1) {
+        return 0;
+    }
+    if (overlaps(addr, end, RESTART_COUNT_EEPROM_ADDR,
+            RESTART_COUNT_EEPROM_ADDR + RESTART_EEPROM_SIZE)) {
+        return 0;
+    }
+    if (overlaps(addr, end, HB_STATS_EEPROM_ADDR,
+            HB_STATS_EEPROM_ADDR + HB_STATS_EEPROM_SIZE)) {
+        return 0;
+    }
+    if (overlaps(addr, end, HB_RESET_LOG_EEPROM_ADDR,
+            HB_RESET_LOG_EEPROM_ADDR + HB_RESET_LOG_EEPROM_SIZE)) {
+        return 0;
+    }
+    return 1;
+}
+
+/*
+Initializes the queue from the EEPROM, restoring the elements that were in it
+before a reset (in the same order). This reads every slot once.
+queue - queue to initialize
+addr - EEPROM address of the first slot (e.g. EEPROM_QUEUE_DEF_ADDR), uses
+    num_slots * EEPROM_QUEUE_SLOT_SIZE bytes
+num_slots - number of slots (more than MAX_QUEUE_SIZE, at most 255, e.g.
+    EEPROM_QUEUE_DEF_NUM_SLOTS)
+Returns - number of elements restored, or EEPROM_QUEUE_INIT_ERROR if the slots
+    don't fit in the EEPROM or overlap other data (nothing is read or written,
+    and the queue rejects all elements)
+*/
+uint8_t init_eeprom_queue(eeprom_queue_t* queue, uint16_t addr,
+        uint8_t num_slots) {
+    init_queue(&queue->queue);
+    queue->addr = addr;
+    queue->num_slots = 0;
+    queue->next_slot = 0;
+    queue->next_seq = 0;
+
+    if (!valid_slots(addr, num_slots)) {
+        return EEPROM_QUEUE_INIT_ERROR;
+    }
+    queue->num_slots = num_slots;
+
+    // Valid elements found, sorted by sequence number (oldest first)
+    uint8_t found_slots[MAX_QUEUE_SIZE];
+    uint16_t found_seqs[MAX_QUEUE_SIZE];
+    uint8_t num_found = 0;
+    // Highest sequence number of any used slot
+    uint8_t used = 0;
+    uint16_t max_seq = 0;
+
+    for (uint8_t slot = 0; slot < num_slots; slot++) {
+        uint8_t state = eeprom_read_byte(
+            (const uint8_t*) slot_addr(queue, slot, EEPROM_QUEUE_STATE_OFFSET));
+        if (state == EEPROM_QUEUE_SLOT_ERASED) {
+            continue;
+        }
+
+        uint16_t seq = eeprom_read_word(
+            (const uint16_t*) slot_addr(queue, slot, EEPROM_QUEUE_SEQ_OFFSET));
+        if (!used || (int16_t) (seq - max_seq) > 0) {
+            max_seq = seq;
+            queue->next_slot = (slot + 1 < num_slots) ? (slot + 1) : 0;
+        }
+        used = 1;
+
+        if (state != EEPROM_QUEUE_SLOT_VALID) {
+            continue;
+        }
+
+        uint8_t data[QUEUE_DATA_SIZE];
+        eeprom_read_block(data,
+            (const void*) slot_addr(queue, slot, EEPROM_QUEUE_DATA_OFFSET),
+            QUEUE_DATA_SIZE);
+        uint16_t crc = eeprom_read_word(
+            (const uint16_t*) slot_addr(queue, slot, EEPROM_QUEUE_CRC_OFFSET));
+
+        // Discard corrupted elements, or extra elements if there are more than
+        // the queue can hold (should not happen)
+        if (crc != slot_crc(seq, data) || num_found == MAX_QUEUE_SIZE) {
+            set_slot_state(queue, slot, EEPROM_QUEUE_SLOT_DONE);
+            continue;
+        }
+
+        // Insert sorted (only up to MAX_QUEUE_SIZE elements)
+        uint8_t pos = num_found;
+        while (pos > 0 && (int16_t) (seq - found_seqs[pos - 1]) < 0) {
+            found_slots[pos] = found_slots[pos - 1];
+            found_seqs[pos] = found_seqs[pos - 1];
+            pos--;
+        }
+        found_slots[pos] = slot;
+        found_seqs[pos] = seq;
+        num_found++;
+    }
+
+    if (used) {
+        queue->next_seq = max_seq + 1;
+    }
+
+    // Rebuild the RAM queue
+    for (uint8_t i = 0; i < num_found; i++) {
+        uint8_t data[QUEUE_DATA_SIZE];
+        eeprom_read_block(data,
+            (const void*) slot_addr(queue, found_slots[i],
+                EEPROM_QUEUE_DATA_OFFSET),
+            QUEUE_DATA_SIZE);
+
+        uint8_t index = queue->queue.tail;
+        enqueue(&queue->queue, data);
+        queue->slots[index] = found_slots[i];
+        queue->seqs[index] = found_seqs[i];
+    }
+
+    return num_found;
+}
+
+/*
+Removes all elements (in RAM and EEPROM).
+*/
+void clear_eeprom_queue(eeprom_queue_t* queue) {
+    while (eeprom_dequeue(queue, NULL)) {}
+}
+
+/*
+Returns - the size of the queue (number of elements)
+*/
+uint8_t eeprom_queue_size(eeprom_queue_t* queue) {
+    return queue_size(&queue->queue);
+}
+
+/*
+Inserts new data at the end of the queue (and in the EEPROM).
+data - pointer to QUEUE_DATA_SIZE-byte array to insert (copy) into the queue
+Returns - 1 if data has been added to queue, 0 otherwise
+*/
+uint8_t eeprom_enqueue(eeprom_queue_t* queue, const uint8_t* data) {
+    if (queue_full(&queue->queue)) {
+        return 0;
+    }
+
+    uint8_t slot = find_free_slot(queue);
+    if (slot >= queue->num_slots) {
+        return 0;
+    }
+    uint16_t seq = queue->next_seq;
+    write_slot(queue, slot, seq, data);
+    queue->next_seq += 1;
+
+    uint8_t index = queue->queue.tail;
+    enqueue(&queue->queue, data);
+    queue->slots[index] = slot;
+    queue->seqs[index] = seq;
+    return 1;
+}
+
+/*
+Inserts new data at the front of the queue (and in the EEPROM).
+data - pointer to QUEUE_DATA_SIZE-byte array to insert (copy) into the queue
+Returns - 1 if data has been added to queue, 0 otherwise
+*/
+uint8_t eeprom_enqueue_front(eeprom_queue_t* queue, const uint8_t* data) {
+    if (queue_full(&queue->queue)) {
+        return 0;
+    }
+
+    if (queue_empty(&queue->queue)) {
+        return eeprom_enqueue(queue, data);
+    }
+
+    // Sequence number just before the first element
+    uint16_t seq = queue->seqs[queue->queue.head] - 1;
+
+    uint8_t slot = find_free_slot(queue);
+    if (slot >= queue->num_slots) {
+        return 0;
+    }
+    write_slot(queue, slot, seq, data);
+
+    enqueue_front(&queue->queue, data);
+    queue->slots[queue->queue.head] = slot;
+    queue->seqs[queue->queue.head] = seq;
+    return 1;
+}
+
+/*
+Gets the first element of the queue without removing it (RAM only).
+data - pointer to QUEUE_DATA_SIZE-byte array that this function will populate
+Returns - 1 if data is valid from queue, 0 otherwise
+*/
+uint8_t eeprom_peek_queue(eeprom_queue_t* queue, uint8_t* data) {
+    return peek_queue(&queue->queue, data);
+}
+
+/*
+Removes and returns the first element of the queue (and marks its EEPROM slot
+as done).
+data - pointer to QUEUE_DATA_SIZE-byte array that this function will populate
+    (can be NULL)
+Returns - 1 if data has been removed from queue, 0 otherwise
+*/
+uint8_t eeprom_dequeue(eeprom_queue_t* queue, uint8_t* data) {
+    uint8_t index = queue->queue.head;
+    if (!dequeue(&queue->queue, data)) {
+        return 0;
+    }
+
+    set_slot_state(queue, queue->slots[index], EEPROM_QUEUE_SLOT_DONE);
+    return 1;
+}
@@ -0,0 +1,194 @@
+/*
+A priority queue implementation which does not allocate heap memory.
+
+Elements come out in order of their key (lowest first), e.g. a priority level
+or a deadline (uptime). Elements with the same key come out in the order they
+were inserted, so equal-priority commands keep their FIFO order.
+
+The keys are kept in a binary min-heap, so inserting and removing take
+O(log n) steps. Only the small heap entries are moved around. The data of an
+element stays in the same slot of content until it is removed, and the freed
+slot is reused later.
+
+Like queue_t, every operation uses one atomic block so the queue can be shared
+with interrupts (e.g. an urgent reset command received in the CAN ISR).
+*/
+
+#include <queue/priority_queue.h>
+
+// Returns 1 if entry a should come out before entry b
+static uint8_t entry_before(const pq_entry_t* a, const pq_entry_t* b) {
+    if (a->key != b->key) {
+        return a->key < b->key;
+    }
+    return a->seq < b->seq;
+}
+
+static void swap_entries(pq_entry_t* a, pq_entry_t* b) {
+    pq_entry_t temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+// Copies the key and data of the top element (must not be empty)
+static void read_top(priority_queue_t* queue, uint32_t* key, uint8_t* data) {
+    if (key != NULL) {
+        *key = queue->heap[0].key;
+    }
+    if (data != NULL) {
+        uint8_t slot = queue->heap[0].slot;
+        for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+            data[i] = queue->content[slot][i];
+        }
+    }
+}
+
+/*
+Initializes an empty priority queue.
+*/
+void init_priority_queue(priority_queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        queue->size = 0;
+        queue->next_seq = 0;
+        for (uint8_t i = 0; i < MAX_PRIORITY_QUEUE_SIZE; i++) {
+            queue->free_slots[i] = i;
+        }
+    }
+}
+
+/*
+Returns - the number of elements in the queue
+*/
+uint8_t priority_queue_size(priority_queue_t* queue) {
+    // Single byte, reading it is atomic
+    return *((volatile uint8_t*) &queue->size);
+}
+
+/*
+Returns - 1 if the queue has reached maximum capacity, 0 otherwise
+*/
+uint8_t priority_queue_full(priority_queue_t* queue) {
+    return priority_queue_size(queue) == MAX_PRIORITY_QUEUE_SIZE;
+}
+
+/*
+Returns - 1 if there are no elements in the queue, 0 otherwise
+*/
+uint8_t priority_queue_empty(priority_queue_t* queue) {
+    return priority_queue_size(queue) == 0;
+}
+
+/*
+Inserts an element.
+queue - queue to insert into
+key - priority or deadline (lower keys come out first)
+data - pointer to QUEUE_DATA_SIZE-byte array to insert (copy) into the queue
+Returns - 1 if data has been added to queue, 0 otherwise
+*/
+uint8_t enqueue_priority(priority_queue_t* queue, uint32_t key,
+        const uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue->size == MAX_PRIORITY_QUEUE_SIZE) {
+            return 0;
+        }
+
+        uint8_t slot = queue->free_slots[MAX_PRIORITY_QUEUE_SIZE - queue->size - 1];
+        for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+            queue->content[slot][i] = data[i];
+        }
+
+        // Add at the bottom of the heap, then move up
+        uint8_t index = queue->size;
+        queue->heap[index].key = key;
+        queue->heap[index].seq = queue->next_seq;
+        queue->heap[index].slot = slot;
+        queue->next_seq += 1;
+        queue->size += 1;
+
+        while (index > 0) {
+            uint8_t parent = (index - 1) / 2;
+            if (!entry_before(&queue->heap[index], &queue->heap[parent])) {
+                break;
+            }
+            swap_entries(&queue->heap[index], &queue->heap[parent]);
+            index = parent;
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+Gets the element with the lowest key without removing it.
+queue - queue to peek an element from
+key - will be set to the element's key (can be NULL)
+data - pointer to QUEUE_DATA_SIZE-byte array that this function will populate
+    (can be NULL)
+Returns - 1 if data is valid from queue, 0 otherwise
+*/
+uint8_t peek_priority(priority_queue_t* queue, uint32_t* key, uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue->size == 0) {
+            return 0;
+        }
+
+        read_top(queue, key, data);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+Removes and returns the element with the lowest key (the oldest one if several
+have the lowest key).
+queue - queue to remove an element from
+key - will be set to the element's key (can be NULL)
+data - pointer to QUEUE_DATA_SIZE-byte array that this function will populate
+    (can be NULL)
+Returns - 1 if data has been removed from queue, 0 otherwise
+*/
+uint8_t dequeue_priority(priority_queue_t* queue, uint32_t* key, uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue->size == 0) {
+            return 0;
+        }
+
+        read_top(queue, key, data);
+
+        // Free the slot
+        queue->free_slots[MAX_PRIORITY_QUEUE_SIZE - queue->size] =
+            queue->heap[0].slot;
+        queue->size -= 1;
+
+        // Move the last entry to the top, then move down
+        queue->heap[0] = queue->heap[queue->size];
+        uint8_t index = 0;
+        while (1) {
+            uint8_t left = 2 * index + 1;
+            uint8_t right = left + 1;
+            uint8_t first = index;
+
+            if (left < queue->size &&
+                    entry_before(&queue->heap[left], &queue->heap[first])) {
+                first = left;
+            }
+            if (right < queue->size &&
+                    entry_before(&queue->heap[right], &queue->heap[first])) {
+                first = right;
+            }
+            if (first == index) {
+                break;
+            }
+
+            swap_entries(&queue->heap[index], &queue->heap[first]);
+            index = first;
+        }
+
+        return 1;
+    }
+
+    return 0;
+}
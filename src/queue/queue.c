@@ -19,6 +19,11 @@
     head/tail, making the dequeue command fail because it is referring to a
     different index in the array.
 
+    The elements are stored in a circular buffer (head and tail wrap around), so
+    every operation takes constant time and interrupts are only disabled for
+    the copy of one element. size is a single byte, so it can be read without
+    an atomic block.
+
     The compiler seems not to properly recognize return statements inside the
     atomic blocks. It gives the warning
     "control reaches end of non-void function [-Wreturn-type]". To silence this,
@@ -28,6 +33,37 @@
 
 #include <queue/queue.h>
 
+// Next index in the circular buffer
+#define QUEUE_NEXT(index) (((index) + 1 < MAX_QUEUE_SIZE) ? ((index) + 1) : 0)
+// Previous index in the circular buffer
+#define QUEUE_PREV(index) (((index) > 0) ? ((index) - 1) : (MAX_QUEUE_SIZE - 1))
+
+#ifdef QUEUE_STATS
+// Called (in an atomic block) when an element is inserted at index
+static void record_insert(queue_t* queue, uint8_t index) {
+    queue->stats.insert_time_s[index] = uptime_s;
+    queue->stats.total += 1;
+    if (queue->size > queue->stats.high_water) {
+        queue->stats.high_water = queue->size;
+    }
+}
+
+// Called (in an atomic block) when an insert is rejected
+static void record_reject(queue_t* queue) {
+    if (queue->stats.rejected < UINT16_MAX) {
+        queue->stats.rejected += 1;
+    }
+}
+
+// Called (in an atomic block) when the element at index is removed
+static void record_remove(queue_t* queue, uint8_t index) {
+    uint32_t wait_s = uptime_s - queue->stats.insert_time_s[index];
+    if (wait_s > queue->stats.max_wait_s) {
+        queue->stats.max_wait_s = wait_s;
+    }
+}
+#endif
+
 /*
 Initizing queue with 0x00 for a size of MAX_QUEUE_SIZE
 
@@ -37,12 +73,17 @@ void init_queue(queue_t* queue) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
         queue->head = 0;
         queue->tail = 0;
+        queue->size = 0;
         for (uint8_t i = 0; i < MAX_QUEUE_SIZE; i++) {
             for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
                 queue->content[i][j] = 0x00;
             }
         }
     }
+
+#ifdef QUEUE_STATS
+    reset_queue_stats(queue);
+#endif
 }
 
 /*
@@ -50,11 +91,8 @@ queue - queue to get the size of
 Returns - the size of the queue (number of 8-byte elements)
 */
 uint8_t queue_size(queue_t* queue) {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        return (queue->tail - queue->head);
-    }
-
-    return 0;
+    // Single byte, reading it is atomic
+    return *((volatile uint8_t*) &queue->size);
 }
 
 /*
@@ -64,11 +102,7 @@ Checks whether the queue is full
 @return 1 if the queue has reached maximum capacity, 0 otherwise
 */
 uint8_t queue_full(queue_t* queue) {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        return (queue_size(queue) == MAX_QUEUE_SIZE);
-    }
-
-    return 0;
+    return (queue_size(queue) == MAX_QUEUE_SIZE);
 }
 
 /*
@@ -78,47 +112,38 @@ Checks whether the queue is empty
 @return 1 if there are no elements in the queue, 0 otherwise
 */
 uint8_t queue_empty(queue_t* queue) {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        return (queue_size(queue) == 0);
-    }
-
-    return 0;
+    return (queue_size(queue) == 0);
 }
 
 /*
-Shifts all the elements in queue left (to start at index 0)
+Rotates the elements in the queue so the first element is at index 0. The queue
+operations do not need this anymore (the indices wrap around), it is only kept
+for existing callers. This takes time proportional to MAX_QUEUE_SIZE.
 
 @param queue_t* queue - queue to operate on
 */
 void shift_queue_left(queue_t* queue) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        for (uint8_t i = queue->head; i < queue->tail; i++) {
+        // Rotate left by one element head times
+        while (queue->head > 0) {
             for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
-                queue->content[i - queue->head][j] = queue->content[i][j];
-                queue->content[i][j] = 0x00;
+                uint8_t first = queue->content[0][j];
+                for (uint8_t i = 0; i < MAX_QUEUE_SIZE - 1; i++) {
+                    queue->content[i][j] = queue->content[i + 1][j];
+                }
+                queue->content[MAX_QUEUE_SIZE - 1][j] = first;
             }
-        }
-
-        queue->tail = (queue->tail) - (queue->head);
-        queue->head = 0;
-    }
-}
-
-/*
-Shifts all the elements in queue right one
-
-@param queue_t* queue - queue to operate on
-*/
-void shift_queue_right(queue_t* queue) {
-    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        for (uint8_t i = queue->tail; i > queue->head; i-=1) {
-            for (uint8_t j = 0; j < QUEUE_DATA_SIZE; j++) {
-                queue->content[i][j] = queue->content[i - 1][j];
-                queue->content[i - 1][j] = 0x00;
+#ifdef QUEUE_STATS
+            uint32_t first_time_s = queue->stats.insert_time_s[0];
+            for (uint8_t i = 0; i < MAX_QUEUE_SIZE - 1; i++) {
+                queue->stats.insert_time_s[i] = queue->stats.insert_time_s[i + 1];
             }
+            queue->stats.insert_time_s[MAX_QUEUE_SIZE - 1] = first_time_s;
+#endif
+            queue->head -= 1;
         }
-        queue->tail += 1;
-        queue->head += 1;
+
+        queue->tail = (queue->size < MAX_QUEUE_SIZE) ? queue->size : 0;
     }
 }
 
@@ -131,17 +156,22 @@ Inserts new data at the end of the queue
 */
 uint8_t enqueue(queue_t* queue, const uint8_t* data) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if (queue_full(queue)) {
+        if (queue->size == MAX_QUEUE_SIZE) {
+#ifdef QUEUE_STATS
+            record_reject(queue);
+#endif
             return 0;
         }
 
-        if (queue->tail == MAX_QUEUE_SIZE) {
-            shift_queue_left(queue);
-        }
+        uint8_t* slot = queue->content[queue->tail];
         for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
-            queue->content[queue->tail][i] = data[i];
+            slot[i] = data[i];
         }
-        queue->tail += 1;
+        queue->size += 1;
+#ifdef QUEUE_STATS
+        record_insert(queue, queue->tail);
+#endif
+        queue->tail = QUEUE_NEXT(queue->tail);
         return 1;
     }
 
@@ -157,17 +187,22 @@ Inserts new data at the front of the queue
 */
 uint8_t enqueue_front(queue_t* queue, const uint8_t* data) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if (queue_full(queue)) {
+        if (queue->size == MAX_QUEUE_SIZE) {
+#ifdef QUEUE_STATS
+            record_reject(queue);
+#endif
             return 0;
         }
 
-        if (queue->head == 0) {
-            shift_queue_right(queue);
-        }
-        queue->head -= 1;
+        queue->head = QUEUE_PREV(queue->head);
+        uint8_t* slot = queue->content[queue->head];
         for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
-            queue->content[queue->head][i] = data[i];
+            slot[i] = data[i];
         }
+        queue->size += 1;
+#ifdef QUEUE_STATS
+        record_insert(queue, queue->head);
+#endif
         return 1;
     }
 
@@ -183,13 +218,14 @@ Peeks (gets) the first element of the queue without removing it
 */
 uint8_t peek_queue(queue_t* queue, uint8_t* data) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if (queue_empty(queue)) {
+        if (queue->size == 0) {
             return 0;
         }
 
         if (data != NULL) {
+            const uint8_t* slot = queue->content[queue->head];
             for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
-                data[i] = queue->content[queue->head][i];
+                data[i] = slot[i];
             }
         }
 
@@ -208,21 +244,236 @@ Removes and returns the first element of the queue
 */
 uint8_t dequeue(queue_t* queue, uint8_t* data) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-        if (queue_empty(queue)) {
+        if (queue->size == 0) {
             return 0;
         }
 
-        // Get the element
-        peek_queue(queue, data);
+        if (data != NULL) {
+            const uint8_t* slot = queue->content[queue->head];
+            for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+                data[i] = slot[i];
+            }
+        }
 
-        // Remove the element
-        for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
-            queue->content[queue->head][i] = 0x00;
+#ifdef QUEUE_STATS
+        record_remove(queue, queue->head);
+#endif
+
+        // The slot is not cleared, it is overwritten by the next enqueue
+        queue->head = QUEUE_NEXT(queue->head);
+        queue->size -= 1;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+// Index in content of the element at a position (0 is the first element)
+static inline uint8_t queue_index(queue_t* queue, uint8_t pos) {
+    uint8_t index = queue->head + pos;
+    return (index < MAX_QUEUE_SIZE) ? index : (index - MAX_QUEUE_SIZE);
+}
+
+/*
+Inserts several elements at the end of the queue in one atomic block, either
+all of them or none of them (e.g. the frames of one multi-frame message).
+
+@param queue_t* queue - queue to insert into
+@param const uint8_t* data - count elements of QUEUE_DATA_SIZE bytes each, one
+    after the other
+@param uint8_t count - number of elements
+@return 1 if all the elements have been added to the queue, 0 otherwise
+*/
+uint8_t enqueue_n(queue_t* queue, const uint8_t* data, uint8_t count) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (count > MAX_QUEUE_SIZE - queue->size) {
+#ifdef QUEUE_STATS
+            for (uint8_t n = 0; n < count; n++) {
+                record_reject(queue);
+            }
+#endif
+            return 0;
+        }
+
+        for (uint8_t n = 0; n < count; n++) {
+            uint8_t* slot = queue->content[queue->tail];
+            for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+                slot[i] = data[i];
+            }
+            data += QUEUE_DATA_SIZE;
+            queue->size += 1;
+#ifdef QUEUE_STATS
+            record_insert(queue, queue->tail);
+#endif
+            queue->tail = QUEUE_NEXT(queue->tail);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+Removes up to count elements from the front of the queue in one atomic block
+(e.g. to drain a queue into a batch).
+
+@param queue_t* queue - queue to remove elements from
+@param uint8_t* data - array of count * QUEUE_DATA_SIZE bytes that this function
+    will populate (can be NULL to discard the elements)
+@param uint8_t count - maximum number of elements to remove
+@return number of elements removed
+*/
+uint8_t dequeue_n(queue_t* queue, uint8_t* data, uint8_t count) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (count > queue->size) {
+            count = queue->size;
+        }
+
+        for (uint8_t n = 0; n < count; n++) {
+            if (data != NULL) {
+                const uint8_t* slot = queue->content[queue->head];
+                for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+                    data[i] = slot[i];
+                }
+                data += QUEUE_DATA_SIZE;
+            }
+#ifdef QUEUE_STATS
+            record_remove(queue, queue->head);
+#endif
+            queue->head = QUEUE_NEXT(queue->head);
+        }
+        queue->size -= count;
+
+        return count;
+    }
+
+    return 0;
+}
+
+/*
+Gets an element of the queue without removing it
+
+@param queue_t* queue - queue to peek an element from
+@param uint8_t index - position of the element (0 is the first element, like
+    peek_queue())
+@param uint8_t* data - pointer to 8-byte array that this function will populate
+@return 1 if data is valid from queue, 0 otherwise
+*/
+uint8_t peek_queue_at(queue_t* queue, uint8_t index, uint8_t* data) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (index >= queue->size) {
+            return 0;
+        }
+
+        if (data != NULL) {
+            const uint8_t* slot = queue->content[queue_index(queue, index)];
+            for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+                data[i] = slot[i];
+            }
         }
-        queue->head += 1;
 
         return 1;
     }
 
     return 0;
 }
+
+/*
+Starts walking the elements of a queue, from first to last, without copying
+them. The queue must not be modified while walking it (e.g. walk it in an atomic
+block if interrupts also use the queue).
+
+@param queue_iter_t* iter - iterator to initialize
+@param queue_t* queue - queue to walk
+*/
+void init_queue_iter(queue_iter_t* iter, queue_t* queue) {
+    iter->queue = queue;
+    iter->pos = 0;
+}
+
+/*
+Gets the next element when walking a queue.
+
+@param queue_iter_t* iter - iterator from init_queue_iter()
+@return pointer to the element (QUEUE_DATA_SIZE bytes) inside the queue, or NULL
+    if there are no more elements
+*/
+const uint8_t* next_queue_iter(queue_iter_t* iter) {
+    queue_t* queue = iter->queue;
+    if (iter->pos >= queue->size) {
+        return NULL;
+    }
+
+    const uint8_t* data = queue->content[queue_index(queue, iter->pos)];
+    iter->pos += 1;
+    return data;
+}
+
+/*
+Removes all the elements for which a function returns 1 (e.g. to cancel queued
+commands), keeping the order of the other elements. This takes one atomic block
+for the whole queue.
+
+@param queue_t* queue - queue to remove elements from
+@param queue_pred_t pred - called with each element (and arg), returns 1 to
+    remove the element (called inside the atomic block, so keep it short)
+@param void* arg - passed to pred
+@return number of elements removed
+*/
+uint8_t remove_queue_if(queue_t* queue, queue_pred_t pred, void* arg) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t kept = 0;
+
+        for (uint8_t pos = 0; pos < queue->size; pos++) {
+            uint8_t src = queue_index(queue, pos);
+            if (pred(queue->content[src], arg)) {
+                continue;
+            }
+
+            // Move the element back over the removed ones
+            uint8_t dst = queue_index(queue, kept);
+            if (dst != src) {
+                for (uint8_t i = 0; i < QUEUE_DATA_SIZE; i++) {
+                    queue->content[dst][i] = queue->content[src][i];
+                }
+#ifdef QUEUE_STATS
+                queue->stats.insert_time_s[dst] = queue->stats.insert_time_s[src];
+#endif
+            }
+            kept++;
+        }
+
+        uint8_t removed = queue->size - kept;
+        queue->size = kept;
+        queue->tail = queue_index(queue, kept);
+        return removed;
+    }
+
+    return 0;
+}
+
+#ifdef QUEUE_STATS
+/*
+Gets a copy of a queue's statistics.
+queue - queue to get the statistics of
+stats - will be populated with the statistics
+*/
+void get_queue_stats(queue_t* queue, queue_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = queue->stats;
+    }
+}
+
+/*
+Clears a queue's statistics (the elements in the queue keep their insert time).
+*/
+void reset_queue_stats(queue_t* queue) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        queue->stats.high_water = queue->size;
+        queue->stats.rejected = 0;
+        queue->stats.total = 0;
+        queue->stats.max_wait_s = 0;
+    }
+}
+#endif
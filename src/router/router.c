@@ -0,0 +1,231 @@
+/*
+Frame router
+
+Forwards frames (e.g. commands from the ground station over the UART
+transceiver) between ports such as CAN TX MObs, UART channels and local
+handlers. The application provides a routing table that maps a destination
+node and message type to an output port:
+
+router_port_t ports[] = {
+    ROUTER_PORT(send_to_eps_mob, 2),
+    ROUTER_PORT(send_to_pay_mob, 2),
+    ROUTER_PORT(send_to_uart, 4),
+    ROUTER_PORT(handle_locally, 1),
+};
+router_route_t routes[] = {
+    ROUTER_ROUTE(NODE_EPS, ROUTER_ANY, 0),
+    ROUTER_ROUTE(NODE_PAY, ROUTER_ANY, 1),
+    ROUTER_ROUTE(NODE_GROUND, ROUTER_ANY, 2),
+    ROUTER_ROUTE(ROUTER_ANY, ROUTER_ANY, 3),
+};
+
+Frames live in a static pool of buffers (from the pool library) and are passed
+around by handle, so a frame is only copied when it is received (or written
+directly into a buffer with alloc_router_buf()) and when it is sent. Each port
+has a FIFO of handles with a depth limit so one slow link can't use up all the
+buffers; frames past the limit are dropped and counted.
+
+route_frame() and route_router_buf() can be called from interrupts (e.g. RX
+callbacks). run_router() should be called from the main loop to send waiting
+frames whenever the ports are free.
+*/
+
+#include <router/router.h>
+
+// Frame buffers
+static POOL_STORAGE(router_bufs, sizeof(router_frame_t), ROUTER_NUM_BUFS);
+static pool_t router_pool;
+
+static router_route_t* router_routes = NULL;
+static uint8_t router_num_routes = 0;
+static router_port_t* router_ports = NULL;
+static uint8_t router_num_ports = 0;
+
+static inline void inc_counter(uint16_t* counter) {
+    if (*counter < UINT16_MAX) {
+        (*counter)++;
+    }
+}
+
+/*
+Initializes the router. All buffers are freed and all counters are cleared.
+routes - routing table (in RAM since it holds counters)
+num_routes - number of routes
+ports - output ports
+num_ports - number of ports
+*/
+void init_router(router_route_t* routes, uint8_t num_routes,
+        router_port_t* ports, uint8_t num_ports) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        router_routes = routes;
+        router_num_routes = num_routes;
+        router_ports = ports;
+        router_num_ports = num_ports;
+
+        init_pool(&router_pool, router_bufs, sizeof(router_frame_t),
+            ROUTER_NUM_BUFS);
+
+        for (uint8_t i = 0; i < num_routes; i++) {
+            routes[i].count = 0;
+            routes[i].dropped = 0;
+        }
+        for (uint8_t i = 0; i < num_ports; i++) {
+            ports[i].head = 0;
+            ports[i].depth = 0;
+            ports[i].sent = 0;
+            ports[i].dropped = 0;
+        }
+    }
+}
+
+/*
+Gets a free frame buffer.
+Returns - handle of the buffer, or ROUTER_NO_BUF if all buffers are in use
+*/
+uint8_t alloc_router_buf(void) {
+    return alloc_pool_block(&router_pool);
+}
+
+/*
+handle - handle from alloc_router_buf()
+Returns - pointer to the frame buffer, or NULL if the handle is invalid
+*/
+router_frame_t* get_router_buf(uint8_t handle) {
+    return get_pool_block(&router_pool, handle);
+}
+
+/*
+Releases a frame buffer that was not routed.
+*/
+void free_router_buf(uint8_t handle) {
+    free_pool_block(&router_pool, handle);
+}
+
+/*
+Returns - number of free frame buffers
+*/
+uint8_t router_bufs_free(void) {
+    return pool_blocks_free(&router_pool);
+}
+
+// Returns the first route matching a destination and message type, or NULL
+static router_route_t* find_route(uint8_t dest, uint8_t msg_type) {
+    for (uint8_t i = 0; i < router_num_routes; i++) {
+        router_route_t* route = &router_routes[i];
+        if ((route->dest == ROUTER_ANY || route->dest == dest) &&
+                (route->msg_type == ROUTER_ANY || route->msg_type == msg_type)) {
+            return route;
+        }
+    }
+    return NULL;
+}
+
+/*
+Routes a frame buffer to its output port. The router takes ownership of the
+buffer (it is freed once the frame is sent, or right away if it is dropped).
+handle - handle from alloc_router_buf(), with the frame filled in
+dest - destination node
+Returns - 1 if the frame was queued, 0 if it was dropped (no route or the
+    port's queue is full)
+*/
+uint8_t route_router_buf(uint8_t handle, uint8_t dest) {
+    router_frame_t* frame = get_router_buf(handle);
+    if (frame == NULL) {
+        return 0;
+    }
+
+    uint8_t queued = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t msg_type = (frame->len > 0) ? frame->data[0] : ROUTER_ANY;
+        router_route_t* route = find_route(dest, msg_type);
+
+        if (route != NULL && route->port < router_num_ports) {
+            router_port_t* port = &router_ports[route->port];
+            uint8_t max_depth = port->max_depth;
+            if (max_depth > ROUTER_PORT_QUEUE_SIZE) {
+                max_depth = ROUTER_PORT_QUEUE_SIZE;
+            }
+
+            if (port->depth < max_depth) {
+                uint8_t tail = (port->head + port->depth) % ROUTER_PORT_QUEUE_SIZE;
+                port->queue[tail] = handle;
+                port->depth++;
+                inc_counter(&route->count);
+                queued = 1;
+            } else {
+                inc_counter(&route->dropped);
+                inc_counter(&port->dropped);
+            }
+        }
+    }
+
+    if (!queued) {
+        free_router_buf(handle);
+    }
+    return queued;
+}
+
+/*
+Copies a received frame into a buffer and routes it.
+dest - destination node
+data - frame (byte 0 is the message type)
+len - number of bytes in the frame (at most ROUTER_FRAME_LEN)
+Returns - 1 if the frame was queued, 0 if it was dropped
+*/
+uint8_t route_frame(uint8_t dest, const uint8_t* data, uint8_t len) {
+    if (len > ROUTER_FRAME_LEN) {
+        return 0;
+    }
+
+    uint8_t handle = alloc_router_buf();
+    if (handle == ROUTER_NO_BUF) {
+        return 0;
+    }
+
+    router_frame_t* frame = get_router_buf(handle);
+    memcpy(frame->data, data, len);
+    frame->len = len;
+    return route_router_buf(handle, dest);
+}
+
+/*
+Sends waiting frames on all ports until each port is empty or busy. Should be
+called from the main loop.
+Returns - number of frames sent
+*/
+uint8_t run_router(void) {
+    uint8_t sent = 0;
+
+    for (uint8_t i = 0; i < router_num_ports; i++) {
+        router_port_t* port = &router_ports[i];
+
+        while (1) {
+            uint8_t handle = ROUTER_NO_BUF;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (port->depth > 0) {
+                    handle = port->queue[port->head];
+                }
+            }
+            if (handle == ROUTER_NO_BUF) {
+                break;
+            }
+
+            // Only the main loop removes frames, so the head can't change
+            // while the port is sending
+            router_frame_t* frame = get_router_buf(handle);
+            if (!port->out(frame->data, frame->len)) {
+                break;
+            }
+
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                port->head = (port->head + 1) % ROUTER_PORT_QUEUE_SIZE;
+                port->depth--;
+                inc_counter(&port->sent);
+            }
+            free_router_buf(handle);
+            sent++;
+        }
+    }
+
+    return sent;
+}
@@ -0,0 +1,330 @@
+/*
+Cooperative scheduler
+
+Runs the main loop services (heartbeat, UART/CAN processing, log flushing,
+sensor polling) as run-to-completion tasks, so the timing of each one no longer
+depends on how long all the others take in a hand-written while (1) loop.
+
+Each task has:
+- a period (it is released every period_ms), and/or
+- event flags, set from interrupts with set_sched_event() (it is released when
+  any flag is set), and
+- a deadline (it should finish within deadline_ms of being released)
+
+run_sched() runs the released task with the earliest deadline, one at a time.
+Tasks are never interrupted by other tasks (only by interrupts), so they don't
+need locks between them, but a long task delays all the others. If no task is
+released, the CPU sleeps (idle mode) until the next interrupt. A one-shot
+wheel timer is set for the next periodic release to wake it up, so it doesn't
+wake up every millisecond. The clock and the wheel use the 16-bit timer, so
+start_timer_16bit() can't be used with the scheduler.
+
+For each task, the scheduler keeps the number of runs, the number of overruns
+(runs that finished after the deadline or started more than a period late, each
+run is counted at most once) and the worst case execution time (from micros()),
+see get_sched_stats().
+
+Usage:
+    void flush_log_task(void) {
+        flush_log_records();
+    }
+
+    init_sched();
+    add_sched_task(run_hb, 100, 100);
+    add_sched_task(flush_log_task, 1000, 1000);
+    uint8_t uart_task = add_sched_task(run_uart_rx, 0, 10);
+    // in the UART RX callback (interrupt): set_sched_event(uart_task, 1);
+    while (1) {
+        run_sched();
+    }
+
+The com timeout is not a task. It stays on its own wheel timer (in the timer
+interrupt) so it can still reset the MCU if the main loop hangs.
+*/
+
+#include <scheduler/scheduler.h>
+
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_num_tasks = 0;
+// 1 if any task has events (so run_sched() doesn't go to sleep)
+static volatile uint8_t sched_events_pending = 0;
+// Events of the task that is running (see get_sched_events())
+static uint8_t sched_running_events = 0;
+
+// Time source for releases and deadlines (NULL to use millis())
+static sched_time_fn_t sched_time_fn = NULL;
+
+// Wakes up the CPU for the next periodic release
+static wheel_timer_t sched_wake_timer;
+
+
+static uint32_t sched_time_ms(void) {
+    if (sched_time_fn != NULL) {
+        return sched_time_fn();
+    }
+    return millis();
+}
+
+// Called from the wheel's interrupt at the next periodic release
+static void sched_wake_cb(void) {
+    // Don't go to sleep if this runs just before run_sched() does
+    sched_events_pending = 1;
+}
+
+/*
+Removes all tasks and starts the clock.
+*/
+void init_sched(void) {
+    init_clock();
+    stop_wheel_timer(&sched_wake_timer);
+    init_wheel_timer(&sched_wake_timer, sched_wake_cb, 0);
+    sched_num_tasks = 0;
+    sched_events_pending = 0;
+    sched_running_events = 0;
+}
+
+/*
+Sets the function used to get the time for releases and deadlines.
+fn - returns the current time in milliseconds, or NULL to use millis()
+*/
+void set_sched_time_fn(sched_time_fn_t fn) {
+    sched_time_fn = fn;
+}
+
+/*
+Adds a task.
+fn - function to run
+period_ms - time between runs (the first run is one period after this call), or
+    0 to only run on events
+deadline_ms - time allowed from release to the end of the run, or 0 to use the
+    period (required for a task that only runs on events)
+Returns - task ID (for set_sched_event() and get_sched_stats()), or
+    SCHED_NO_TASK if there is no space left, fn is NULL or the task has neither
+    a period nor a deadline
+*/
+uint8_t add_sched_task(sched_task_fn_t fn, uint32_t period_ms,
+        uint32_t deadline_ms) {
+    if (sched_num_tasks >= SCHED_MAX_TASKS || fn == NULL) {
+        return SCHED_NO_TASK;
+    }
+    // An event task with a deadline of 0 would count almost every run as an
+    // overrun
+    if (period_ms == 0 && deadline_ms == 0) {
+        return SCHED_NO_TASK;
+    }
+
+    uint8_t id = sched_num_tasks;
+    sched_task_t* task = &sched_tasks[id];
+    task->fn = fn;
+    task->period_ms = period_ms;
+    task->deadline_ms = (deadline_ms > 0) ? deadline_ms : period_ms;
+    task->next_ms = sched_time_ms() + period_ms;
+    task->event_ms = 0;
+    task->events = 0;
+    task->stats.runs = 0;
+    task->stats.overruns = 0;
+    task->stats.max_exec_us = 0;
+
+    sched_num_tasks += 1;
+    return id;
+}
+
+/*
+Sets event flags for a task, which releases it. Can be called from interrupts.
+id - task ID
+events - flags to set (any bits, the task can read them with
+    get_sched_events())
+*/
+void set_sched_event(uint8_t id, uint8_t events) {
+    if (id >= sched_num_tasks || events == 0) {
+        return;
+    }
+
+    sched_task_t* task = &sched_tasks[id];
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (task->events == 0) {
+            task->event_ms = sched_time_ms();
+        }
+        task->events |= events;
+        sched_events_pending = 1;
+    }
+}
+
+/*
+Returns - the event flags that released the running task (0 if it was only
+    released by its period)
+*/
+uint8_t get_sched_events(void) {
+    return sched_running_events;
+}
+
+/*
+Finds the released task with the earliest deadline.
+now - current time
+deadline - set to the deadline of the task
+Returns - task ID, or SCHED_NO_TASK if no task is released
+*/
+static uint8_t next_sched_task(uint32_t now, uint32_t* deadline) {
+    uint8_t best = SCHED_NO_TASK;
+    uint8_t events_left = 0;
+
+    for (uint8_t i = 0; i < sched_num_tasks; i++) {
+        sched_task_t* task = &sched_tasks[i];
+
+        uint8_t released = 0;
+        uint32_t release = 0;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (task->events != 0) {
+                released = 1;
+                release = task->event_ms;
+                events_left = 1;
+            }
+        }
+        if (task->period_ms > 0 && CLOCK_AFTER_EQ(now, task->next_ms)) {
+            // Use the earlier release if it has both
+            if (!released || CLOCK_AFTER(release, task->next_ms)) {
+                release = task->next_ms;
+            }
+            released = 1;
+        }
+
+        if (released) {
+            uint32_t task_deadline = release + task->deadline_ms;
+            if (best == SCHED_NO_TASK ||
+                    CLOCK_AFTER(*deadline, task_deadline)) {
+                best = i;
+                *deadline = task_deadline;
+            }
+        }
+    }
+
+    if (!events_left) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            // Only clear it if no interrupt set an event since the loop
+            uint8_t any = 0;
+            for (uint8_t i = 0; i < sched_num_tasks; i++) {
+                any |= sched_tasks[i].events;
+            }
+            sched_events_pending = (any != 0);
+        }
+    }
+
+    return best;
+}
+
+/*
+Sets the wake up timer for the earliest periodic release (if there are any
+periodic tasks).
+now - current time
+*/
+static void set_sched_wake(uint32_t now) {
+    uint8_t found = 0;
+    uint32_t next = 0;
+    for (uint8_t i = 0; i < sched_num_tasks; i++) {
+        sched_task_t* task = &sched_tasks[i];
+        if (task->period_ms > 0 &&
+                (!found || CLOCK_AFTER(next, task->next_ms))) {
+            next = task->next_ms;
+            found = 1;
+        }
+    }
+
+    if (found) {
+        start_wheel_timer(&sched_wake_timer, next - now, 0);
+    }
+}
+
+/*
+Runs the released task with the earliest deadline, or sleeps until the next
+interrupt if no task is released. This should be called in the main loop.
+Returns - 1 if a task was run, 0 if the CPU slept
+*/
+uint8_t run_sched(void) {
+    uint32_t now = sched_time_ms();
+    uint32_t deadline = 0;
+    uint8_t id = next_sched_task(now, &deadline);
+
+    if (id == SCHED_NO_TASK) {
+        // Sleep until an interrupt (e.g. the wake up timer or an event),
+        // unless an interrupt set an event since it was checked
+        set_sched_wake(now);
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        cli();
+        if (!sched_events_pending) {
+            sleep_enable();
+            // The instruction after sei() always runs before an interrupt, so
+            // an interrupt here can't be missed before sleeping
+            sei();
+            sleep_cpu();
+            sleep_disable();
+        }
+        sei();
+        return 0;
+    }
+
+    sched_task_t* task = &sched_tasks[id];
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sched_running_events = task->events;
+        task->events = 0;
+    }
+
+    // 1 if this run is late (counted as one overrun, even if it both started
+    // a period late and finished after its deadline)
+    uint8_t late = 0;
+    if (task->period_ms > 0 && CLOCK_AFTER_EQ(now, task->next_ms)) {
+        task->next_ms += task->period_ms;
+        if (CLOCK_AFTER_EQ(now, task->next_ms)) {
+            // Started more than a period late, skip the missed releases
+            // instead of running several times in a row
+            uint32_t missed = (now - task->next_ms) / task->period_ms + 1;
+            task->next_ms += missed * task->period_ms;
+            late = 1;
+        }
+    }
+
+    uint32_t start_us = micros();
+    (task->fn)();
+    uint32_t exec_us = micros() - start_us;
+    sched_running_events = 0;
+
+    if (task->stats.runs < 0xFFFF) {
+        task->stats.runs += 1;
+    }
+    if (exec_us > task->stats.max_exec_us) {
+        task->stats.max_exec_us = exec_us;
+    }
+    if (CLOCK_AFTER(sched_time_ms(), deadline)) {
+        late = 1;
+    }
+    if (late && task->stats.overruns < 0xFFFF) {
+        task->stats.overruns += 1;
+    }
+
+    return 1;
+}
+
+/*
+Gets the statistics of a task.
+id - task ID
+stats - set to the statistics
+Returns - 1 if the task exists, 0 otherwise
+*/
+uint8_t get_sched_stats(uint8_t id, sched_stats_t* stats) {
+    if (id >= sched_num_tasks) {
+        return 0;
+    }
+    *stats = sched_tasks[id].stats;
+    return 1;
+}
+
+/*
+Resets the statistics of all tasks.
+*/
+void reset_sched_stats(void) {
+    for (uint8_t i = 0; i < sched_num_tasks; i++) {
+        sched_tasks[i].stats.runs = 0;
+        sched_tasks[i].stats.overruns = 0;
+        sched_tasks[i].stats.max_exec_us = 0;
+    }
+}
@@ -26,6 +26,10 @@ void init_stack(stack_t* stack) {
             stack->content[i][j] = 0x00;
         }
     }
+
+#ifdef STACK_STATS
+    reset_stack_stats(stack);
+#endif
 }
 
 /*
@@ -58,6 +62,11 @@ Adds element to stack if possible.
 uint8_t push_stack(stack_t* stack, const uint8_t* data) {
     // checks if stack is full, and return 0 if true
     if (stack_full(stack)) {
+#ifdef STACK_STATS
+        if (stack->stats.rejected < UINT16_MAX) {
+            stack->stats.rejected += 1;
+        }
+#endif
         return 0;
     }
     // adds integer pointed to by data to the stack, and returns 1
@@ -67,6 +76,12 @@ uint8_t push_stack(stack_t* stack, const uint8_t* data) {
             (stack->content)[index][i] = data[i];
         }
         stack->index += 1;
+#ifdef STACK_STATS
+        stack->stats.total += 1;
+        if (stack->index > stack->stats.high_water) {
+            stack->stats.high_water = stack->index;
+        }
+#endif
         return 1;
     }
 }
@@ -117,3 +132,27 @@ uint8_t pop_stack(stack_t* stack, uint8_t* data) {
 
     return 1;
 }
+
+#ifdef STACK_STATS
+/*
+Gets a copy of a stack's statistics.
+stack - stack to get the statistics of
+stats - will be populated with the statistics
+*/
+void get_stack_stats(stack_t* stack, stack_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = stack->stats;
+    }
+}
+
+/*
+Clears a stack's statistics.
+*/
+void reset_stack_stats(stack_t* stack) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        stack->stats.high_water = stack->index;
+        stack->stats.rejected = 0;
+        stack->stats.total = 0;
+    }
+}
+#endif
@@ -0,0 +1,98 @@
+/*
+Monotonic clock
+
+millis() and micros() give the time since init_clock(), for timing things
+shorter than a second (SPI transactions, CAN latency, handler execution times).
+They use the timer wheel's hardware timer (the 16-bit timer): wheel_periods
+counts the 500 ms periods of the counter in software and TCNT1 counts within
+the current period. The counter doesn't interrupt every millisecond, so the
+clock costs 2 interrupts per second.
+
+millis() has a resolution of 1 ms and micros() a resolution of 8 us (1 count of
+TCNT1 with a prescaler of 64 at 8 MHz). A 1 us count would need a prescaler of
+8, and then the counter would clear every 8 ms (125 interrupts per second
+instead of 2). Anything that needs finer timing should count cycles or use the
+8-bit timer directly.
+
+The clock, the timer wheel, the scheduler and uptime all use the 16-bit timer
+(Timer 1), so start_timer_16bit() and start_timer_16bit_ms() can't be used with
+any of them. The 8-bit timer (Timer 0) is free for start_timer_8bit().
+
+millis() wraps after 49.7 days and micros() after 71.6 minutes. Compare times
+with differences or CLOCK_AFTER() (not with < or >) so the wrap doesn't matter:
+    uint32_t start = micros();
+    ...
+    uint32_t elapsed_us = micros() - start;
+*/
+
+#include <timer/clock.h>
+
+// Microseconds per count of TCNT1
+#define CLOCK_US_PER_COUNT  (1000 / TIMER_WHEEL_COUNTS_PER_MS)
+
+_Static_assert(CLOCK_US_PER_COUNT * TIMER_WHEEL_COUNTS_PER_MS == 1000,
+    "Clock needs a whole number of microseconds per count");
+
+
+/*
+Reads the number of periods and the count within the current period together.
+periods - set to the number of periods since init_clock()
+counts - set to TCNT1
+*/
+static void read_clock(uint32_t* periods, uint16_t* counts) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *periods = wheel_periods;
+        *counts = TCNT1;
+        // If the counter cleared after the last capture interrupt but
+        // interrupts are disabled (here or in the caller), the interrupt is
+        // pending and wheel_periods is 1 behind. A small count means it cleared
+        // before it was read (a large count means it cleared just after).
+        if ((TIFR1 & _BV(ICF1)) && *counts < TIMER_WHEEL_PERIOD_COUNTS / 2) {
+            *periods += 1;
+        }
+    }
+}
+
+/*
+Starts the clock (the timer wheel). Does nothing if it is already running.
+*/
+void init_clock(void) {
+    init_timer_wheel();
+}
+
+/*
+Returns - 1 if the clock is running (init_clock() or init_timer_wheel() was
+    called), 0 otherwise
+*/
+uint8_t clock_running(void) {
+    return timer_wheel_started();
+}
+
+/*
+Returns - milliseconds since init_clock()
+*/
+uint32_t millis(void) {
+    uint32_t periods;
+    uint16_t counts;
+    read_clock(&periods, &counts);
+    return periods * TIMER_WHEEL_PERIOD_MS + counts / TIMER_WHEEL_COUNTS_PER_MS;
+}
+
+/*
+Returns - microseconds since init_clock()
+*/
+uint32_t micros(void) {
+    uint32_t periods;
+    uint16_t counts;
+    read_clock(&periods, &counts);
+    return periods * (TIMER_WHEEL_PERIOD_MS * 1000UL) +
+        (uint32_t) counts * CLOCK_US_PER_COUNT;
+}
+
+/*
+Returns - the lower 16 bits of micros() (for short durations up to 65 ms, e.g.
+    as the time source for set_ctrl_time_fn())
+*/
+uint16_t micros_16bit(void) {
+    return (uint16_t) micros();
+}
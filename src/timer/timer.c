@@ -5,11 +5,19 @@ Authors: Shimi Smith, Matthew Silverman, Ambrose Man
 This contains two timers that each run a given function repeatedly at some
 interval. Runs an 8-bit (Timer 0) and 16-bit (Timer 1) timer.
 
+The 16-bit timer is taken by the timer wheel (and the clock, scheduler and
+uptime, which use it) once any of them is started. The 8-bit timer is left free.
+
 Datasheet: https://ww1.microchip.com/downloads/en/DeviceDoc/Atmel-8209-8-bit%20AVR%20ATmega16M1-32M1-64M1_Datasheet.pdf
 
 For 8-bit timer, to compensate for the differences in 16-bit timer,
-I use a 16-bit int to store the number of interrupts required. timer_16bit cannot
-handle more than 35 minutes (which is the same as timer_8bit).
+I use a 16-bit int to store the number of interrupts required, so timer_8bit
+cannot handle more than 35 minutes.
+
+Periods are converted to a prescaler, compare value and number of interrupts
+with integer math only. The smallest prescaler that reaches the period in one
+interrupt is used, so short periods (e.g. 1 ms) get the finest resolution and
+the fewest interrupts.
 
 Here's a good website to get an idea of timers in microcontrollers:
 https://www.newbiehack.com/TimersandCountersDefaultandBasicUsage.aspx
@@ -23,36 +31,89 @@ void timer_fn_nop(void) {}
 timer_t timer16 = {
     .max_time_ints = 0,
     .remainder_time = 0,
+    .clock_sel = 0,
     .cmd = timer_fn_nop,
     .int_count = 0
 };
 timer_t timer8 = {
     .max_time_ints = 0,
     .remainder_time = 0,
+    .clock_sel = 0,
     .cmd = timer_fn_nop,
     .int_count = 0
 };
 
+// log2 of each prescaler (1, 8, 64, 256, 1024), in order of their clock select
+// bits (CSn2:0 = 1 to 5), which are the same for both timers
+static const uint8_t prescaler_shifts[] = { 0, 3, 6, 8, 10 };
+#define NUM_PRESCALERS sizeof(prescaler_shifts)
+
 /*
-Starts the 16-bit timer to call a function repeatedly at some time interval.
-seconds - number of seconds between function calls
-cmd - function to call
+Converts a time to timer counts with integer math (rounded to the nearest
+count). The prescaler is a power of two, so this only needs a multiplication by
+a constant and shifts.
 */
-void start_timer_16bit(uint16_t seconds, timer_fn_t cmd) {
-    // delay in ms
-    uint32_t delay = seconds * 1000L;
-    //number of interrupts
-    timer16.max_time_ints = delay / MAX_TIME_16BIT;
-    uint32_t remaining_delay = delay - (timer16.max_time_ints * MAX_TIME_16BIT);
-    //remaining counter value
-    timer16.remainder_time = (remaining_delay / PERIOD) + ROUND;
-
-    //command to run
-    timer16.cmd = cmd;
+static uint32_t ms_to_counts(uint32_t ms, uint8_t shift) {
+    uint32_t low = ms & ((1UL << shift) - 1);
+    return (ms >> shift) * TIMER_COUNTS_PER_MS +
+        ((low * TIMER_COUNTS_PER_MS + ((1UL << shift) >> 1)) >> shift);
+}
 
+/*
+Sets up the prescaler, number of interrupts and compare values for a period.
+This uses the smallest prescaler that reaches the period in one interrupt, so
+the timer has the finest resolution. If no prescaler does, the period is split
+into full interrupts and a remainder with the largest prescaler.
+timer - timer to set up
+ms - period in milliseconds
+full_counts - counts in a full period of the timer (TIMER_8BIT_COUNTS or
+    TIMER_16BIT_COUNTS)
+*/
+static void calc_timer(timer_t* timer, uint32_t ms, uint32_t full_counts) {
+    if (ms > TIMER_MAX_MS) {
+        ms = TIMER_MAX_MS;
+    }
+
+    uint8_t i = 0;
+    uint32_t counts = 0;
+    for (i = 0; i < NUM_PRESCALERS - 1; i++) {
+        // Checked first so the multiplication in ms_to_counts() can't overflow
+        if ((ms >> prescaler_shifts[i]) > full_counts / TIMER_COUNTS_PER_MS) {
+            continue;
+        }
+        counts = ms_to_counts(ms, prescaler_shifts[i]);
+        if (counts <= full_counts) {
+            break;
+        }
+    }
+    if (i == NUM_PRESCALERS - 1) {
+        counts = ms_to_counts(ms, prescaler_shifts[i]);
+    }
+    if (counts == 0) {
+        counts = 1;
+    }
+
+    // Full interrupts before the last one, which has 1 to full_counts counts
+    uint32_t ints = (counts - 1) / full_counts;
+    uint32_t remainder = counts - (ints * full_counts);
+    if (ints > 0xFFFF) {
+        ints = 0xFFFF;
+        remainder = full_counts;
+    }
+
+    timer->clock_sel = i + 1;
+    timer->max_time_ints = ints;
+    // The counter clears on the compare match, so the period is OCRnA + 1
+    timer->remainder_time = remainder - 1;
+}
+
+// Starts the 16-bit timer in CTC mode with the values in timer16
+static void setup_timer_16bit(void) {
     // Update timer registers atomically so we don't accidentally trigger an
     // interrupt
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        timer16.int_count = 0;
+
         // Clear any pending interrupt flags (if we started and stopped the
         // timer before) (p. 182)
         TIFR1 |= _BV(OCF1A);
@@ -62,9 +123,9 @@ void start_timer_16bit(uint16_t seconds, timer_fn_t cmd) {
         TCCR1B |= _BV(WGM12);
         TCCR1B &= ~_BV(WGM13);
 
-        // set timer to use internal clock with prescaler of 1024
-        TCCR1B |= _BV(CS12) | _BV(CS10);
-        TCCR1B &= ~_BV(CS11);
+        // set timer to use internal clock with the prescaler
+        TCCR1B &= ~(_BV(CS12) | _BV(CS11) | _BV(CS10));
+        TCCR1B |= timer16.clock_sel << CS10;
 
         // disable use of output compare pins so that they can be used normally
         TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0));
@@ -87,26 +148,13 @@ void start_timer_16bit(uint16_t seconds, timer_fn_t cmd) {
     sei();
 }
 
-/*
-Starts the 8-bit timer to call a function repeatedly at some time interval.
-seconds - number of seconds between function calls
-cmd - function to call
-*/
-void start_timer_8bit(uint16_t seconds, timer_fn_t cmd) {
-    // delay in ms
-    uint32_t delay = seconds * 1000L;
-    // number of interrupts
-    timer8.max_time_ints = delay / MAX_TIME_8BIT;
-    uint32_t remaining_delay = delay - (timer8.max_time_ints * MAX_TIME_8BIT);
-    //remaining counter value
-    timer8.remainder_time = (remaining_delay / PERIOD) + ROUND;
-
-    //command to run
-    timer8.cmd = cmd;
-
+// Starts the 8-bit timer in CTC mode with the values in timer8
+static void setup_timer_8bit(void) {
     // Update timer registers atomically so we don't accidentally trigger an
     // interrupt
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        timer8.int_count = 0;
+
         // Clear any pending interrupt flags (if we started and stopped the
         // timer before) (p. 149)
         TIFR0 |= _BV(OCF0A);
@@ -116,9 +164,9 @@ void start_timer_8bit(uint16_t seconds, timer_fn_t cmd) {
         TCCR0A |= _BV(WGM01);
         TCCR0B &= ~_BV(WGM02);
 
-        // set timer to use internal clock with prescaler of 1024
-        TCCR0B |= _BV(CS02) | _BV(CS00);
-        TCCR0B &= ~_BV(CS01);
+        // set timer to use internal clock with the prescaler
+        TCCR0B &= ~(_BV(CS02) | _BV(CS01) | _BV(CS00));
+        TCCR0B |= timer8.clock_sel << CS00;
 
         // disable use of output compare pins so that they can be used as normal pins
         TCCR0A &= ~(_BV(COM0A1) | _BV(COM0A0) | _BV(COM0B1) | _BV(COM0B0));
@@ -141,6 +189,50 @@ void start_timer_8bit(uint16_t seconds, timer_fn_t cmd) {
     sei();
 }
 
+/*
+Starts the 16-bit timer to call a function repeatedly at some time interval.
+seconds - number of seconds between function calls
+cmd - function to call
+*/
+void start_timer_16bit(uint16_t seconds, timer_fn_t cmd) {
+    start_timer_16bit_ms(seconds * 1000UL, cmd);
+}
+
+/*
+Starts the 16-bit timer to call a function repeatedly at some time interval.
+ms - number of milliseconds between function calls (up to TIMER_MAX_MS)
+cmd - function to call
+*/
+void start_timer_16bit_ms(uint32_t ms, timer_fn_t cmd) {
+    // stop the timer so the ISR doesn't run with half-updated values
+    stop_timer_16bit();
+    calc_timer(&timer16, ms, TIMER_16BIT_COUNTS);
+    timer16.cmd = cmd;
+    setup_timer_16bit();
+}
+
+/*
+Starts the 8-bit timer to call a function repeatedly at some time interval.
+seconds - number of seconds between function calls
+cmd - function to call
+*/
+void start_timer_8bit(uint16_t seconds, timer_fn_t cmd) {
+    start_timer_8bit_ms(seconds * 1000UL, cmd);
+}
+
+/*
+Starts the 8-bit timer to call a function repeatedly at some time interval.
+ms - number of milliseconds between function calls (up to 35 minutes)
+cmd - function to call
+*/
+void start_timer_8bit_ms(uint32_t ms, timer_fn_t cmd) {
+    // stop the timer so the ISR doesn't run with half-updated values
+    stop_timer_8bit();
+    calc_timer(&timer8, ms, TIMER_8BIT_COUNTS);
+    timer8.cmd = cmd;
+    setup_timer_8bit();
+}
+
 /*
 Stops the 16-bit timer so it will stop calling the command function.
 */
@@ -161,8 +253,9 @@ void stop_timer_8bit(void) {
 // This ISR occurs when TCNT1 is equal to OCR1A for a 16-bit timer
 // Timer 1 compare match A handler
 ISR(TIMER1_COMPA_vect) {
+    // CTC mode already cleared TCNT1 on the compare match (clearing it again
+    // here would lose the counts since the match and make short periods drift)
     timer16.int_count += 1; //counting number of interrupts
-    TCNT1 = 0;
 
     if (timer16.max_time_ints == 0) {
         timer16.int_count = 0;
@@ -185,8 +278,8 @@ ISR(TIMER1_COMPA_vect) {
 // This ISR occurs when TCNT0 is equal to OCR0A for a 8-bit timer
 // Timer 0 compare match A handler
 ISR(TIMER0_COMPA_vect) {
+    // CTC mode already cleared TCNT0 on the compare match
     timer8.int_count += 1; //counting number of interrupts
-    TCNT0 = 0;
 
     if (timer8.max_time_ints == 0) {
         timer8.int_count = 0;
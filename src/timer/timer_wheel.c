@@ -0,0 +1,464 @@
+/*
+Timer wheel
+
+Runs any number of software timers from a single hardware timer (the 16-bit
+timer, with a 1 ms tick). Each timer can be one-shot or periodic, and its
+callback can run in the timer interrupt (default) or be deferred to
+run_timer_wheel() in the main loop (WHEEL_TIMER_DEFERRED).
+
+This is a hierarchical timer wheel (like the one in the Linux kernel). Level 0
+has one slot per tick, and each slot of level k covers a full turn of level
+k - 1. A timer is linked into the slot of the lowest level that reaches its
+expiry time. When a level turns over, the next slot of the level above it is
+emptied and its timers are moved down (cascaded). This makes starting,
+stopping and expiring a timer take constant time, no matter how many timers
+are running.
+
+The wheel is tickless: the hardware timer doesn't interrupt every tick.
+Compare channel B is set to the next tick when a timer expires, and that
+interrupt processes all the ticks up to millis() at once (cascading the slots
+on the way and skipping the ticks with nothing to do). The counter itself
+interrupts every TIMER_WHEEL_PERIOD_MS so the clock can count past 16 bits,
+i.e. the wheel takes 2 interrupts per second plus one per tick when timers
+expire.
+
+Usage:
+    wheel_timer_t poll_timer;
+
+    init_timer_wheel();
+    init_wheel_timer(&poll_timer, poll_sensors, WHEEL_TIMER_DEFERRED);
+    start_wheel_timer(&poll_timer, 100, 100); // every 100 ms
+    while (1) {
+        run_timer_wheel();
+    }
+
+The wheel_timer_t structs must stay in memory while they are running (use
+global or static variables). Timers can be started and stopped from the main
+loop or from callbacks.
+
+The 16-bit timer can't be used with start_timer_16bit() or
+start_timer_16bit_ms() while the wheel is running. The 8-bit timer is not used.
+*/
+
+#include <timer/timer_wheel.h>
+#include <timer/clock.h>
+#include <queue/spsc_ring.h>
+
+_Static_assert(TIMER_WHEEL_PERIOD_COUNTS <= 0x10000UL,
+    "Timer wheel period is too long for the 16-bit timer");
+
+// Slots of each level (heads of the lists of timers)
+static wheel_timer_t* wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_NUM_SLOTS];
+
+// Callbacks waiting for run_timer_wheel()
+// (the typedef keeps the ring's const element pointers valid)
+typedef wheel_timer_t* wheel_timer_ptr_t;
+DECLARE_SPSC_RING(wheel_deferred_ring, wheel_timer_ptr_t,
+    TIMER_WHEEL_DEFERRED_SIZE)
+
+// Tick the wheel has been processed up to
+volatile uint32_t wheel_ms = 0;
+volatile uint32_t wheel_periods = 0;
+volatile uint16_t wheel_deferred_dropped = 0;
+
+// 1 if init_timer_wheel() has started the hardware timer
+static uint8_t wheel_started = 0;
+// Next tick with anything to do (if wheel_armed is 1), set by arm_wheel()
+static uint8_t wheel_armed = 0;
+static uint32_t wheel_next_ms = 0;
+// 1 while advance_timer_wheel() is processing ticks
+static uint8_t wheel_advancing = 0;
+
+
+static void link_timer(wheel_timer_t** head, wheel_timer_t* timer) {
+    timer->next = *head;
+    if (timer->next != NULL) {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void unlink_timer(wheel_timer_t* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+// Links a timer into the slot for its expiry time (interrupts must be disabled)
+static void add_timer(wheel_timer_t* timer) {
+    uint32_t expires = timer->expires;
+    uint32_t delta = expires - wheel_ms;
+    if ((int32_t) delta < 0) {
+        // Already late, run it as soon as possible
+        expires = wheel_ms;
+        delta = 0;
+    }
+
+    uint8_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+            delta >= (1UL << ((level + 1) * TIMER_WHEEL_SLOT_BITS))) {
+        level++;
+    }
+    if (level == TIMER_WHEEL_LEVELS - 1 &&
+            delta >= (1UL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS))) {
+        // Too far for the wheel, put it in the last slot it reaches and move
+        // it again when that slot is cascaded
+        expires = wheel_ms +
+            (1UL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1;
+    }
+
+    uint8_t slot = (expires >> (level * TIMER_WHEEL_SLOT_BITS)) &
+        TIMER_WHEEL_SLOT_MASK;
+    link_timer(&wheel[level][slot], timer);
+}
+
+// Moves all timers in the current slot of a level to lower levels
+static void cascade(uint8_t level) {
+    uint8_t slot = (wheel_ms >> (level * TIMER_WHEEL_SLOT_BITS)) &
+        TIMER_WHEEL_SLOT_MASK;
+
+    wheel_timer_t* timer = wheel[level][slot];
+    wheel[level][slot] = NULL;
+    while (timer != NULL) {
+        wheel_timer_t* next = timer->next;
+        add_timer(timer);
+        timer = next;
+    }
+}
+
+/*
+Finds the next tick (after wheel_ms) with anything to do. Interrupts must be
+disabled.
+next - set to the tick
+expiry - 1 for the next tick when a timer expires, 0 for the next tick when
+    a timer expires or a slot of a higher level is cascaded
+Returns - 1 if there is one, 0 if no timers are running
+*/
+static uint8_t next_wheel_event(uint32_t* next, uint8_t expiry) {
+    uint8_t found = 0;
+
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        // The slots of a level are processed on multiples of 2^shift ticks
+        uint8_t shift = level * TIMER_WHEEL_SLOT_BITS;
+        uint32_t tick = (wheel_ms >> shift) << shift;
+
+        for (uint8_t i = 0; i < TIMER_WHEEL_NUM_SLOTS; i++) {
+            tick += 1UL << shift;
+            // The timers in a slot expire on or after it is processed
+            if (found && CLOCK_AFTER_EQ(tick, *next)) {
+                break;
+            }
+
+            wheel_timer_t* timer =
+                wheel[level][(tick >> shift) & TIMER_WHEEL_SLOT_MASK];
+            if (timer == NULL) {
+                continue;
+            }
+            if (level == 0 || !expiry) {
+                *next = tick;
+                found = 1;
+                break;
+            }
+
+            // Earliest expiry in the slot (the later slots of this level
+            // expire after all of them)
+            for (; timer != NULL; timer = timer->next) {
+                if (!found || CLOCK_AFTER(*next, timer->expires)) {
+                    *next = timer->expires;
+                    found = 1;
+                }
+            }
+            break;
+        }
+    }
+
+    return found;
+}
+
+/*
+Sets compare channel B to wheel_next_ms if it is in the current period of the
+counter (otherwise the capture interrupt sets it at the start of each period).
+Interrupts must be disabled.
+*/
+static void set_wheel_compare(void) {
+    uint32_t offset_ms = wheel_next_ms - wheel_periods * TIMER_WHEEL_PERIOD_MS;
+    if (!wheel_armed || (int32_t) offset_ms >= TIMER_WHEEL_PERIOD_MS) {
+        TIMSK1 &= ~_BV(OCIE1B);
+        return;
+    }
+
+    uint16_t counts = 0;
+    if ((int32_t) offset_ms > 0) {
+        counts = offset_ms * TIMER_WHEEL_COUNTS_PER_MS;
+    }
+    // A count that already passed would only match in the next period, so
+    // match a couple of counts from now instead (it is late)
+    uint16_t min_counts = TCNT1 + 2;
+    if (counts < min_counts) {
+        counts = min_counts;
+    }
+
+    OCR1B = counts;
+    // Only clear this flag (|= would also clear a pending capture flag)
+    TIFR1 = _BV(OCF1B);
+    TIMSK1 |= _BV(OCIE1B);
+}
+
+/*
+Sets the hardware timer to interrupt on the next tick when a timer expires (the
+slots that need to be cascaded before then are cascaded by that interrupt).
+Interrupts must be disabled.
+*/
+static void arm_wheel(void) {
+    if (!wheel_started) {
+        return;
+    }
+    wheel_armed = next_wheel_event(&wheel_next_ms, 1);
+    set_wheel_compare();
+}
+
+/*
+Returns - the current tick, millis() once the hardware timer is started or
+    wheel_ms before (e.g. for tests that call advance_timer_wheel() directly)
+*/
+static uint32_t wheel_now(void) {
+    if (wheel_started) {
+        return millis();
+    }
+    return wheel_ms;
+}
+
+/*
+Starts the hardware timer for the wheel (the 16-bit timer, in CTC mode with
+ICR1 as the top and a prescaler of 64 at 8 MHz). Does nothing if the wheel is
+already running, so libraries that use the wheel can all call it.
+*/
+void init_timer_wheel(void) {
+    if (wheel_started) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        wheel_started = 1;
+        // The clock continues from wheel_ms (0 unless advance_timer_wheel()
+        // was called before, e.g. by tests)
+        wheel_periods = wheel_ms / TIMER_WHEEL_PERIOD_MS;
+
+        // stop the timer and disable the interrupts of start_timer_16bit()
+        TCCR1B &= ~(_BV(CS12) | _BV(CS11) | _BV(CS10));
+        TIMSK1 &= ~(_BV(OCIE1A) | _BV(OCIE1B) | _BV(TOIE1));
+
+        // set timer to CTC mode - using ICR1 (p. 182)
+        TCCR1A &= ~(_BV(WGM10) | _BV(WGM11));
+        TCCR1B |= _BV(WGM12) | _BV(WGM13);
+
+        // disable use of output compare pins so that they can be used normally
+        TCCR1A &= ~(_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0));
+
+        ICR1 = TIMER_WHEEL_PERIOD_COUNTS - 1;
+        TCNT1 = (wheel_ms % TIMER_WHEEL_PERIOD_MS) * TIMER_WHEEL_COUNTS_PER_MS;
+
+        // Clear any pending interrupt flags and count the periods
+        TIFR1 = _BV(ICF1) | _BV(OCF1A) | _BV(OCF1B);
+        TIMSK1 |= _BV(ICIE1);
+
+        // set timer to use internal clock with a prescaler of 64
+        TCCR1B |= _BV(CS11) | _BV(CS10);
+
+        // Timers may have been started before the hardware timer
+        arm_wheel();
+    }
+
+    // enable global interrupts
+    sei();
+}
+
+/*
+Returns - 1 if init_timer_wheel() has started the wheel, 0 otherwise
+*/
+uint8_t timer_wheel_started(void) {
+    return wheel_started;
+}
+
+// Advances the wheel by one tick and calls (or defers) the callbacks of the
+// timers that expire
+static void wheel_tick(void) {
+    wheel_ms += 1;
+
+    // Cascade the levels that turned over
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if ((wheel_ms >> ((level - 1) * TIMER_WHEEL_SLOT_BITS)) &
+                TIMER_WHEEL_SLOT_MASK) {
+            break;
+        }
+        cascade(level);
+    }
+
+    // Move the expired timers to a separate list, so callbacks can start and
+    // stop timers (including the ones in this list) while it is processed
+    wheel_timer_t* expired = NULL;
+    wheel_timer_t** slot = &wheel[0][wheel_ms & TIMER_WHEEL_SLOT_MASK];
+    if (*slot != NULL) {
+        expired = *slot;
+        expired->pprev = &expired;
+        *slot = NULL;
+    }
+
+    while (expired != NULL) {
+        wheel_timer_t* timer = expired;
+        unlink_timer(timer);
+
+        if (timer->period_ms > 0) {
+            timer->expires += timer->period_ms;
+            add_timer(timer);
+        }
+
+        if (timer->flags & WHEEL_TIMER_DEFERRED) {
+            // Only queue it once, even if it expires again before
+            // run_timer_wheel() is called
+            if (!(timer->flags & WHEEL_TIMER_QUEUED)) {
+                if (wheel_deferred_ring_push(&timer)) {
+                    timer->flags |= WHEEL_TIMER_QUEUED;
+                } else {
+                    wheel_deferred_dropped += 1;
+                }
+            }
+        } else {
+            (timer->cb)();
+        }
+    }
+}
+
+/*
+Processes the ticks of the wheel up to a time, calling (or deferring) the
+callbacks of the timers that expire, in order. Ticks with nothing to do are
+skipped. This is called from the timer interrupt (interrupts must be disabled).
+now_ms - tick to advance to (millis())
+*/
+void advance_timer_wheel(uint32_t now_ms) {
+    uint32_t next = 0;
+    wheel_advancing = 1;
+    while (CLOCK_AFTER(now_ms, wheel_ms)) {
+        if (!next_wheel_event(&next, 0) || CLOCK_AFTER(next, now_ms)) {
+            wheel_ms = now_ms;
+            break;
+        }
+        wheel_ms = next - 1;
+        wheel_tick();
+    }
+    wheel_advancing = 0;
+}
+
+/*
+Calls the callbacks of deferred timers (WHEEL_TIMER_DEFERRED) that have expired.
+This should be run in the main loop.
+*/
+void run_timer_wheel(void) {
+    wheel_timer_t* timer = NULL;
+    while (wheel_deferred_ring_pop(&timer)) {
+        uint8_t queued = 0;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            queued = timer->flags & WHEEL_TIMER_QUEUED;
+            timer->flags &= ~WHEEL_TIMER_QUEUED;
+        }
+
+        // Skip timers that were stopped after they expired
+        if (queued) {
+            (timer->cb)();
+        }
+    }
+}
+
+/*
+Sets up a timer (before it is started, not while it is running).
+timer - timer to set up
+cb - function to call when the timer expires
+flags - WHEEL_TIMER_DEFERRED to call cb from run_timer_wheel(), 0 to call it
+    from the timer interrupt
+*/
+void init_wheel_timer(wheel_timer_t* timer, timer_fn_t cb, uint8_t flags) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->period_ms = 0;
+    timer->cb = cb;
+    timer->flags = flags & ~WHEEL_TIMER_QUEUED;
+}
+
+/*
+Starts (or restarts) a timer.
+timer - timer set up with init_wheel_timer()
+delay_ms - time until the first callback (at least 1 ms)
+period_ms - time between the following callbacks, 0 for a one-shot timer
+*/
+void start_wheel_timer(wheel_timer_t* timer, uint32_t delay_ms,
+        uint32_t period_ms) {
+    if (delay_ms == 0) {
+        delay_ms = 1;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (timer->pprev != NULL) {
+            unlink_timer(timer);
+        }
+
+        uint32_t now = wheel_now();
+        // Bring the wheel up to now if no timer expires before then (this only
+        // cascades), so the timer goes in the lowest level it can (not from a
+        // callback, the ticks before now are still being processed)
+        if (!wheel_advancing &&
+                (!wheel_armed || CLOCK_AFTER(wheel_next_ms, now))) {
+            advance_timer_wheel(now);
+        }
+
+        timer->expires = now + delay_ms;
+        timer->period_ms = period_ms;
+        add_timer(timer);
+        arm_wheel();
+    }
+}
+
+/*
+Stops a timer. Its callback will not be called again (including a deferred
+callback that is waiting for run_timer_wheel()). The hardware timer is not set
+again, so it may still interrupt once with nothing to do.
+*/
+void stop_wheel_timer(wheel_timer_t* timer) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (timer->pprev != NULL) {
+            unlink_timer(timer);
+        }
+        timer->flags &= ~WHEEL_TIMER_QUEUED;
+    }
+}
+
+/*
+Returns - 1 if the timer is running (will expire), 0 otherwise
+*/
+uint8_t wheel_timer_running(wheel_timer_t* timer) {
+    uint8_t running = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        running = (timer->pprev != NULL);
+    }
+    return running;
+}
+
+
+// This ISR occurs when TCNT1 is equal to ICR1 (the counter clears)
+// Timer 1 capture handler
+ISR(TIMER1_CAPT_vect) {
+    wheel_periods += 1;
+    set_wheel_compare();
+}
+
+// This ISR occurs when TCNT1 is equal to OCR1B (the next tick when a timer
+// expires)
+// Timer 1 compare match B handler
+ISR(TIMER1_COMPB_vect) {
+    advance_timer_wheel(millis());
+    arm_wheel();
+}
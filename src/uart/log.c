@@ -1,13 +1,30 @@
 /*
 UART library logging
 Functions for using variable arguments and format specifiers to print messages.
+
+print() formats and sends the message right away, which is too slow for an
+interrupt. Interrupts can use log_record() instead, which only stores a code and
+a value in a single-producer/single-consumer ring (without disabling
+interrupts). flush_log_records() prints them later from the main loop.
 */
 
 #include <uart/uart.h>
+#include <queue/spsc_ring.h>
+
+// Log record from log_record()
+typedef struct {
+    uint8_t code;
+    uint32_t value;
+} log_record_t;
 
 // Character buffer for formatted print messages
 uint8_t print_buf[PRINT_BUF_SIZE];
 
+// Log records waiting to be printed
+DECLARE_SPSC_RING(log_ring, log_record_t, LOG_RING_SIZE)
+// Number of log records dropped because the ring was full (producer only)
+volatile uint16_t log_records_dropped = 0;
+
 /*
 Prints a message by sending UART.
 Uses same format specifiers as the standard C printf() function
@@ -57,3 +74,51 @@ void print_bytes(uint8_t* data, uint16_t len) {
 uint8_t* get_print_buf(void) {
     return print_buf;
 }
+
+/*
+Stores a log record to be printed later by flush_log_records(). This never
+disables interrupts or waits, so it can be used in an ISR.
+Only one context may call this: either interrupts (which don't nest) or the main
+loop, but not both.
+code - identifies the event (meaning is up to the caller)
+value - data for the event
+Returns - 1 if stored, 0 if the ring was full (the record is dropped)
+*/
+uint8_t log_record(uint8_t code, uint32_t value) {
+    log_record_t* record = log_ring_alloc();
+    if (record == NULL) {
+        log_records_dropped += 1;
+        return 0;
+    }
+
+    record->code = code;
+    record->value = value;
+    log_ring_commit();
+    return 1;
+}
+
+/*
+Prints all stored log records, in the format "LOG <code>: <value>".
+This should be run in the main loop.
+Returns - number of records printed
+*/
+uint8_t flush_log_records(void) {
+    uint8_t count = 0;
+    log_record_t record;
+    while (log_ring_pop(&record)) {
+        print("LOG %u: %lu\n", record.code, record.value);
+        count++;
+    }
+    return count;
+}
+
+/*
+Returns - number of log records dropped because the ring was full
+*/
+uint16_t get_log_records_dropped(void) {
+    uint16_t dropped;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        dropped = log_records_dropped;
+    }
+    return dropped;
+}
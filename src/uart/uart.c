@@ -6,14 +6,28 @@ UART (TX and RX) library.
 UART is a protocol that allows devices to send data to each
 other one byte at a time (usually represented as one character in a
 user-friendly terminal).
+
+Received characters are pushed by the RX interrupt into a single-producer/
+single-consumer ring (uart_rx_ring), which never disables interrupts. The
+consumer moves them into the RX buffer and calls the RX callback. By default the
+consumer also runs in the interrupt, right after each character. Call
+set_uart_rx_deferred(1) to run it from the main loop instead (with
+run_uart_rx()), so the interrupt only stores the character and long callbacks
+don't delay other interrupts.
 */
 
 #include <uart/uart.h>
+#include <queue/spsc_ring.h>
 #include <string.h>
 
 // Maximum number of characters the UART RX buffer can store
 #define UART_MAX_RX_BUF_SIZE 50
 
+// Characters received by the ISR that have not been processed yet
+DECLARE_SPSC_RING(uart_rx_ring, uint8_t, UART_RX_RING_SIZE)
+// 1 if the RX callback is called from run_uart_rx() instead of the ISR
+volatile uint8_t uart_rx_deferred = 0;
+
 // Buffer of received characters
 volatile uint8_t uart_rx_buf[UART_MAX_RX_BUF_SIZE];
 // Number of valid characters in buffer (starting at index 0)
@@ -54,6 +68,7 @@ void init_uart(void) {
     clear_uart_rx_buf();
     // Set default (no operation) RX callback
     uart_rx_cb = _uart_rx_cb_nop;
+    uart_rx_deferred = 0;
 
     // globally enable interrupts
     sei();
@@ -187,9 +202,11 @@ uint8_t* get_uart_rx_buf(void) {
 
 /*
 Clears the RX buffer (sets all values in the array to 0, sets counter to 0).
+Also drops received characters that have not been processed yet.
 */
 void clear_uart_rx_buf(void) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uart_rx_ring_clear();
         uart_rx_buf_count = 0;
         for (uint8_t i = 0; i < UART_MAX_RX_BUF_SIZE; i++) {
             uart_rx_buf[i] = 0;
@@ -197,14 +214,24 @@ void clear_uart_rx_buf(void) {
     }
 }
 
-// Interrupt handler that will be called when we receive a character over UART
-ISR(LIN_TC_vect) {
-    // Check if we got the interrupt for a received character (p. 293)
-    if (LINSIR & _BV(LRXOK)) {
-        // Fetch the new recieved character
-        static uint8_t c;
-        get_uart_char(&c);
+/*
+Sets where the RX callback is called from.
+deferred - 0 to call it from the RX interrupt (default), 1 to call it from
+    run_uart_rx() in the main loop
+*/
+void set_uart_rx_deferred(uint8_t deferred) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uart_rx_deferred = deferred;
+    }
+}
 
+/*
+Consumer side of uart_rx_ring: adds each received character to the RX buffer and
+calls the RX callback.
+*/
+static void process_uart_rx(void) {
+    uint8_t c;
+    while (uart_rx_ring_pop(&c)) {
         // Add the new character to the RX buffer (if it won't overflow)
         if (uart_rx_buf_count < sizeof(uart_rx_buf) / sizeof(uart_rx_buf[0])) {
             uart_rx_buf[uart_rx_buf_count] = c;
@@ -213,9 +240,9 @@ ISR(LIN_TC_vect) {
 
         /*
         Call the RX callback function to process the character buffer
-        It's fine to cast the buffer pointer to non-volatile, because we are in
-        an interrupt handler so the callback function can't be interrupted
-        (i.e. the contents of uart_rx_buf can't change)
+        It's fine to cast the buffer pointer to non-volatile, because only the
+        consumer (this function) modifies uart_rx_buf, so its contents can't
+        change while the callback runs
         */
         uint8_t read_bytes = uart_rx_cb(
             (const uint8_t*) uart_rx_buf, uart_rx_buf_count);
@@ -232,9 +259,36 @@ ISR(LIN_TC_vect) {
             }
         }
 
-        // If the buffer is full, clear it
+        // If the buffer is full, clear it (but keep the characters still in
+        // the ring)
         if (uart_rx_buf_count >= UART_MAX_RX_BUF_SIZE) {
-            clear_uart_rx_buf();
+            uart_rx_buf_count = 0;
+        }
+    }
+}
+
+/*
+Processes received characters (calls the RX callback) if set_uart_rx_deferred(1)
+was called. This should be run in the main loop.
+*/
+void run_uart_rx(void) {
+    if (uart_rx_deferred) {
+        process_uart_rx();
+    }
+}
+
+// Interrupt handler that will be called when we receive a character over UART
+ISR(LIN_TC_vect) {
+    // Check if we got the interrupt for a received character (p. 293)
+    if (LINSIR & _BV(LRXOK)) {
+        // Fetch the new recieved character
+        uint8_t c;
+        get_uart_char(&c);
+
+        // Hand it to the consumer (dropped if the ring is full)
+        uart_rx_ring_push(&c);
+        if (!uart_rx_deferred) {
+            process_uart_rx();
         }
 
         // Clear RX interrupt bit (p. 293)
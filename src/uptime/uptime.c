@@ -1,13 +1,19 @@
 /*
 Functionality to track a global uptime (in seconds since last restart) across
-the microcontroller (MCU) using the 8-bit timer. Also tracks the number of times
+the microcontroller (MCU) using the timer wheel. Also tracks the number of times
 the MCU has restarted using EEPROM.
 
 This library basically multiplexes a set of timer callbacks onto a single timer
-(the 8-bit timer). You can add multiple callbacks, which will all be called
+(a wheel timer). You can add multiple callbacks, which will all be called
 at the same time (in order) every second. They can read the `uptime_s` variable
 to decide what to do.
 
+The communication timeout has its own wheel timer, so it keeps working even if
+the uptime callbacks stop. Both run in the wheel's interrupt (on the 16-bit
+timer), so neither depends on the main loop, but unlike separate hardware
+timers they would both stop if the wheel's timer stopped. The 8-bit timer is
+left free for other uses.
+
 This library also has the capability for the microcontroller to reset itself if
 it wants to. It uses EEPROM to keep track of the reason for the most recent reset.
 */
@@ -32,9 +38,13 @@ volatile uint32_t uptime_s = 0;
 void uptime_fn_nop(void) {}
 // Array of timer callbacks for uptime timer callback
 uptime_fn_t uptime_callbacks[UPTIME_NUM_CALLBACKS] = {uptime_fn_nop};
+// Calls uptime_timer_cb() every second
+wheel_timer_t uptime_timer;
 
 volatile uint32_t com_timeout_count_s = 0;
 uint32_t com_timeout_period_s = COM_TIMEOUT_DEF_PERIOD;
+// Calls com_timeout_timer_cb() every COM_TIMEOUT_CB_INTERVAL seconds
+wheel_timer_t com_timeout_timer;
 
 
 void uptime_timer_cb(void);
@@ -67,8 +77,12 @@ void init_uptime(void) {
         uptime_callbacks[i] = uptime_fn_nop;
     }
 
-    // Initialize timer to go off at regular intervals
-    start_timer_8bit(UPTIME_TIMER_PERIOD, uptime_timer_cb);
+    // Initialize timer to go off at regular intervals (in the wheel's
+    // interrupt)
+    init_timer_wheel();
+    init_wheel_timer(&uptime_timer, uptime_timer_cb, 0);
+    start_wheel_timer(&uptime_timer, UPTIME_TIMER_PERIOD * 1000UL,
+        UPTIME_TIMER_PERIOD * 1000UL);
 }
 
 void update_restart_count(void) {
@@ -108,9 +122,13 @@ void uptime_timer_cb(void) {
 }
 
 
-// Use the 16-bit timer to isolate it from uptime functionality as a redundancy measure
+// Use a separate wheel timer (with its own callback) to isolate it from uptime
+// functionality as a redundancy measure
 void init_com_timeout(void) {
-    start_timer_16bit(COM_TIMEOUT_CB_INTERVAL, com_timeout_timer_cb);
+    init_timer_wheel();
+    init_wheel_timer(&com_timeout_timer, com_timeout_timer_cb, 0);
+    start_wheel_timer(&com_timeout_timer, COM_TIMEOUT_CB_INTERVAL * 1000UL,
+        COM_TIMEOUT_CB_INTERVAL * 1000UL);
 }
 
 void restart_com_timeout(void) {